@@ -0,0 +1,395 @@
+/****************************************************/
+/* Per-operation benchmark over the generic HE      */
+/* interface (HEScheme.h): times encode, encrypt,   */
+/* add, multiply, relinearize, rescale, rotate and  */
+/* decrypt on every library compiled in, runs the   */
+/* velocity circuit written once against all of     */
+/* them, plans and runs formulas through the        */
+/* circuit DSL, packs many small requests into      */
+/* shared ciphertexts, and names the fastest        */
+/* library per operation                            */
+/****************************************************/
+
+#define HEBENCH_COUNT_ALLOCATIONS
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "BenchConfig.h"
+#include "HECircuit.h"
+#include "HEMemory.h"
+#include "HEReport.h"
+#include "HEScheme.h"
+#include "HETimer.h"
+#include "RotationPlan.h"
+#include "SlotPacker.h"
+#include "ThreadPool.h"
+#include "VelocityData.h"
+
+#ifdef HEBENCH_WITH_SEAL
+#include "SEALScheme.h"
+#endif
+#ifdef HEBENCH_WITH_PALISADE
+#include "PalisadeScheme.h"
+#endif
+#ifdef HEBENCH_WITH_HELIB
+#include "HElibScheme.h"
+#endif
+
+using namespace std;
+using namespace hebench;
+
+// Median seconds per operation, one entry per library that ran it.
+using OperationTimes = map<string, vector<pair<string, double>>>;
+
+// Integer results as an exact scheme decrypts them: centered mod t.
+vector<int64_t> Reduced(vector<int64_t> values, const BenchConfig &config)
+{
+    if (config.scheme == "ckks")
+    {
+        return values;
+    }
+    int64_t t = static_cast<int64_t>(config.plain_modulus);
+    for (int64_t &value : values)
+    {
+        value %= t;
+        if (value > t / 2)
+            value -= t;
+        else if (value < -(t / 2))
+            value += t;
+    }
+    return values;
+}
+
+// Plans circuit, evaluates its "result" output on the pool (timed as
+// circuit_<name>) and returns the max error, or -1 if the circuit is
+// deeper than the configured depth.
+template <typename Scheme>
+double RunCircuit(const Scheme &he, const string &name, const Circuit &circuit,
+                  const map<string, vector<double>> &values, const vector<int64_t> &expected,
+                  const BenchConfig &config, HETimer &timer, ThreadPool &pool)
+{
+    CircuitPlan plan = PlanCircuit(circuit);
+    cout << "circuit " << name << ": depth " << plan.written_depth << " as written, " << plan.max_depth()
+         << " planned, " << plan.operation_count() << " operations in " << plan.waves.size() << " waves, "
+         << plan.merged << " merged" << endl;
+    if (plan.max_depth() > config.depth)
+    {
+        cout << "circuit " << name << ": skipped, needs --depth " << plan.max_depth() << endl;
+        return -1;
+    }
+    auto inputs = EncryptCircuitInputs(he, plan, values);
+    auto outputs = EvaluateCircuit(he, plan, inputs, pool);
+    timer.measure("circuit_" + name, [&]() { outputs = EvaluateCircuit(he, plan, inputs, pool); });
+    return MaxAbsError(he.decrypt(outputs.at("result"), expected.size()), Reduced(expected, config));
+}
+
+// Window of the packed requests' moving sum: each result slot reads the
+// next kPackedWindow - 1 slots, so that many guard slots follow a request.
+constexpr size_t kPackedWindow = 4;
+
+struct PackingResult
+{
+    size_t clients = 0;
+    size_t ciphertexts = 0;
+    double occupancy = 0;
+    double max_error = 0;
+    double mask_leak = -1; // largest slot outside the masked request, -1 if not run
+};
+
+// Many small requests through the velocity circuit and a window sum, timed
+// packed into shared ciphertexts (packed_requests) and one ciphertext each
+// (unpacked_requests). A request's window ends at its own last value, so a
+// neighbour's slot leaking through a guard would show up as error.
+template <typename Scheme>
+PackingResult RunPacking(const Scheme &he, const BenchConfig &config, HETimer &timer, ThreadPool &pool)
+{
+    PackingResult result;
+    result.clients = config.packed_requests;
+
+    vector<size_t> lengths(result.clients);
+    vector<PackedOperand> operands(3);
+    operands[0].level = 1; // v meets the rescaled product
+    vector<vector<int64_t>> expected(result.clients);
+    for (size_t c = 0; c < result.clients; c++)
+    {
+        lengths[c] = 8 + (c * 37) % 57;
+        VelocityData data = MakeVelocityData(lengths[c], config.seed + c, config.max_value);
+        operands[0].values.push_back(ToSlots(data.initial_velocity));
+        operands[1].values.push_back(ToSlots(data.acc));
+        operands[2].values.push_back(ToSlots(data.times));
+
+        vector<int64_t> velocity = ExpectedVelocity(data);
+        expected[c].assign(lengths[c], 0);
+        for (size_t i = 0; i < lengths[c]; i++)
+        {
+            for (size_t j = i; j < min(i + kPackedWindow, lengths[c]); j++)
+            {
+                expected[c][i] += velocity[j];
+            }
+        }
+        expected[c] = Reduced(expected[c], config);
+    }
+
+    auto body = [](const Scheme &s, const vector<typename Scheme::Ciphertext> &in) {
+        return WindowSum(s, VelocityCircuit(s, in[0], in[1], in[2]), kPackedWindow);
+    };
+    SlotLayout packed(lengths, he.slot_count(), he.row_size(), kPackedWindow - 1);
+    SlotLayout unpacked = SlotLayout::OnePerCiphertext(lengths, he.slot_count());
+    result.ciphertexts = packed.ciphertext_count();
+    result.occupancy = packed.occupancy();
+
+    vector<vector<double>> values = EvaluatePacked(he, packed, operands, body, pool);
+    timer.measure("packed_requests", [&]() { values = EvaluatePacked(he, packed, operands, body, pool); });
+    vector<vector<double>> alone = EvaluatePacked(he, unpacked, operands, body, pool);
+    timer.measure("unpacked_requests", [&]() { alone = EvaluatePacked(he, unpacked, operands, body, pool); });
+    for (size_t c = 0; c < result.clients; c++)
+    {
+        result.max_error = max(result.max_error, MaxAbsError(values[c], expected[c]));
+        result.max_error = max(result.max_error, MaxAbsError(alone[c], expected[c]));
+    }
+
+    // Request 0's result cut out of its shared ciphertext by a mask: one
+    // more level, so CKKS needs depth 2.
+    if (config.scheme == "ckks" && config.depth < 2)
+    {
+        return result;
+    }
+    const SlotRange &range = packed.range(0);
+    vector<typename Scheme::Ciphertext> inputs;
+    for (const PackedOperand &operand : operands)
+    {
+        inputs.push_back(he.encrypt(he.encode(packed.pack(operand.values)[range.ciphertext], operand.level)));
+    }
+    vector<double> masked = he.decrypt(MaskClient(he, packed, 0, body(he, inputs), 1), he.slot_count());
+    result.mask_leak = 0;
+    for (size_t i = 0; i < masked.size(); i++)
+    {
+        if (i < range.offset || i >= range.offset + range.size)
+            result.mask_leak = max(result.mask_leak, abs(masked[i]));
+    }
+    vector<double> own(masked.begin() + range.offset, masked.begin() + range.offset + range.size);
+    result.max_error = max(result.max_error, MaxAbsError(own, expected[0]));
+    return result;
+}
+
+template <typename Scheme>
+void RunOperations(const BenchConfig &config, BenchReport &report, OperationTimes &times)
+{
+    HETimer timer(config.warmup, config.reps);
+
+    unique_ptr<Scheme> he;
+    timer.start("setup");
+    he.reset(new Scheme(config));
+    timer.stop("setup");
+
+    RotationPlan rotations;
+    rotations.rotate(1).window_sum(kPackedWindow);
+    timer.start("keygen");
+    he->keygen(rotations);
+    timer.stop("keygen");
+
+    size_t records = config.records ? min(config.records, he->slot_count()) : he->slot_count();
+    VelocityData data = MakeVelocityData(records, config.seed, config.max_value);
+
+    /*****Operations*****/
+    // Each result is kept so the next operation consumes a real input.
+    auto plain_acc = he->encode(ToSlots(data.acc));
+    timer.measure("encode", [&]() { plain_acc = he->encode(ToSlots(data.acc)); });
+    auto plain_times = he->encode(ToSlots(data.times));
+
+    auto acc = he->encrypt(plain_acc);
+    timer.measure("encrypt", [&]() { acc = he->encrypt(plain_acc); });
+    auto enc_times = he->encrypt(plain_times);
+    auto initial_velocity = he->encrypt(he->encode(ToSlots(data.initial_velocity), 1));
+
+    auto product = he->multiply(acc, enc_times);
+    timer.measure("multiply", [&]() { product = he->multiply(acc, enc_times); });
+    auto relinearized = he->relinearize(product);
+    timer.measure("relinearize", [&]() { relinearized = he->relinearize(product); });
+    auto rescaled = he->rescale(relinearized);
+    timer.measure("rescale", [&]() { rescaled = he->rescale(relinearized); });
+    auto sum = he->add(initial_velocity, rescaled);
+    timer.measure("add", [&]() { sum = he->add(initial_velocity, rescaled); });
+    auto plain_product = he->multiply_plain(acc, plain_times);
+    timer.measure("multiply_plain", [&]() { plain_product = he->multiply_plain(acc, plain_times); });
+    auto rotated = he->rotate(acc, 1);
+    timer.measure("rotate", [&]() { rotated = he->rotate(acc, 1); });
+    vector<double> final_vel = he->decrypt(sum, records);
+    timer.measure("decrypt", [&]() { final_vel = he->decrypt(sum, records); });
+
+    /*****Workload*****/
+    auto circuit = VelocityCircuit(*he, initial_velocity, acc, enc_times);
+    timer.measure("velocity_circuit", [&]() { circuit = VelocityCircuit(*he, initial_velocity, acc, enc_times); });
+    double max_error = MaxAbsError(he->decrypt(circuit, records), ExpectedVelocity(data));
+    max_error = max(max_error, MaxAbsError(final_vel, ExpectedVelocity(data)));
+
+    /*****Circuits*****/
+    // The same formulas through the planner: written naively, scheduled by
+    // it. Displacement (doubled to stay integral) needs depth 2.
+    ThreadPool pool(config.threads);
+    map<string, vector<double>> values{ { "v", ToSlots(data.initial_velocity) },
+                                        { "a", ToSlots(data.acc) },
+                                        { "t", ToSlots(data.times) } };
+    Circuit velocity;
+    {
+        CircuitExpr v = velocity.input("v"), a = velocity.input("a"), t = velocity.input("t");
+        velocity.output("result", v + a * t);
+    }
+    max_error = max(max_error, RunCircuit(*he, "velocity", velocity, values, ExpectedVelocity(data), config, timer, pool));
+
+    Circuit displacement;
+    vector<int64_t> expected_displacement(records);
+    {
+        CircuitExpr v = displacement.input("v"), a = displacement.input("a"), t = displacement.input("t");
+        displacement.output("result", 2.0 * v * t + a * t * t);
+        for (size_t i = 0; i < records; i++)
+        {
+            int64_t time = data.times[i];
+            expected_displacement[i] = 2 * data.initial_velocity[i] * time + data.acc[i] * time * time;
+        }
+    }
+    max_error = max(max_error, RunCircuit(*he, "displacement", displacement, values, expected_displacement, config,
+                                          timer, pool));
+
+    /*****Packing*****/
+    PackingResult packing = RunPacking(*he, config, timer, pool);
+    max_error = max(max_error, packing.max_error);
+
+    // BFV rotates two rows of slot_count/2, so only the first row is checked.
+    vector<double> rotated_acc = he->decrypt(rotated, records);
+    double rotate_error = 0;
+    for (size_t i = 0; i + 1 < min(records, he->slot_count() / 2); i++)
+    {
+        rotate_error = max(rotate_error, abs(rotated_acc[i] - static_cast<double>(data.acc[i + 1])));
+    }
+
+    cout << Scheme::Name() << " " << config.scheme << ": ring dimension " << config.ring_dim << ", "
+         << he->slot_count() << " slots, " << records << " records, max error " << max_error << ", rotate error "
+         << rotate_error << endl;
+    cout << "packing: " << packing.clients << " requests in " << packing.ciphertexts << " ciphertexts instead of "
+         << packing.clients << " (" << 100 * packing.occupancy << "% of slots used), mask leak ";
+    if (packing.mask_leak >= 0)
+        cout << packing.mask_leak << endl;
+    else
+        cout << "not checked, needs --depth 2" << endl;
+    timer.print(cout);
+
+    for (const PhaseStats &phase : timer.all_stats())
+    {
+        if (phase.name != "setup" && phase.name != "keygen")
+        {
+            times[phase.name].push_back({ Scheme::Name(), phase.wall_p50_s });
+        }
+        report.add_row()
+            .set("backend", Scheme::Name())
+            .set("scheme", config.scheme)
+            .set("ring_dim", config.ring_dim)
+            .set("slots", he->slot_count())
+            .set("records", records)
+            .set("seed", config.seed)
+            .set("operation", phase.name)
+            .set("reps", phase.reps)
+            .set("wall_mean_s", phase.wall_mean_s)
+            .set("wall_p50_s", phase.wall_p50_s)
+            .set("wall_p95_s", phase.wall_p95_s)
+            .set("wall_p99_s", phase.wall_p99_s)
+            .set("allocated_bytes", phase.allocated_mean_bytes)
+            .set("max_error", max_error)
+            .set("rotate_error", rotate_error)
+            .set("packed_requests", packing.clients)
+            .set("packed_ciphertexts", packing.ciphertexts)
+            .set("mask_leak", packing.mask_leak)
+            .set("error", "");
+    }
+}
+
+template <typename Scheme>
+bool RunIfSelected(const BenchConfig &config, BenchReport &report, OperationTimes &times)
+{
+    if (!config.backend.empty() && config.backend != Scheme::Name())
+    {
+        return false;
+    }
+    if (!Scheme::Supports(config.scheme))
+    {
+        cout << Scheme::Name() << ": skipped, no " << config.scheme << " scheme" << endl;
+        return false;
+    }
+    BenchConfig planned = PlanBenchConfig(config);
+    if (config.params == "auto")
+    {
+        cout << Scheme::Name() << " planned parameters: " << DescribePlan(PlannedParameters(planned)) << endl;
+    }
+    RunOperations<Scheme>(planned, report, times);
+    return true;
+}
+
+// The library with the lowest median for each operation.
+void PrintFastest(const OperationTimes &times)
+{
+    cout << endl << "Fastest library per operation (p50 s):" << endl;
+    for (const auto &operation : times)
+    {
+        auto best = min_element(operation.second.begin(), operation.second.end(),
+                                [](const pair<string, double> &a, const pair<string, double> &b) {
+                                    return a.second < b.second;
+                                });
+        cout << "  " << left << setw(20) << operation.first << right << setw(10) << best->first << setw(14)
+             << best->second;
+        for (const auto &other : operation.second)
+        {
+            if (&other != &*best)
+                cout << "  " << other.first << " " << other.second;
+        }
+        cout << endl;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        BenchConfig config = ParseBenchConfig(argc, argv);
+        BenchReport report;
+        OperationTimes times;
+
+        int ran = 0;
+#ifdef HEBENCH_WITH_SEAL
+        ran += RunIfSelected<SEALScheme>(config, report, times);
+#endif
+#ifdef HEBENCH_WITH_PALISADE
+        ran += RunIfSelected<PalisadeScheme>(config, report, times);
+#endif
+#ifdef HEBENCH_WITH_HELIB
+        ran += RunIfSelected<HElibScheme>(config, report, times);
+#endif
+        if (ran == 0)
+        {
+            throw invalid_argument("no backend built into this binary can run the requested backend/scheme");
+        }
+        PrintFastest(times);
+
+        if (!config.json_path.empty())
+        {
+            report.save_json(config.json_path);
+        }
+        if (!config.csv_path.empty())
+        {
+            report.append_csv(config.csv_path);
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << "error: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,417 @@
+/****************************************************/
+/* Cross-library velocity benchmark                 */
+/* Runs the same V_i + at workload and dataset on   */
+/* every backend compiled in (HEBENCH_WITH_SEAL,    */
+/* HEBENCH_WITH_PALISADE, HEBENCH_WITH_HELIB) and   */
+/* writes the phase timings as JSON/CSV. Inputs     */
+/* larger than one ciphertext are split into chunks */
+/* run on a thread pool or streamed through a       */
+/* stage pipeline; --ring-dims/--depths/            */
+/* --batch-sizes sweep the grid and report items/s; */
+/* --public compares plaintext-operand evaluation   */
+/* against the all-encrypted baseline; --crt splits */
+/* BFV/BGV integers across several plaintext moduli */
+/****************************************************/
+
+// Count operator new bytes per phase (see HEMemory.h).
+#define HEBENCH_COUNT_ALLOCATIONS
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "BenchConfig.h"
+#include "ChunkedEngine.h"
+#include "CrtBackend.h"
+#include "HEMemory.h"
+#include "HERecycler.h"
+#include "HEReport.h"
+#include "HETimer.h"
+#include "PipelineEngine.h"
+#include "ThreadPool.h"
+#include "VelocityData.h"
+
+#ifdef HEBENCH_WITH_SEAL
+#include "SEALBackend.h"
+#endif
+#ifdef HEBENCH_WITH_PALISADE
+#include "PalisadeBackend.h"
+#endif
+#ifdef HEBENCH_WITH_HELIB
+#include "HElibBackend.h"
+#endif
+
+using namespace std;
+using namespace hebench;
+
+// Throughput of one sweep point, from the median latencies.
+struct VelocityPoint
+{
+    size_t ring_dim = 0;
+    size_t depth = 0;
+    size_t records = 0;
+    double eval_p50_s = 0; // one chunk
+    double e2e_p50_s = 0;  // every chunk, encode .. decrypt, on all threads
+    double eval_items_per_s = 0;
+    double e2e_items_per_s = 0;
+    int noise_budget_bits = -1; // left in a result, -1 if the library does not report it
+};
+
+template <typename Backend>
+VelocityPoint RunVelocity(const BenchConfig &config, BenchReport &report)
+{
+    HETimer timer(config.warmup, config.reps);
+
+    // Context and keys are built once and shared by every chunk and thread.
+    unique_ptr<Backend> backend;
+    timer.start("setup");
+    backend.reset(new Backend(config));
+    timer.stop("setup");
+
+    timer.start("keygen");
+    backend->keygen();
+    timer.stop("keygen");
+
+    size_t records = config.records ? config.records : backend->slot_count();
+    size_t chunk_size = backend->slot_count();
+    size_t chunks = (records + chunk_size - 1) / chunk_size;
+    size_t threads = 0;
+    double max_error = 0;
+    RecycleCounts recycled; // over the timed chunked runs
+
+    // Warm-up runs go to a scratch timer so only the timed runs are recorded.
+    HETimer warmup_timer;
+    if (config.engine == "pipeline")
+    {
+        // Streams the dataset, so memory stays flat however many records.
+        StageThreads stages;
+        stages.encode = config.stage_threads[0];
+        stages.encrypt = config.stage_threads[1];
+        stages.evaluate = config.stage_threads[2];
+        stages.decrypt = config.stage_threads[3];
+        PipelineEngine<Backend> engine(*backend, stages, config.queue_depth);
+        threads = engine.thread_count();
+
+        for (size_t i = 0; i < config.warmup; i++)
+        {
+            VelocityStream source(records, config.seed, config.max_value);
+            engine.run(source, warmup_timer);
+        }
+        for (size_t i = 0; i < config.reps; i++)
+        {
+            VelocityStream source(records, config.seed, config.max_value);
+            Stopwatch stopwatch;
+            PipelineSummary summary = engine.run(source, timer);
+            timer.record("total", stopwatch.elapsed());
+            max_error = max(max_error, summary.max_error);
+        }
+    }
+    else
+    {
+        VelocityData data = MakeVelocityData(records, config.seed, config.max_value);
+        ThreadPool pool(config.threads);
+        ChunkedEngine<Backend> engine(*backend, pool);
+        threads = pool.size();
+
+        for (size_t i = 0; i < config.warmup; i++)
+        {
+            engine.run(data, warmup_timer);
+        }
+        vector<double> final_vel;
+        RecycleCounts before = RecycleTotals();
+        for (size_t i = 0; i < config.reps; i++)
+        {
+            Stopwatch stopwatch;
+            final_vel = engine.run(data, timer);
+            timer.record("total", stopwatch.elapsed());
+        }
+        recycled = RecycleTotals() - before;
+        max_error = MaxAbsError(final_vel, ExpectedVelocity(data));
+    }
+
+    // Bytes the library's memory pools hold after the runs, -1 if the
+    // backend does not report them.
+    int64_t pool_bytes = -1;
+    if constexpr (ReportsPoolBytes<Backend>::value)
+    {
+        pool_bytes = static_cast<int64_t>(backend->memory_pool_bytes());
+    }
+
+    // One more chunk, outside the timed runs, for the serialized and
+    // transport (what a client and evaluator exchange) sizes.
+    VelocityData first_chunk = MakeVelocityData(min(records, chunk_size), config.seed, config.max_value);
+    auto encoded = backend->encode(first_chunk);
+    auto encrypted = backend->encrypt(encoded);
+    auto result = backend->evaluate(encrypted);
+    vector<ObjectSize> sizes = backend->object_sizes(encrypted, result);
+    vector<ObjectSize> transport = backend->transport_sizes(encoded, result, config.compression);
+
+    VelocityPoint point;
+    point.ring_dim = backend->ring_dimension();
+    point.depth = config.depth;
+    point.records = records;
+    point.eval_p50_s = timer.stats("evaluate").wall_p50_s;
+    point.e2e_p50_s = timer.stats("total").wall_p50_s;
+    point.eval_items_per_s = point.eval_p50_s > 0 ? min(records, chunk_size) / point.eval_p50_s : 0;
+    point.e2e_items_per_s = point.e2e_p50_s > 0 ? records / point.e2e_p50_s : 0;
+    point.noise_budget_bits = backend->noise_budget_bits(result);
+
+    cout << Backend::Name() << " " << backend->scheme() << ": ring dimension " << backend->ring_dimension() << ", "
+         << backend->slot_count() << " slots, depth " << config.depth << ", " << records << " records in " << chunks
+         << " chunks on " << threads << " " << config.engine << " threads, key cache "
+         << backend->key_cache_status() << ", public " << PublicOperandNames(config.public_operands) << ", max error "
+         << max_error << ", noise budget " << point.noise_budget_bits << " bits" << endl;
+    timer.print(cout);
+    cout << "Memory: " << config.memory_pool << " pool";
+    if (pool_bytes >= 0)
+        cout << " " << pool_bytes << " bytes";
+    cout << ", recycle " << (config.recycle ? "on" : "off") << ", " << recycled.reused << " of "
+         << recycled.acquired << " chunk objects reused" << endl;
+    cout << "Serialized sizes:" << endl;
+    for (const ObjectSize &size : sizes)
+    {
+        PrintObjectSize(cout, size);
+    }
+    cout << "Transport sizes (" << config.compression << ", " << first_chunk.size() << " records):" << endl;
+    for (const ObjectSize &size : transport)
+    {
+        PrintObjectSize(cout, size);
+    }
+
+    // Columns shared by every row of this run.
+    auto new_row = [&]() -> BenchReport::Row & {
+        return report.add_row()
+            .set("backend", Backend::Name())
+            .set("scheme", backend->scheme())
+            .set("ring_dim", backend->ring_dimension())
+            .set("slots", backend->slot_count())
+            .set("depth", config.depth)
+            .set("params", config.params)
+            .set("security", config.security)
+            .set("coeff_bits", config.coeff_bits.empty() ? "default" : CoeffBitsList(config.coeff_bits))
+            .set("crt_moduli", CrtModuliList(config))
+            .set("records", records)
+            .set("chunks", chunks)
+            .set("engine", config.engine)
+            .set("key_cache", backend->key_cache_status())
+            .set("public", PublicOperandNames(config.public_operands))
+            .set("threads", threads)
+            .set("memory_pool", config.memory_pool)
+            .set("recycle", config.recycle ? "on" : "off")
+            .set("pool_bytes", pool_bytes)
+            .set("objects_acquired", recycled.acquired)
+            .set("objects_reused", recycled.reused)
+            .set("seed", config.seed);
+    };
+    for (const PhaseStats &phase : timer.all_stats())
+    {
+        new_row()
+            .set("phase", phase.name)
+            .set("reps", phase.reps)
+            .set("wall_mean_s", phase.wall_mean_s)
+            .set("wall_p50_s", phase.wall_p50_s)
+            .set("wall_p95_s", phase.wall_p95_s)
+            .set("wall_p99_s", phase.wall_p99_s)
+            .set("wall_min_s", phase.wall_min_s)
+            .set("wall_max_s", phase.wall_max_s)
+            .set("cpu_s", phase.cpu_mean_s)
+            .set("thread_cpu_s", phase.thread_cpu_mean_s)
+            .set("heap_delta_bytes", phase.heap_delta_mean_bytes)
+            .set("allocated_bytes", phase.allocated_mean_bytes)
+            .set("memory_scope", phase.process_wide_memory ? "process" : "phase")
+            .set("peak_rss_bytes", phase.peak_rss_bytes)
+            .set("eval_items_per_s", point.eval_items_per_s)
+            .set("e2e_items_per_s", point.e2e_items_per_s)
+            .set("max_error", max_error)
+            .set("noise_budget_bits", point.noise_budget_bits)
+            .set("error", "");
+    }
+    for (const ObjectSize &size : sizes)
+    {
+        new_row()
+            .set("object", size.name)
+            .set("bytes", size.bytes)
+            .set("error", "");
+    }
+    for (const ObjectSize &size : transport)
+    {
+        new_row()
+            .set("object", size.name)
+            .set("bytes", size.bytes)
+            .set("compression", config.compression)
+            .set("bytes_per_record", static_cast<double>(size.bytes) / first_chunk.size())
+            .set("error", "");
+    }
+    return point;
+}
+
+// Runs every (ring dimension, depth, batch size) combination of the grid.
+// Points the library rejects (e.g. a ring too small for the depth) are
+// reported with their error and the sweep carries on.
+template <typename Backend>
+void SweepVelocity(const BenchConfig &config, BenchReport &report)
+{
+    vector<uint64_t> ring_dims = config.sweep_ring_dims;
+    vector<uint64_t> depths = config.sweep_depths;
+    vector<uint64_t> batch_sizes = config.sweep_records;
+    if (ring_dims.empty())
+        ring_dims.push_back(config.ring_dim);
+    if (depths.empty())
+        depths.push_back(config.depth);
+    if (batch_sizes.empty())
+        batch_sizes.push_back(config.records);
+
+    vector<VelocityPoint> curve;
+    for (uint64_t ring_dim : ring_dims)
+    {
+        for (uint64_t depth : depths)
+        {
+            for (uint64_t records : batch_sizes)
+            {
+                BenchConfig point = config;
+                point.ring_dim = ring_dim;
+                point.depth = static_cast<uint32_t>(depth);
+                point.records = records;
+                try
+                {
+                    point = PlanBenchConfig(point);
+                    curve.push_back(RunVelocity<Backend>(point, report));
+                }
+                catch (const exception &e)
+                {
+                    cout << Backend::Name() << " " << config.scheme << ": ring dimension " << ring_dim << ", depth "
+                         << depth << ", " << records << " records skipped: " << e.what() << endl;
+                    report.add_row()
+                        .set("backend", Backend::Name())
+                        .set("scheme", config.scheme)
+                        .set("ring_dim", ring_dim)
+                        .set("depth", depth)
+                        .set("records", records)
+                        .set("error", e.what());
+                }
+            }
+        }
+    }
+
+    cout << endl << Backend::Name() << " " << config.scheme << " scaling:" << endl;
+    cout << setw(10) << "ring_dim" << setw(7) << "depth" << setw(10) << "records" << setw(14) << "eval p50 (s)"
+         << setw(16) << "eval items/s" << setw(13) << "e2e p50 (s)" << setw(15) << "e2e items/s" << endl;
+    for (const VelocityPoint &point : curve)
+    {
+        cout << setw(10) << point.ring_dim << setw(7) << point.depth << setw(10) << point.records << setw(14)
+             << point.eval_p50_s << setw(16) << point.eval_items_per_s << setw(13) << point.e2e_p50_s << setw(15)
+             << point.e2e_items_per_s << endl;
+    }
+}
+
+// Runs the all-encrypted baseline and then the configured public operands,
+// and reports the evaluation speed-up and the noise budget left over.
+template <typename Backend>
+void ComparePublicOperands(const BenchConfig &config, BenchReport &report)
+{
+    BenchConfig baseline = config;
+    baseline.public_operands = PublicOperands();
+    VelocityPoint secret = RunVelocity<Backend>(baseline, report);
+    VelocityPoint with_public = RunVelocity<Backend>(config, report);
+
+    cout << endl << Backend::Name() << " " << config.scheme << " public " << PublicOperandNames(config.public_operands)
+         << " vs all encrypted:" << endl;
+    cout << "  evaluate p50:  " << secret.eval_p50_s << " s -> " << with_public.eval_p50_s << " s ("
+         << (with_public.eval_p50_s > 0 ? secret.eval_p50_s / with_public.eval_p50_s : 0) << "x)" << endl;
+    cout << "  e2e items/s:   " << secret.e2e_items_per_s << " -> " << with_public.e2e_items_per_s << endl;
+    if (secret.noise_budget_bits >= 0 && with_public.noise_budget_bits >= 0)
+    {
+        cout << "  noise budget:  " << secret.noise_budget_bits << " -> " << with_public.noise_budget_bits << " bits ("
+             << with_public.noise_budget_bits - secret.noise_budget_bits << " saved)" << endl;
+    }
+    else
+    {
+        cout << "  noise budget:  not reported by " << Backend::Name() << " " << config.scheme << endl;
+    }
+}
+
+template <typename Backend>
+void RunBackend(const BenchConfig &config, BenchReport &report)
+{
+    if (config.sweep())
+    {
+        SweepVelocity<Backend>(config, report);
+        return;
+    }
+    BenchConfig planned = PlanBenchConfig(config);
+    if (config.params == "auto")
+    {
+        cout << Backend::Name() << " planned parameters: " << DescribePlan(PlannedParameters(planned)) << endl;
+    }
+    if (config.crt > 1)
+    {
+        cout << Backend::Name() << " CRT plaintext moduli: " << CrtModuliList(planned) << endl;
+    }
+    if (config.public_operands.any())
+        ComparePublicOperands<Backend>(planned, report);
+    else
+        RunVelocity<Backend>(planned, report);
+}
+
+// Runs Backend if it was selected and can run the requested scheme, split
+// across CRT plaintext moduli with --crt.
+template <typename Backend>
+bool RunIfSelected(const BenchConfig &config, BenchReport &report)
+{
+    if (!config.backend.empty() && config.backend != Backend::Name())
+    {
+        return false;
+    }
+    if (!Backend::Supports(config.scheme))
+    {
+        cout << Backend::Name() << ": skipped, no " << config.scheme << " scheme" << endl;
+        return false;
+    }
+    if (config.crt > 1)
+        RunBackend<CrtBackend<Backend>>(config, report);
+    else
+        RunBackend<Backend>(config, report);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        BenchConfig config = ParseBenchConfig(argc, argv);
+        BenchReport report;
+
+        int ran = 0;
+#ifdef HEBENCH_WITH_SEAL
+        ran += RunIfSelected<SEALBackend>(config, report);
+#endif
+#ifdef HEBENCH_WITH_PALISADE
+        ran += RunIfSelected<PalisadeBackend>(config, report);
+#endif
+#ifdef HEBENCH_WITH_HELIB
+        ran += RunIfSelected<HElibBackend>(config, report);
+#endif
+        if (ran == 0)
+        {
+            throw invalid_argument("no backend built into this binary can run the requested backend/scheme");
+        }
+
+        if (!config.json_path.empty())
+        {
+            report.save_json(config.json_path);
+        }
+        if (!config.csv_path.empty())
+        {
+            report.append_csv(config.csv_path);
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << "error: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,226 @@
+/****************************************************/
+/* Local encrypted-compute service                  */
+/* --socket PATH serves the velocity circuit of one */
+/* backend until SIGINT/SIGTERM, with context and   */
+/* keys loaded once from --key-cache; with          */
+/* --clients N it runs N concurrent clients of      */
+/* --reps requests against a running service and    */
+/* prints round-trip and service p50/p99 latencies  */
+/****************************************************/
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BenchConfig.h"
+#include "HEReport.h"
+#include "HETimer.h"
+#include "VelocityData.h"
+#include "VelocityService.h"
+
+#ifdef HEBENCH_WITH_SEAL
+#include "SEALBackend.h"
+#endif
+#ifdef HEBENCH_WITH_PALISADE
+#include "PalisadeBackend.h"
+#endif
+#ifdef HEBENCH_WITH_HELIB
+#include "HElibBackend.h"
+#endif
+
+using namespace std;
+using namespace hebench;
+
+namespace
+{
+atomic<bool> stop_requested{ false };
+
+extern "C" void RequestStop(int)
+{
+    stop_requested.store(true);
+}
+} // namespace
+
+// Context and keys once, then requests until a signal arrives.
+template <typename Backend>
+void Serve(const BenchConfig &config, BenchReport &report)
+{
+    HETimer timer;
+    unique_ptr<Backend> backend;
+    timer.start("setup");
+    backend.reset(new Backend(config));
+    timer.stop("setup");
+
+    timer.start("keygen");
+    backend->keygen();
+    timer.stop("keygen");
+
+    VelocityService<Backend> service(*backend, config);
+    signal(SIGINT, RequestStop);
+    signal(SIGTERM, RequestStop);
+
+    cout << Backend::Name() << " " << backend->scheme() << ": ring dimension " << backend->ring_dimension() << ", "
+         << backend->slot_count() << " slots per request, key cache " << backend->key_cache_status() << ", serving on "
+         << config.socket_path << " with " << service.worker_count() << " workers, batches of up to "
+         << config.max_batch << " within " << config.batch_window_us << " us" << endl;
+    timer.print(cout);
+
+    service.run(stop_requested);
+    cout << service.report();
+    service.add_rows(report);
+}
+
+// N clients, each on its own connection, send one encrypted chunk --reps
+// times and check every result.
+template <typename Backend>
+void Load(const BenchConfig &config, BenchReport &report)
+{
+    Backend backend(config);
+    backend.keygen();
+    if (string(backend.key_cache_status()) != "hit")
+    {
+        throw invalid_argument("no keys in --key-cache " + config.key_cache +
+                               " for these parameters; start the service with the same options first");
+    }
+
+    size_t records = min(config.records ? config.records : backend.slot_count(), backend.slot_count());
+    VelocityData data = MakeVelocityData(records, config.seed, config.max_value);
+    vector<int64_t> expected = ExpectedVelocity(data);
+    auto encrypted = backend.encrypt(backend.encode(data));
+
+    HETimer timer;
+    mutex error_mutex;
+    double max_error = 0;
+    exception_ptr failure;
+    Stopwatch total;
+    vector<thread> clients;
+    for (size_t c = 0; c < config.clients; c++)
+    {
+        clients.emplace_back([&] {
+            try
+            {
+                VelocityClient<Backend> client(backend, config.socket_path);
+                for (size_t i = 0; i < config.reps; i++)
+                {
+                    Stopwatch stopwatch;
+                    auto result = client.evaluate(encrypted);
+                    timer.record("round_trip", stopwatch.elapsed(config.clients > 1));
+                    double error = MaxAbsError(backend.decrypt(result, records), expected);
+                    lock_guard<mutex> lock(error_mutex);
+                    max_error = max(max_error, error);
+                }
+            }
+            catch (...)
+            {
+                lock_guard<mutex> lock(error_mutex);
+                if (!failure)
+                    failure = current_exception();
+            }
+        });
+    }
+    for (thread &client : clients)
+    {
+        client.join();
+    }
+    if (failure)
+    {
+        rethrow_exception(failure);
+    }
+    double seconds = total.elapsed().wall_s;
+    size_t requests = config.clients * config.reps;
+
+    cout << Backend::Name() << " " << backend.scheme() << ": " << config.clients << " clients, " << requests
+         << " requests of " << records << " records in " << seconds << " s ("
+         << (seconds > 0 ? requests / seconds : 0) << " requests/s), max error " << max_error << endl;
+    timer.print(cout);
+    cout << VelocityClient<Backend>(backend, config.socket_path).stats();
+
+    PhaseStats round_trip = timer.stats("round_trip");
+    report.add_row()
+        .set("backend", Backend::Name())
+        .set("scheme", backend.scheme())
+        .set("ring_dim", backend.ring_dimension())
+        .set("records", records)
+        .set("clients", config.clients)
+        .set("requests", requests)
+        .set("requests_per_s", seconds > 0 ? requests / seconds : 0)
+        .set("wall_p50_s", round_trip.wall_p50_s)
+        .set("wall_p99_s", round_trip.wall_p99_s)
+        .set("max_error", max_error)
+        .set("error", "");
+}
+
+template <typename Backend>
+bool RunIfSelected(const BenchConfig &config, BenchReport &report)
+{
+    if (!config.backend.empty() && config.backend != Backend::Name())
+    {
+        return false;
+    }
+    if (!Backend::Supports(config.scheme))
+    {
+        return false;
+    }
+    if (config.clients > 0)
+        Load<Backend>(config, report);
+    else
+        Serve<Backend>(config, report);
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        BenchConfig config = PlanBenchConfig(ParseBenchConfig(argc, argv));
+        BenchReport report;
+
+        if (config.socket_path.empty() || config.key_cache.empty())
+        {
+            throw invalid_argument("the service needs --socket and a --key-cache shared with its clients");
+        }
+        // One chunk of all-encrypted operands per request.
+        if (config.public_operands.any() || config.crt > 1 || config.sweep())
+        {
+            throw invalid_argument("the service does not take --public, --crt or sweep options");
+        }
+
+        // Serves the first backend selected (--backend picks another).
+        bool ran = false;
+#ifdef HEBENCH_WITH_SEAL
+        ran = ran || RunIfSelected<SEALBackend>(config, report);
+#endif
+#ifdef HEBENCH_WITH_PALISADE
+        ran = ran || RunIfSelected<PalisadeBackend>(config, report);
+#endif
+#ifdef HEBENCH_WITH_HELIB
+        ran = ran || RunIfSelected<HElibBackend>(config, report);
+#endif
+        if (!ran)
+        {
+            throw invalid_argument("no backend built into this binary can run the requested backend/scheme");
+        }
+
+        if (!config.json_path.empty())
+        {
+            report.save_json(config.json_path);
+        }
+        if (!config.csv_path.empty())
+        {
+            report.append_csv(config.csv_path);
+        }
+    }
+    catch (const exception &e)
+    {
+        cerr << "error: " << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,488 @@
+/****************************************************/
+/* Benchmark configuration shared by all backends   */
+/* Parsed from "--flag value" command-line pairs    */
+/****************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Compression.h"
+#include "ParameterPlanner.h"
+
+namespace hebench
+{
+
+// Inputs the evaluator may see in the clear. They are never encrypted:
+// products use plaintext x ciphertext multiplication and sums add the
+// plaintext, which needs no relinearization key and adds far less noise.
+struct PublicOperands
+{
+    bool initial_velocity = false;
+    bool acc = false;
+    bool times = false;
+
+    bool any() const
+    {
+        return initial_velocity || acc || times;
+    }
+};
+
+struct BenchConfig
+{
+    std::string backend;                 // empty: every backend compiled into the binary
+    std::string scheme = "bfv";          // bfv, bgv or ckks
+    std::size_t records = 4096;          // number of (v_i, a, t) instances, 0 fills every slot;
+                                         // more than one ciphertext's slots are split into chunks
+    std::size_t ring_dim = 8192;         // poly_modulus_degree / ring dimension
+    std::uint64_t plain_modulus = 65537; // must be 1 mod 2*ring_dim for batching
+    std::uint32_t depth = 1;             // multiplicative depth of the circuit
+    std::uint32_t scale_bits = 40;       // CKKS scale 2^scale_bits
+    std::string params = "manual";       // manual (the values above) or auto (ParameterPlanner.h)
+    std::uint32_t security = 128;        // auto: security level in bits
+    std::uint32_t precision_bits = 20;   // auto: CKKS bits after the binary point
+    std::vector<int> coeff_bits;         // modulus prime sizes, empty = library default
+    std::size_t crt = 1;                 // BFV/BGV: coprime plaintext moduli, from plain_modulus up,
+                                         // each a context of its own; results are joined by CRT
+    std::uint32_t seed = 1;              // dataset seed, same seed -> same records
+    std::int64_t max_value = 100;        // inputs are drawn from [1, max_value]
+    std::size_t warmup = 1;              // untimed runs before the timed repetitions
+    std::size_t reps = 5;                // timed repetitions of encode .. decrypt
+    std::string engine = "chunked";      // chunked (thread pool) or pipeline (one stage per phase)
+    std::size_t threads = 0;             // chunked: worker threads, 0 = one per hardware thread
+    std::size_t queue_depth = 4;         // pipeline: chunks buffered between two stages
+    std::vector<std::uint64_t> stage_threads{ 1, 1, 1, 1 }; // pipeline: encode, encrypt, evaluate, decrypt
+    std::string json_path;
+    std::string csv_path;
+    std::string key_cache;               // directory for cached contexts and keys, empty = off
+    std::string compression = "none";    // transport size compression: none, zlib or zstd
+    PublicOperands public_operands;      // inputs left unencrypted
+    std::string memory_pool = "global";  // SEAL: global (one shared pool) or thread (one per thread)
+    bool recycle = true;                 // SEAL, chunked: reuse spent chunk objects (HERecycler.h)
+    std::string socket_path;             // service: Unix socket of the evaluator (VelocityService.h)
+    std::size_t clients = 0;             // service: 0 serves, N runs N concurrent clients against it
+    std::size_t max_batch = 8;           // service: requests evaluated together as one batch
+    std::size_t batch_window_us = 1000;  // service: how long a batch's first request waits for more
+    std::size_t packed_requests = 64;    // OperationBench: small requests packed into shared ciphertexts
+
+    // Sweep grid; a non-empty list replaces the single value above and the
+    // benchmark runs every combination.
+    std::vector<std::uint64_t> sweep_ring_dims;
+    std::vector<std::uint64_t> sweep_depths;
+    std::vector<std::uint64_t> sweep_records;
+
+    bool sweep() const
+    {
+        return !sweep_ring_dims.empty() || !sweep_depths.empty() || !sweep_records.empty();
+    }
+};
+
+// Every parameter a cached context or key set depends on; backends prefix
+// their name and library version.
+inline std::string ParameterKey(const BenchConfig &config)
+{
+    return "scheme=" + config.scheme + " ring_dim=" + std::to_string(config.ring_dim) +
+           " plain_modulus=" + std::to_string(config.plain_modulus) + " depth=" + std::to_string(config.depth) +
+           " scale_bits=" + std::to_string(config.scale_bits) + " security=" + std::to_string(config.security) +
+           " coeff_bits=" + (config.coeff_bits.empty() ? "default" : CoeffBitsList(config.coeff_bits));
+}
+
+// The config.crt plaintext moduli: plain_modulus and the next batching
+// primes above it, so all are coprime and share the ring dimension.
+inline std::vector<std::uint64_t> CrtPlainModuli(const BenchConfig &config)
+{
+    std::vector<std::uint64_t> moduli{ config.plain_modulus };
+    while (moduli.size() < config.crt)
+    {
+        moduli.push_back(FindPlainModulus(moduli.back(), config.ring_dim));
+    }
+    return moduli;
+}
+
+// "65537,114689" style list for reports, "none" without CRT splitting.
+inline std::string CrtModuliList(const BenchConfig &config)
+{
+    if (config.crt <= 1)
+    {
+        return "none";
+    }
+    std::string list;
+    for (std::uint64_t t : CrtPlainModuli(config))
+    {
+        list += (list.empty() ? "" : ",") + std::to_string(t);
+    }
+    return list;
+}
+
+// With --params auto: the smallest ring, plaintext modulus / scale and
+// modulus chain for the velocity circuit. Its results reach max_value +
+// max_value^2; records that fit one ciphertext of the largest ring must
+// fit one of the planned ring too, more are split into chunks anyway.
+// With --crt K each residue only needs about the K-th root of the range,
+// and the chain is sized for the largest of the K moduli.
+inline BenchConfig PlanBenchConfig(const BenchConfig &config)
+{
+    if (config.params != "auto")
+    {
+        return config;
+    }
+    CircuitRequirements req;
+    req.scheme = config.scheme;
+    req.depth = config.depth;
+    req.max_plain_value = static_cast<std::uint64_t>(config.max_value + config.max_value * config.max_value);
+    req.integer_bits = static_cast<std::uint32_t>(std::ceil(std::log2(static_cast<double>(req.max_plain_value) + 1)));
+    req.precision_bits = config.precision_bits;
+    req.security = config.security;
+    std::size_t largest = config.scheme == "ckks" ? 16384 : 32768;
+    req.slots = config.records <= largest ? config.records : 0;
+    if (config.crt > 1)
+    {
+        double root = std::pow(2.0 * static_cast<double>(req.max_plain_value), 1.0 / static_cast<double>(config.crt));
+        req.max_plain_value = static_cast<std::uint64_t>(std::ceil(root / 2)) + 1;
+    }
+
+    ParameterPlan plan = PlanParameters(req);
+    for (BenchConfig residues = config; config.crt > 1;)
+    {
+        residues.ring_dim = plan.ring_dim;
+        residues.plain_modulus = plan.plain_modulus;
+        std::uint64_t top = CrtPlainModuli(residues).back();
+        if (std::ceil(std::log2(static_cast<double>(top))) <=
+            std::ceil(std::log2(static_cast<double>(plan.plain_modulus))))
+        {
+            break;
+        }
+        // The chain was sized for a smaller t; plan again from the largest.
+        req.max_plain_value = top / 2;
+        plan = PlanParameters(req);
+    }
+    BenchConfig planned = config;
+    planned.ring_dim = plan.ring_dim;
+    planned.plain_modulus = plan.plain_modulus ? plan.plain_modulus : config.plain_modulus;
+    planned.scale_bits = plan.scale_bits ? plan.scale_bits : config.scale_bits;
+    planned.coeff_bits = plan.coeff_bits;
+    return planned;
+}
+
+// The parameters a config runs with, as a plan: what --params auto chose,
+// or the ones given by hand.
+inline ParameterPlan PlannedParameters(const BenchConfig &config)
+{
+    ParameterPlan plan;
+    plan.ring_dim = config.ring_dim;
+    plan.plain_modulus = config.scheme == "ckks" ? 0 : config.plain_modulus;
+    plan.scale_bits = config.scheme == "ckks" ? config.scale_bits : 0;
+    plan.coeff_bits = config.coeff_bits;
+    return plan;
+}
+
+// "initial_velocity,times" style list for reports, "none" if all are secret.
+inline std::string PublicOperandNames(const PublicOperands &operands)
+{
+    std::string names;
+    for (auto operand : { std::make_pair(operands.initial_velocity, "initial_velocity"),
+                          std::make_pair(operands.acc, "acc"), std::make_pair(operands.times, "times") })
+    {
+        if (operand.first)
+        {
+            names += (names.empty() ? "" : ",") + std::string(operand.second);
+        }
+    }
+    return names.empty() ? "none" : names;
+}
+
+inline void PrintUsage(std::ostream &out, const char *program)
+{
+    out << "Usage: " << program << " [options]\n"
+        << "  --backend seal|palisade|helib  run one backend (default: all built in)\n"
+        << "  --scheme bfv|bgv|ckks          HE scheme (default: bfv)\n"
+        << "  --records N                    number of velocity instances, any size, 0 = all slots of one\n"
+        << "                                 ciphertext (default: 4096)\n"
+        << "  --ring-dim N                   ring dimension (default: 8192)\n"
+        << "  --plain-modulus P              BFV/BGV plaintext modulus (default: 65537)\n"
+        << "  --depth D                      multiplicative depth (default: 1)\n"
+        << "  --scale-bits B                 CKKS scale bits (default: 40)\n"
+        << "  --params manual|auto           auto: smallest ring, plaintext modulus/scale and modulus chain\n"
+        << "                                 for --depth, --max-value, --records and --security, replacing\n"
+        << "                                 the values above (default: manual)\n"
+        << "  --security 128|192|256         auto: security level (default: 128)\n"
+        << "  --precision-bits B             auto: CKKS precision after the binary point (default: 20)\n"
+        << "  --crt K                        BFV/BGV: split every integer across K coprime plaintext moduli\n"
+        << "                                 (--plain-modulus and the next batching primes), one context\n"
+        << "                                 and thread each, joined by CRT after decryption (default: 1)\n"
+        << "  --seed S                       dataset seed (default: 1)\n"
+        << "  --max-value M                  inputs drawn from [1, M] (default: 100)\n"
+        << "  --warmup W                     untimed warm-up runs (default: 1)\n"
+        << "  --reps R                       timed repetitions of the whole run (default: 5)\n"
+        << "  --engine chunked|pipeline      chunks on a thread pool, or streamed through one stage per\n"
+        << "                                 phase with bounded queues (default: chunked)\n"
+        << "  --threads T                    chunked: threads running chunks in parallel, 0 = all cores\n"
+        << "                                 (default: 0)\n"
+        << "  --queue-depth Q                pipeline: chunks buffered between stages (default: 4)\n"
+        << "  --stage-threads E,C,V,D        pipeline: encode,encrypt,evaluate,decrypt workers (default: 1,1,1,1)\n"
+        << "  --json FILE                    write results as JSON\n"
+        << "  --csv FILE                     append results as CSV\n"
+        << "  --compression none|zlib|zstd   compression for the transport sizes (default: none)\n"
+        << "  --public NAME,...              leave initial_velocity, acc and/or times unencrypted and use\n"
+        << "                                 plaintext-ciphertext operations; also runs the all-encrypted\n"
+        << "                                 baseline and reports the speed-up and noise budget saved\n"
+        << "  --key-cache DIR                load/store contexts and keys in DIR, keyed by parameter hash\n"
+        << "  --memory-pool global|thread    SEAL: one shared memory pool, or one lock-free pool per worker\n"
+        << "                                 thread (chunked engine, --crt 1 only) (default: global)\n"
+        << "  --recycle on|off               SEAL, chunked: reuse each thread's spent plaintexts and\n"
+        << "                                 ciphertexts for the next chunk (default: on)\n"
+        << "Service mode (VelocityService):\n"
+        << "  --socket PATH                  Unix socket the evaluator listens on / clients connect to\n"
+        << "  --clients N                    0 serves until SIGINT/SIGTERM; N runs N concurrent clients of\n"
+        << "                                 --reps requests each against a running service (default: 0)\n"
+        << "  --max-batch B                  requests coalesced into one batch on the workers (default: 8)\n"
+        << "  --batch-window-us U            how long a batch waits for more requests (default: 1000)\n"
+        << "OperationBench:\n"
+        << "  --packed-requests N            small requests (8 to 64 values) packed into shared ciphertexts\n"
+        << "                                 and compared with one ciphertext each (default: 64)\n"
+        << "Sweep mode (runs every combination, comma-separated lists):\n"
+        << "  --ring-dims 4096,8192,...      ring dimensions to sweep\n"
+        << "  --depths 1,2,...               multiplicative depths to sweep\n"
+        << "  --batch-sizes 1024,0,...       record counts to sweep, 0 = all slots\n";
+}
+
+inline std::uint64_t ParseUnsigned(const std::string &flag, const std::string &value)
+{
+    std::size_t used = 0;
+    unsigned long long parsed = 0;
+    try
+    {
+        parsed = std::stoull(value, &used);
+    }
+    catch (const std::exception &)
+    {
+        used = 0;
+    }
+    if (used == 0 || used != value.size() || value[0] == '-')
+    {
+        throw std::invalid_argument("expected a non-negative integer for " + flag + ", got '" + value + "'");
+    }
+    return parsed;
+}
+
+inline std::vector<std::uint64_t> ParseList(const std::string &flag, const std::string &value)
+{
+    std::vector<std::uint64_t> list;
+    std::size_t begin = 0;
+    while (begin <= value.size())
+    {
+        std::size_t end = value.find(',', begin);
+        if (end == std::string::npos)
+        {
+            end = value.size();
+        }
+        list.push_back(ParseUnsigned(flag, value.substr(begin, end - begin)));
+        begin = end + 1;
+    }
+    return list;
+}
+
+inline bool ParseSwitch(const std::string &flag, const std::string &value)
+{
+    if (value != "on" && value != "off")
+    {
+        throw std::invalid_argument("expected on or off for " + flag + ", got '" + value + "'");
+    }
+    return value == "on";
+}
+
+inline PublicOperands ParsePublicOperands(const std::string &flag, const std::string &value)
+{
+    PublicOperands operands;
+    std::size_t begin = 0;
+    while (begin <= value.size())
+    {
+        std::size_t end = value.find(',', begin);
+        if (end == std::string::npos)
+        {
+            end = value.size();
+        }
+        std::string name = value.substr(begin, end - begin);
+        if (name == "initial_velocity")
+            operands.initial_velocity = true;
+        else if (name == "acc")
+            operands.acc = true;
+        else if (name == "times")
+            operands.times = true;
+        else if (name != "none")
+            throw std::invalid_argument("unknown operand '" + name + "' for " + flag +
+                                        ", expected initial_velocity, acc or times");
+        begin = end + 1;
+    }
+    return operands;
+}
+
+inline BenchConfig ParseBenchConfig(int argc, char *argv[])
+{
+    BenchConfig config;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string flag = argv[i];
+        if (flag == "--help" || flag == "-h")
+        {
+            PrintUsage(std::cout, argv[0]);
+            std::exit(0);
+        }
+        if (i + 1 >= argc)
+        {
+            throw std::invalid_argument("missing value for " + flag);
+        }
+        std::string value = argv[++i];
+
+        if (flag == "--backend")
+            config.backend = value;
+        else if (flag == "--scheme")
+            config.scheme = value;
+        else if (flag == "--records")
+            config.records = ParseUnsigned(flag, value);
+        else if (flag == "--ring-dim")
+            config.ring_dim = ParseUnsigned(flag, value);
+        else if (flag == "--plain-modulus")
+            config.plain_modulus = ParseUnsigned(flag, value);
+        else if (flag == "--depth")
+            config.depth = static_cast<std::uint32_t>(ParseUnsigned(flag, value));
+        else if (flag == "--scale-bits")
+            config.scale_bits = static_cast<std::uint32_t>(ParseUnsigned(flag, value));
+        else if (flag == "--params")
+            config.params = value;
+        else if (flag == "--security")
+            config.security = static_cast<std::uint32_t>(ParseUnsigned(flag, value));
+        else if (flag == "--precision-bits")
+            config.precision_bits = static_cast<std::uint32_t>(ParseUnsigned(flag, value));
+        else if (flag == "--crt")
+            config.crt = ParseUnsigned(flag, value);
+        else if (flag == "--seed")
+            config.seed = static_cast<std::uint32_t>(ParseUnsigned(flag, value));
+        else if (flag == "--max-value")
+            config.max_value = static_cast<std::int64_t>(ParseUnsigned(flag, value));
+        else if (flag == "--warmup")
+            config.warmup = ParseUnsigned(flag, value);
+        else if (flag == "--reps")
+            config.reps = ParseUnsigned(flag, value);
+        else if (flag == "--engine")
+            config.engine = value;
+        else if (flag == "--threads")
+            config.threads = ParseUnsigned(flag, value);
+        else if (flag == "--queue-depth")
+            config.queue_depth = ParseUnsigned(flag, value);
+        else if (flag == "--stage-threads")
+            config.stage_threads = ParseList(flag, value);
+        else if (flag == "--ring-dims")
+            config.sweep_ring_dims = ParseList(flag, value);
+        else if (flag == "--depths")
+            config.sweep_depths = ParseList(flag, value);
+        else if (flag == "--batch-sizes")
+            config.sweep_records = ParseList(flag, value);
+        else if (flag == "--json")
+            config.json_path = value;
+        else if (flag == "--csv")
+            config.csv_path = value;
+        else if (flag == "--key-cache")
+            config.key_cache = value;
+        else if (flag == "--compression")
+            config.compression = value;
+        else if (flag == "--public")
+            config.public_operands = ParsePublicOperands(flag, value);
+        else if (flag == "--memory-pool")
+            config.memory_pool = value;
+        else if (flag == "--recycle")
+            config.recycle = ParseSwitch(flag, value);
+        else if (flag == "--socket")
+            config.socket_path = value;
+        else if (flag == "--clients")
+            config.clients = ParseUnsigned(flag, value);
+        else if (flag == "--max-batch")
+            config.max_batch = ParseUnsigned(flag, value);
+        else if (flag == "--batch-window-us")
+            config.batch_window_us = ParseUnsigned(flag, value);
+        else if (flag == "--packed-requests")
+            config.packed_requests = ParseUnsigned(flag, value);
+        else
+            throw std::invalid_argument("unknown option " + flag);
+    }
+
+    if (config.scheme != "bfv" && config.scheme != "bgv" && config.scheme != "ckks")
+    {
+        throw std::invalid_argument("unknown scheme " + config.scheme);
+    }
+    if (config.max_value < 1 || config.depth == 0 || config.reps == 0)
+    {
+        throw std::invalid_argument("--max-value, --depth and --reps must be positive");
+    }
+    if (config.params != "manual" && config.params != "auto")
+    {
+        throw std::invalid_argument("unknown --params " + config.params + ", expected manual or auto");
+    }
+    if (config.security != 128 && config.security != 192 && config.security != 256)
+    {
+        throw std::invalid_argument("--security must be 128, 192 or 256");
+    }
+    if (config.crt == 0 || (config.crt > 1 && config.scheme == "ckks"))
+    {
+        throw std::invalid_argument("--crt must be positive, and above 1 only for bfv or bgv");
+    }
+    if (config.params == "auto" && !config.sweep_ring_dims.empty())
+    {
+        throw std::invalid_argument("--params auto chooses the ring dimension, drop --ring-dims");
+    }
+    if (!IsKnownCompression(config.compression))
+    {
+        throw std::invalid_argument("unknown compression " + config.compression);
+    }
+    if (config.public_operands.acc && config.public_operands.times)
+    {
+        throw std::invalid_argument("acc and times cannot both be public: at least one factor of at must be encrypted");
+    }
+    if (config.engine != "chunked" && config.engine != "pipeline")
+    {
+        throw std::invalid_argument("unknown engine " + config.engine);
+    }
+    if (config.memory_pool != "global" && config.memory_pool != "thread")
+    {
+        throw std::invalid_argument("unknown --memory-pool " + config.memory_pool + ", expected global or thread");
+    }
+    // A thread's pool must free what it allocated; pipeline stages and CRT
+    // residue threads hand objects to other threads.
+    if (config.memory_pool == "thread" && (config.engine != "chunked" || config.crt > 1))
+    {
+        throw std::invalid_argument("--memory-pool thread needs --engine chunked and --crt 1");
+    }
+    if (config.queue_depth == 0 || config.max_batch == 0 || config.packed_requests == 0)
+    {
+        throw std::invalid_argument("--queue-depth, --max-batch and --packed-requests must be positive");
+    }
+    if (config.stage_threads.size() != 4 ||
+        std::count(config.stage_threads.begin(), config.stage_threads.end(), std::uint64_t(0)) != 0)
+    {
+        throw std::invalid_argument("--stage-threads takes four positive counts: encode,encrypt,evaluate,decrypt");
+    }
+    for (std::uint64_t value : config.sweep_ring_dims)
+    {
+        if (value == 0)
+        {
+            throw std::invalid_argument("--ring-dims entries must be positive");
+        }
+    }
+    for (std::uint64_t value : config.sweep_depths)
+    {
+        if (value == 0)
+        {
+            throw std::invalid_argument("--depths entries must be positive");
+        }
+    }
+    return config;
+}
+
+} // namespace hebench
@@ -0,0 +1,170 @@
+/****************************************************/
+/* Bounded lock-free MPMC queue                     */
+/* Ring of sequence-numbered cells (D. Vyukov's     */
+/* bounded queue); push/pop back off when the ring  */
+/* is full/empty, close() ends the stream           */
+/****************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+namespace hebench
+{
+
+template <typename T>
+class BoundedQueue
+{
+public:
+    // capacity is rounded up to a power of two, at least 2: with a single
+    // cell a full slot's sequence would look free to the next producer.
+    explicit BoundedQueue(std::size_t capacity)
+    {
+        std::size_t size = 2;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        mask_ = size - 1;
+        cells_.reset(new Cell[size]);
+        for (std::size_t i = 0; i < size; i++)
+        {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    std::size_t capacity() const
+    {
+        return mask_ + 1;
+    }
+
+    bool try_push(T &value)
+    {
+        std::size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell &cell = cells_[pos & mask_];
+            std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0)
+            {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // full
+            }
+            else
+            {
+                pos = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool try_pop(T &value)
+    {
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell &cell = cells_[pos & mask_];
+            std::size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    value = std::move(cell.value);
+                    cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // empty
+            }
+            else
+            {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Blocks while the queue is full. Pushing after close() is a logic error.
+    void push(T value)
+    {
+        if (closed_.load(std::memory_order_acquire))
+        {
+            throw std::logic_error("push to a closed queue");
+        }
+        for (unsigned spins = 0; !try_push(value); spins++)
+        {
+            Backoff(spins);
+        }
+    }
+
+    // Blocks while the queue is empty; false once it is closed and drained.
+    bool pop(T &value)
+    {
+        for (unsigned spins = 0;; spins++)
+        {
+            if (try_pop(value))
+            {
+                return true;
+            }
+            if (closed_.load(std::memory_order_acquire))
+            {
+                // A push may have landed between the failed pop and close().
+                return try_pop(value);
+            }
+            Backoff(spins);
+        }
+    }
+
+    void close()
+    {
+        closed_.store(true, std::memory_order_release);
+    }
+
+private:
+    // HE stages take milliseconds per item, so after a short spin a waiting
+    // worker sleeps instead of burning a core another stage could use.
+    static void Backoff(unsigned spins)
+    {
+        if (spins < 64)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    std::size_t mask_ = 0;
+    alignas(64) std::atomic<std::size_t> tail_{ 0 };
+    alignas(64) std::atomic<std::size_t> head_{ 0 };
+    std::atomic<bool> closed_{ false };
+};
+
+} // namespace hebench
@@ -0,0 +1,97 @@
+/****************************************************/
+/* Chunked multi-ciphertext velocity engine         */
+/* Splits an input of any length into slot-sized    */
+/* chunks and runs encode .. decrypt for each chunk */
+/* on a thread pool sharing one context and key set */
+/****************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+#include "HERecycler.h"
+#include "HETimer.h"
+#include "ThreadPool.h"
+#include "VelocityData.h"
+
+namespace hebench
+{
+
+// Records [begin, end) of data.
+inline VelocityData SliceVelocityData(const VelocityData &data, std::size_t begin, std::size_t end)
+{
+    VelocityData slice;
+    slice.initial_velocity.assign(data.initial_velocity.begin() + begin, data.initial_velocity.begin() + end);
+    slice.acc.assign(data.acc.begin() + begin, data.acc.begin() + end);
+    slice.times.assign(data.times.begin() + begin, data.times.begin() + end);
+    return slice;
+}
+
+// Backend must be keyed and its encode/encrypt/evaluate/decrypt safe to call
+// concurrently (they are const and only read the shared context and keys).
+template <typename Backend>
+class ChunkedEngine
+{
+public:
+    ChunkedEngine(const Backend &backend, ThreadPool &pool) : backend_(backend), pool_(pool)
+    {}
+
+    std::size_t chunk_size() const
+    {
+        return backend_.slot_count();
+    }
+
+    std::size_t chunk_count(std::size_t records) const
+    {
+        return (records + chunk_size() - 1) / chunk_size();
+    }
+
+    // Final velocities of every record, in input order. Each chunk's phases
+    // are recorded in timer as one sample per chunk (encode, encrypt,
+    // evaluate, decrypt), so percentiles are per-chunk latencies. With
+    // several chunks on several threads their memory fields are
+    // process-wide; time the whole run for the chunks' own heap use.
+    std::vector<double> run(const VelocityData &data, HETimer &timer) const
+    {
+        std::vector<double> final_vel(data.size());
+        bool concurrent = pool_.size() > 1 && chunk_count(data.size()) > 1;
+        pool_.parallel_for(chunk_count(data.size()), [&](std::size_t chunk) {
+            std::size_t begin = chunk * chunk_size();
+            std::size_t end = std::min(begin + chunk_size(), data.size());
+            VelocityData slice = SliceVelocityData(data, begin, end);
+
+            Stopwatch stopwatch;
+            auto encoded = backend_.encode(slice);
+            timer.record("encode", stopwatch.elapsed(concurrent));
+
+            stopwatch.start();
+            auto encrypted = backend_.encrypt(encoded);
+            timer.record("encrypt", stopwatch.elapsed(concurrent));
+
+            stopwatch.start();
+            auto result = backend_.evaluate(encrypted);
+            timer.record("evaluate", stopwatch.elapsed(concurrent));
+
+            stopwatch.start();
+            std::vector<double> decrypted = backend_.decrypt(result, slice.size());
+            timer.record("decrypt", stopwatch.elapsed(concurrent));
+
+            std::copy(decrypted.begin(), decrypted.end(), final_vel.begin() + begin);
+
+            // The chunk's objects go back to the backend on the thread that
+            // made them, for the next chunk this thread runs.
+            RecycleWith(backend_, std::move(result));
+            RecycleWith(backend_, std::move(encrypted));
+            RecycleWith(backend_, std::move(encoded));
+        });
+        return final_vel;
+    }
+
+private:
+    const Backend &backend_;
+    ThreadPool &pool_;
+};
+
+} // namespace hebench
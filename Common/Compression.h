@@ -0,0 +1,74 @@
+/****************************************************/
+/* Byte-stream compression for transport sizes      */
+/* zlib (HEBENCH_WITH_ZLIB) and zstd                */
+/* (HEBENCH_WITH_ZSTD) for libraries without their  */
+/* own compressed serialization                     */
+/****************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#ifdef HEBENCH_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HEBENCH_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+namespace hebench
+{
+
+// Names --compression accepts; CompressedBytes rejects the ones not built in.
+inline bool IsKnownCompression(const std::string &compression)
+{
+    return compression == "none" || compression == "zlib" || compression == "zstd";
+}
+
+// Size of bytes after compression ("none", "zlib" or "zstd").
+inline std::uint64_t CompressedBytes(const std::string &bytes, const std::string &compression)
+{
+    if (compression == "none")
+    {
+        return bytes.size();
+    }
+#ifdef HEBENCH_WITH_ZLIB
+    if (compression == "zlib")
+    {
+        uLongf size = compressBound(static_cast<uLong>(bytes.size()));
+        std::string out(size, '\0');
+        if (compress2(reinterpret_cast<Bytef *>(&out[0]), &size, reinterpret_cast<const Bytef *>(bytes.data()),
+                      static_cast<uLong>(bytes.size()), Z_BEST_COMPRESSION) != Z_OK)
+        {
+            throw std::runtime_error("zlib compression failed");
+        }
+        return size;
+    }
+#endif
+#ifdef HEBENCH_WITH_ZSTD
+    if (compression == "zstd")
+    {
+        std::string out(ZSTD_compressBound(bytes.size()), '\0');
+        std::size_t size = ZSTD_compress(&out[0], out.size(), bytes.data(), bytes.size(), ZSTD_CLEVEL_DEFAULT);
+        if (ZSTD_isError(size))
+        {
+            throw std::runtime_error(std::string("zstd compression failed: ") + ZSTD_getErrorName(size));
+        }
+        return size;
+    }
+#endif
+    throw std::invalid_argument("compression " + compression + " is not available in this build");
+}
+
+// Serializes with write(std::ostream &) and returns the compressed size.
+template <typename F>
+std::uint64_t CompressedSerializedBytes(const std::string &compression, F &&write)
+{
+    std::ostringstream out;
+    write(out);
+    return CompressedBytes(out.str(), compression);
+}
+
+} // namespace hebench
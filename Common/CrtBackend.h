@@ -0,0 +1,345 @@
+/****************************************************/
+/* CRT-split wide-integer backend                   */
+/* Runs BFV/BGV once per coprime batching plaintext */
+/* modulus, the residues in parallel, and joins the */
+/* decrypted residues by the Chinese remainder      */
+/* theorem into one range of prod(t_i)              */
+/****************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "BenchConfig.h"
+#include "HEMemory.h"
+#include "HERecycler.h"
+#include "ThreadPool.h"
+#include "VelocityData.h"
+
+namespace hebench
+{
+
+// Joins residues x mod t_i into x mod prod(t_i) (Garner's mixed-radix
+// form), centered, so results in (-prod/2, prod/2) come back exactly as
+// 128-bit integers; only the caller's conversion to double rounds them.
+class CrtJoiner
+{
+public:
+    explicit CrtJoiner(const std::vector<std::uint64_t> &moduli) : moduli_(moduli)
+    {
+        if (moduli.empty())
+        {
+            throw std::invalid_argument("CRT needs at least one plaintext modulus");
+        }
+        unsigned __int128 product = 1;
+        for (std::size_t i = 0; i < moduli.size(); i++)
+        {
+            std::uint64_t t = moduli[i];
+            // Residues arrive as doubles, so each t_i must be exact in one.
+            if (t < 2 || t >= (std::uint64_t(1) << 53) || product > (~static_cast<unsigned __int128>(0) >> 2) / t)
+            {
+                throw std::invalid_argument("CRT plaintext moduli must each fit 53 bits and together 126 bits");
+            }
+            // Inverse of t_0 * ... * t_{i-1} mod t_i; the moduli are prime.
+            std::uint64_t prefix = static_cast<std::uint64_t>(product % t);
+            if (prefix == 0)
+            {
+                throw std::invalid_argument("CRT plaintext moduli must be distinct primes");
+            }
+            inverses_.push_back(PowMod(prefix, t - 2, t));
+            product *= t;
+        }
+        product_ = product;
+    }
+
+    const std::vector<std::uint64_t> &moduli() const
+    {
+        return moduli_;
+    }
+
+    // log2 of prod(t_i): the result range is about this many bits, sign included.
+    double bits() const
+    {
+        double bits = 0;
+        for (std::uint64_t t : moduli_)
+        {
+            bits += std::log2(static_cast<double>(t));
+        }
+        return bits;
+    }
+
+    // residues[i] is x mod moduli()[i], any representative.
+    __int128 join(const std::vector<double> &residues) const
+    {
+        unsigned __int128 x = 0;
+        unsigned __int128 prefix = 1;
+        for (std::size_t i = 0; i < moduli_.size(); i++)
+        {
+            std::uint64_t t = moduli_[i];
+            std::uint64_t r = Reduce(residues[i], t);
+            std::uint64_t digit = MulMod(r + t - static_cast<std::uint64_t>(x % t), inverses_[i], t);
+            x += prefix * digit;
+            prefix *= t;
+        }
+        return x > product_ / 2 ? -static_cast<__int128>(product_ - x) : static_cast<__int128>(x);
+    }
+
+private:
+    static std::uint64_t MulMod(std::uint64_t a, std::uint64_t b, std::uint64_t t)
+    {
+        return static_cast<std::uint64_t>(static_cast<unsigned __int128>(a) * b % t);
+    }
+
+    static std::uint64_t PowMod(std::uint64_t base, std::uint64_t e, std::uint64_t t)
+    {
+        std::uint64_t result = 1;
+        for (; e; e >>= 1)
+        {
+            if (e & 1)
+                result = MulMod(result, base, t);
+            base = MulMod(base, base, t);
+        }
+        return result;
+    }
+
+    // Backends decrypt to [0, t) (SEAL, HElib) or centered (PALISADE).
+    static std::uint64_t Reduce(double value, std::uint64_t t)
+    {
+        std::int64_t r = std::llround(value) % static_cast<std::int64_t>(t);
+        return static_cast<std::uint64_t>(r < 0 ? r + static_cast<std::int64_t>(t) : r);
+    }
+
+    std::vector<std::uint64_t> moduli_;
+    std::vector<std::uint64_t> inverses_;
+    unsigned __int128 product_ = 1;
+};
+
+// The backend interface over one Inner backend per CRT plaintext modulus
+// (CrtPlainModuli), so the chunked and pipeline engines run it unchanged.
+// Each residue context has its own keys. Contexts and keys are built one
+// residue after another, since PALISADE registers both in unlocked static
+// tables; encode, encrypt, evaluate and decrypt run the residues on their
+// own threads. Ring dimension and slots are those of one context, so a
+// wider range costs more cores rather than a bigger ring.
+template <typename Inner>
+class CrtBackend
+{
+public:
+    using Encoded = std::vector<typename Inner::Encoded>;
+    using Encrypted = std::vector<typename Inner::Encrypted>;
+    using Result = std::vector<typename Inner::Result>;
+
+    static const char *Name()
+    {
+        return Inner::Name();
+    }
+
+    static bool Supports(const std::string &scheme)
+    {
+        return scheme != "ckks" && Inner::Supports(scheme);
+    }
+
+    explicit CrtBackend(const BenchConfig &config) : joiner_(CrtPlainModuli(config)), pool_(joiner_.moduli().size())
+    {
+        if (!Supports(config.scheme))
+        {
+            throw std::invalid_argument("CRT splitting needs an exact integer scheme (bfv or bgv), got " + config.scheme);
+        }
+        for (std::uint64_t t : joiner_.moduli())
+        {
+            BenchConfig residue = config;
+            residue.plain_modulus = t;
+            residue.crt = 1;
+            residues_.emplace_back(new Inner(residue));
+        }
+    }
+
+    void keygen()
+    {
+        for (auto &residue : residues_)
+        {
+            residue->keygen();
+        }
+    }
+
+    // The residues' common status, "mixed" if the cache held only some.
+    const char *key_cache_status() const
+    {
+        const char *status = residues_[0]->key_cache_status();
+        for (const auto &residue : residues_)
+        {
+            if (std::string(residue->key_cache_status()) != status)
+                return "mixed";
+        }
+        return status;
+    }
+
+    std::string scheme() const
+    {
+        return residues_[0]->scheme();
+    }
+
+    std::size_t ring_dimension() const
+    {
+        return residues_[0]->ring_dimension();
+    }
+
+    std::size_t slot_count() const
+    {
+        return residues_[0]->slot_count();
+    }
+
+    const std::vector<std::uint64_t> &moduli() const
+    {
+        return joiner_.moduli();
+    }
+
+    /*****Encode*****/
+    // Inputs are reduced to centered residues here, so every inner backend
+    // sees values below its own modulus.
+    Encoded encode(const VelocityData &data) const
+    {
+        return each<typename Inner::Encoded>([&](std::size_t i) {
+            std::int64_t t = static_cast<std::int64_t>(moduli()[i]);
+            auto reduce = [t](std::vector<std::int64_t> &values) {
+                for (std::int64_t &value : values)
+                {
+                    value %= t;
+                    if (value > t / 2)
+                        value -= t;
+                    else if (value < -(t / 2))
+                        value += t;
+                }
+            };
+            VelocityData residue = data;
+            reduce(residue.initial_velocity);
+            reduce(residue.acc);
+            reduce(residue.times);
+            return residues_[i]->encode(residue);
+        });
+    }
+
+    /*****Encrypt*****/
+    Encrypted encrypt(const Encoded &encoded) const
+    {
+        return each<typename Inner::Encrypted>([&](std::size_t i) { return residues_[i]->encrypt(encoded[i]); });
+    }
+
+    /*****Evaluate*****/
+    Result evaluate(const Encrypted &encrypted) const
+    {
+        return each<typename Inner::Result>([&](std::size_t i) { return residues_[i]->evaluate(encrypted[i]); });
+    }
+
+    /*****Decrypt and Recombine*****/
+    // Joined exactly; the double the backend interface returns is only
+    // exact up to 2^53, past that it is compared rounded.
+    std::vector<double> decrypt(const Result &result, std::size_t n) const
+    {
+        std::vector<std::vector<double>> decrypted =
+            each<std::vector<double>>([&](std::size_t i) { return residues_[i]->decrypt(result[i], n); });
+
+        std::vector<double> final_vel(n);
+        std::vector<double> slot(residues_.size());
+        for (std::size_t j = 0; j < n; j++)
+        {
+            for (std::size_t i = 0; i < residues_.size(); i++)
+            {
+                slot[i] = decrypted[i][j];
+            }
+            final_vel[j] = static_cast<double>(joiner_.join(slot));
+        }
+        return final_vel;
+    }
+
+    /*****Recycle*****/
+    // Each residue's part back to its backend, if it recycles (HERecycler.h).
+    template <typename Part>
+    void recycle(std::vector<Part> &&parts) const
+    {
+        pool_.parallel_for(parts.size(), [&](std::size_t i) { RecycleWith(*residues_[i], std::move(parts[i])); });
+    }
+
+    /*****Noise Budget*****/
+    // The tightest residue; -1 if the library does not report it.
+    int noise_budget_bits(const Result &result) const
+    {
+        int budget = residues_[0]->noise_budget_bits(result[0]);
+        for (std::size_t i = 1; i < residues_.size(); i++)
+        {
+            budget = std::min(budget, residues_[i]->noise_budget_bits(result[i]));
+        }
+        return budget;
+    }
+
+    /*****Object Sizes*****/
+    // Totals over the residues: the client holds and exchanges all of them.
+    std::vector<ObjectSize> object_sizes(const Encrypted &encrypted, const Result &result) const
+    {
+        return total([&](std::size_t i) { return residues_[i]->object_sizes(encrypted[i], result[i]); });
+    }
+
+    std::vector<ObjectSize> transport_sizes(const Encoded &encoded, const Result &result,
+                                            const std::string &compression) const
+    {
+        return total([&](std::size_t i) { return residues_[i]->transport_sizes(encoded[i], result[i], compression); });
+    }
+
+private:
+    // f(i) for every residue, on the pool. Built through pointers because
+    // some libraries' ciphertexts (HElib's Ctxt) have no default constructor.
+    template <typename T, typename F>
+    std::vector<T> each(F f) const
+    {
+        std::vector<std::unique_ptr<T>> parts(residues_.size());
+        pool_.parallel_for(residues_.size(), [&](std::size_t i) { parts[i].reset(new T(f(i))); });
+        std::vector<T> values;
+        values.reserve(parts.size());
+        for (auto &part : parts)
+        {
+            values.push_back(std::move(*part));
+        }
+        return values;
+    }
+
+    template <typename Sizes>
+    std::vector<ObjectSize> total(Sizes sizes_of) const
+    {
+        std::vector<ObjectSize> sizes = sizes_of(0);
+        std::map<std::string, std::size_t> index;
+        for (std::size_t k = 0; k < sizes.size(); k++)
+        {
+            index[sizes[k].name] = k;
+        }
+        for (std::size_t i = 1; i < residues_.size(); i++)
+        {
+            for (const ObjectSize &size : sizes_of(i))
+            {
+                auto found = index.find(size.name);
+                if (found == index.end())
+                {
+                    index[size.name] = sizes.size();
+                    sizes.push_back(size);
+                }
+                else
+                {
+                    sizes[found->second].bytes += size.bytes;
+                }
+            }
+        }
+        return sizes;
+    }
+
+    CrtJoiner joiner_;
+    std::vector<std::unique_ptr<Inner>> residues_;
+    mutable ThreadPool pool_;
+};
+
+} // namespace hebench
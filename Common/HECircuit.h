@@ -0,0 +1,676 @@
+/****************************************************/
+/* Circuit expressions for the generic HE interface */
+/* Formulas written with + and * are planned for    */
+/* minimal multiplicative depth, with common        */
+/* subexpressions merged, relinearize, rescale and  */
+/* level alignment inserted, and independent nodes  */
+/* evaluated in parallel on any Scheme              */
+/****************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "ThreadPool.h"
+
+namespace hebench
+{
+
+enum class CircuitOp
+{
+    Input,
+    Constant,
+    Add,
+    Multiply,
+    Rotate
+};
+
+struct CircuitNode
+{
+    CircuitOp op = CircuitOp::Input;
+    std::size_t lhs = 0; // Add, Multiply, Rotate
+    std::size_t rhs = 0; // Add, Multiply
+    std::string name;    // Input
+    double value = 0;    // Constant, the same in every slot
+    int step = 0;        // Rotate, left by step slots
+
+    bool leaf() const
+    {
+        return op == CircuitOp::Input || op == CircuitOp::Constant;
+    }
+};
+
+class Circuit;
+
+// A node of a Circuit; +, * and Rotate on it add nodes to the same circuit.
+class CircuitExpr
+{
+public:
+    CircuitExpr(Circuit &circuit, std::size_t node) : circuit_(&circuit), node_(node)
+    {}
+
+    Circuit &circuit() const
+    {
+        return *circuit_;
+    }
+
+    std::size_t node() const
+    {
+        return node_;
+    }
+
+private:
+    Circuit *circuit_;
+    std::size_t node_;
+};
+
+// Expression graph as written. Nodes are hash-consed: building an operation
+// that already exists (operands of + and * in either order) returns the
+// existing node, so repeated subexpressions are evaluated once. Operations
+// on constants alone are folded, x + 0 and x * 1 are x.
+class Circuit
+{
+public:
+    CircuitExpr input(const std::string &name)
+    {
+        CircuitNode node;
+        node.name = name;
+        return intern(node);
+    }
+
+    CircuitExpr constant(double value)
+    {
+        CircuitNode node;
+        node.op = CircuitOp::Constant;
+        node.value = value;
+        return intern(node);
+    }
+
+    CircuitExpr add(CircuitExpr a, CircuitExpr b)
+    {
+        return binary(CircuitOp::Add, a, b);
+    }
+
+    CircuitExpr multiply(CircuitExpr a, CircuitExpr b)
+    {
+        return binary(CircuitOp::Multiply, a, b);
+    }
+
+    CircuitExpr rotate(CircuitExpr a, int step)
+    {
+        check_owner(a);
+        const CircuitNode &operand = nodes_[a.node()];
+        if (step == 0 || operand.op == CircuitOp::Constant)
+        {
+            return a;
+        }
+        CircuitNode node;
+        node.op = CircuitOp::Rotate;
+        node.lhs = a.node();
+        node.step = step;
+        return intern(node);
+    }
+
+    void output(const std::string &name, CircuitExpr e)
+    {
+        check_owner(e);
+        outputs_.push_back({ name, e.node() });
+    }
+
+    const std::vector<CircuitNode> &nodes() const
+    {
+        return nodes_;
+    }
+
+    const std::vector<std::pair<std::string, std::size_t>> &outputs() const
+    {
+        return outputs_;
+    }
+
+    // Operations built more than once and merged into one node.
+    std::size_t merged() const
+    {
+        return merged_;
+    }
+
+private:
+    CircuitExpr binary(CircuitOp op, CircuitExpr a, CircuitExpr b)
+    {
+        check_owner(a);
+        check_owner(b);
+        const CircuitNode &x = nodes_[a.node()];
+        const CircuitNode &y = nodes_[b.node()];
+        bool add = op == CircuitOp::Add;
+        if (x.op == CircuitOp::Constant && y.op == CircuitOp::Constant)
+        {
+            return constant(add ? x.value + y.value : x.value * y.value);
+        }
+        double identity = add ? 0 : 1;
+        if (x.op == CircuitOp::Constant && x.value == identity)
+            return b;
+        if (y.op == CircuitOp::Constant && y.value == identity)
+            return a;
+
+        CircuitNode node;
+        node.op = op;
+        node.lhs = std::min(a.node(), b.node());
+        node.rhs = std::max(a.node(), b.node());
+        return intern(node);
+    }
+
+    CircuitExpr intern(const CircuitNode &node)
+    {
+        auto key = std::make_tuple(static_cast<int>(node.op), node.lhs, node.rhs, node.name, node.value, node.step);
+        auto found = index_.find(key);
+        if (found != index_.end())
+        {
+            if (!node.leaf())
+                merged_++;
+            return CircuitExpr(*this, found->second);
+        }
+        nodes_.push_back(node);
+        index_[key] = nodes_.size() - 1;
+        return CircuitExpr(*this, nodes_.size() - 1);
+    }
+
+    void check_owner(CircuitExpr e) const
+    {
+        if (&e.circuit() != this)
+        {
+            throw std::invalid_argument("circuit expressions from different circuits cannot be combined");
+        }
+    }
+
+    std::vector<CircuitNode> nodes_;
+    std::map<std::tuple<int, std::size_t, std::size_t, std::string, double, int>, std::size_t> index_;
+    std::vector<std::pair<std::string, std::size_t>> outputs_;
+    std::size_t merged_ = 0;
+};
+
+inline CircuitExpr operator+(CircuitExpr a, CircuitExpr b)
+{
+    return a.circuit().add(a, b);
+}
+
+inline CircuitExpr operator*(CircuitExpr a, CircuitExpr b)
+{
+    return a.circuit().multiply(a, b);
+}
+
+inline CircuitExpr operator+(CircuitExpr a, double c)
+{
+    return a + a.circuit().constant(c);
+}
+
+inline CircuitExpr operator+(double c, CircuitExpr a)
+{
+    return a + a.circuit().constant(c);
+}
+
+inline CircuitExpr operator*(CircuitExpr a, double c)
+{
+    return a * a.circuit().constant(c);
+}
+
+inline CircuitExpr operator*(double c, CircuitExpr a)
+{
+    return a * a.circuit().constant(c);
+}
+
+inline CircuitExpr Rotate(CircuitExpr a, int step)
+{
+    return a.circuit().rotate(a, step);
+}
+
+// x^n by squaring: depth ceil(log2 n), squares shared through the circuit.
+inline CircuitExpr Pow(CircuitExpr x, unsigned n)
+{
+    if (n == 0)
+    {
+        return x.circuit().constant(1);
+    }
+    if (n == 1)
+    {
+        return x;
+    }
+    CircuitExpr half = Pow(x, n / 2);
+    CircuitExpr square = half * half;
+    return n % 2 ? square * x : square;
+}
+
+/*****Plan*****/
+// Nodes in evaluation order, only those the outputs need.
+struct CircuitPlan
+{
+    std::vector<CircuitNode> nodes;
+    std::vector<std::size_t> depth;             // multiplications on the longest path to each node
+    std::vector<bool> relinearize;              // relinearize right after computing the node
+    std::vector<std::vector<std::size_t>> waves; // operations whose operands are all ready, wave by wave
+    std::vector<std::size_t> last_wave;         // last wave reading each node
+    std::vector<std::pair<std::string, std::size_t>> outputs;
+    std::map<std::string, std::size_t> input_levels; // level to encode each input at (Scheme::encode)
+    std::size_t written_depth = 0;              // depth of the circuit as written
+    std::size_t merged = 0;                     // repeated subexpressions evaluated once
+
+    std::size_t max_depth() const
+    {
+        std::size_t max = 0;
+        for (const auto &output : outputs)
+        {
+            max = std::max(max, depth[output.second]);
+        }
+        return max;
+    }
+
+    std::size_t operation_count() const
+    {
+        std::size_t count = 0;
+        for (const auto &wave : waves)
+        {
+            count += wave.size();
+        }
+        return count;
+    }
+};
+
+namespace detail
+{
+
+inline std::size_t NodeDepth(const std::vector<std::size_t> &depth, const CircuitNode &node)
+{
+    switch (node.op)
+    {
+    case CircuitOp::Add:
+        return std::max(depth[node.lhs], depth[node.rhs]);
+    case CircuitOp::Multiply:
+        return std::max(depth[node.lhs], depth[node.rhs]) + 1;
+    case CircuitOp::Rotate:
+        return depth[node.lhs];
+    default:
+        return 0;
+    }
+}
+
+inline std::vector<std::size_t> Depths(const std::vector<CircuitNode> &nodes)
+{
+    std::vector<std::size_t> depth(nodes.size(), 0);
+    for (std::size_t i = 0; i < nodes.size(); i++)
+    {
+        depth[i] = NodeDepth(depth, nodes[i]);
+    }
+    return depth;
+}
+
+// Copies written's outputs into planned. A chain of one operation (a*b*c*d
+// as written, or any nesting of +) is flattened into its operands, unless
+// an inner node is shared or an output, and rebuilt by always combining
+// the two shallowest operands: a left-deep product of n factors drops from
+// depth n-1 to ceil(log2 n).
+class Rebalancer
+{
+public:
+    Rebalancer(const Circuit &written, Circuit &planned) : written_(written), planned_(planned)
+    {
+        const std::vector<CircuitNode> &nodes = written.nodes();
+        uses_.assign(nodes.size(), 0);
+        for (const auto &output : written.outputs())
+        {
+            uses_[output.second]++;
+        }
+        for (const CircuitNode &node : nodes)
+        {
+            if (node.op == CircuitOp::Add || node.op == CircuitOp::Multiply)
+            {
+                uses_[node.lhs]++;
+                uses_[node.rhs]++;
+            }
+            else if (node.op == CircuitOp::Rotate)
+            {
+                uses_[node.lhs]++;
+            }
+        }
+        lowered_.assign(nodes.size(), npos);
+    }
+
+    std::size_t lower(std::size_t i)
+    {
+        if (lowered_[i] != npos)
+        {
+            return lowered_[i];
+        }
+        const CircuitNode &node = written_.nodes()[i];
+        std::size_t result;
+        if (node.op == CircuitOp::Input)
+            result = planned_.input(node.name).node();
+        else if (node.op == CircuitOp::Constant)
+            result = planned_.constant(node.value).node();
+        else if (node.op == CircuitOp::Rotate)
+            result = planned_.rotate(CircuitExpr(planned_, lower(node.lhs)), node.step).node();
+        else
+            result = combine(node.op, flatten(i));
+        lowered_[i] = result;
+        return result;
+    }
+
+private:
+    static constexpr std::size_t npos = ~std::size_t(0);
+
+    // Operands of the same-op chain rooted at i, as written-circuit nodes.
+    std::vector<std::size_t> flatten(std::size_t root) const
+    {
+        CircuitOp op = written_.nodes()[root].op;
+        std::vector<std::size_t> operands;
+        std::vector<std::size_t> stack{ written_.nodes()[root].rhs, written_.nodes()[root].lhs };
+        while (!stack.empty())
+        {
+            std::size_t i = stack.back();
+            stack.pop_back();
+            const CircuitNode &node = written_.nodes()[i];
+            if (node.op == op && uses_[i] == 1)
+            {
+                stack.push_back(node.rhs);
+                stack.push_back(node.lhs);
+            }
+            else
+            {
+                operands.push_back(i);
+            }
+        }
+        return operands;
+    }
+
+    std::size_t combine(CircuitOp op, const std::vector<std::size_t> &operands)
+    {
+        using Entry = std::pair<std::size_t, std::size_t>; // (depth, planned node)
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> shallowest;
+        for (std::size_t operand : operands)
+        {
+            std::size_t node = lower(operand);
+            shallowest.push({ depth_of(node), node });
+        }
+        while (shallowest.size() > 1)
+        {
+            CircuitExpr a(planned_, shallowest.top().second);
+            shallowest.pop();
+            CircuitExpr b(planned_, shallowest.top().second);
+            shallowest.pop();
+            std::size_t node = (op == CircuitOp::Add ? planned_.add(a, b) : planned_.multiply(a, b)).node();
+            shallowest.push({ depth_of(node), node });
+        }
+        return shallowest.top().second;
+    }
+
+    std::size_t depth_of(std::size_t node)
+    {
+        const std::vector<CircuitNode> &nodes = planned_.nodes();
+        for (std::size_t i = depth_.size(); i < nodes.size(); i++)
+        {
+            depth_.push_back(NodeDepth(depth_, nodes[i]));
+        }
+        return depth_[node];
+    }
+
+    const Circuit &written_;
+    Circuit &planned_;
+    std::vector<std::size_t> uses_;
+    std::vector<std::size_t> lowered_;
+    std::vector<std::size_t> depth_;
+};
+
+} // namespace detail
+
+// Rebalances for depth, merges common subexpressions, drops what no output
+// needs, and schedules:
+//   - a product is relinearized only where it is multiplied or rotated
+//     again or output, so a sum of products pays one key switch;
+//   - each input is encoded at the shallowest level it is consumed at, so
+//     v in v + a*t is encrypted where the product lands;
+//   - an operation's wave is one past its latest operand's, so every wave
+//     runs in parallel.
+inline CircuitPlan PlanCircuit(const Circuit &written)
+{
+    if (written.outputs().empty())
+    {
+        throw std::invalid_argument("the circuit has no outputs");
+    }
+    Circuit planned;
+    detail::Rebalancer rebalancer(written, planned);
+    std::vector<std::pair<std::string, std::size_t>> outputs;
+    for (const auto &output : written.outputs())
+    {
+        outputs.push_back({ output.first, rebalancer.lower(output.second) });
+    }
+
+    // Keep what the outputs reach, in creation (topological) order.
+    const std::vector<CircuitNode> &all = planned.nodes();
+    std::vector<bool> needed(all.size(), false);
+    for (const auto &output : outputs)
+    {
+        needed[output.second] = true;
+    }
+    for (std::size_t i = all.size(); i-- > 0;)
+    {
+        if (needed[i] && !all[i].leaf())
+        {
+            needed[all[i].lhs] = true;
+            if (all[i].op != CircuitOp::Rotate)
+                needed[all[i].rhs] = true;
+        }
+    }
+    CircuitPlan plan;
+    std::vector<std::size_t> renumber(all.size());
+    for (std::size_t i = 0; i < all.size(); i++)
+    {
+        if (!needed[i])
+            continue;
+        CircuitNode node = all[i];
+        node.lhs = renumber[node.lhs];
+        node.rhs = renumber[node.rhs];
+        renumber[i] = plan.nodes.size();
+        plan.nodes.push_back(node);
+    }
+    for (const auto &output : outputs)
+    {
+        if (all[output.second].op == CircuitOp::Constant)
+        {
+            throw std::invalid_argument("output " + output.first + " is a constant");
+        }
+        plan.outputs.push_back({ output.first, renumber[output.second] });
+    }
+
+    const std::vector<CircuitNode> &nodes = plan.nodes;
+    std::size_t n = nodes.size();
+    plan.depth = detail::Depths(nodes);
+    std::vector<std::size_t> written_depth = detail::Depths(written.nodes());
+    for (const auto &output : written.outputs())
+    {
+        plan.written_depth = std::max(plan.written_depth, written_depth[output.second]);
+    }
+    plan.merged = written.merged() + planned.merged();
+
+    // Consumers: does anything multiply or rotate the node, and at which
+    // level is each leaf consumed.
+    std::vector<bool> product(n, false), settled_use(n, false);
+    std::vector<std::size_t> use_level(n, ~std::size_t(0));
+    for (const auto &output : plan.outputs)
+    {
+        settled_use[output.second] = true;
+        use_level[output.second] = 0;
+    }
+    for (std::size_t i = 0; i < n; i++)
+    {
+        const CircuitNode &node = nodes[i];
+        if (node.leaf())
+            continue;
+        std::size_t level = node.op == CircuitOp::Multiply ? plan.depth[i] - 1 : plan.depth[i];
+        for (std::size_t operand : { node.lhs, node.rhs })
+        {
+            use_level[operand] = std::min(use_level[operand], level);
+            if (node.op != CircuitOp::Add)
+                settled_use[operand] = true;
+            if (node.op == CircuitOp::Rotate)
+                break;
+        }
+    }
+
+    plan.relinearize.assign(n, false);
+    std::vector<std::size_t> wave(n, 0);
+    plan.last_wave.assign(n, 0);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        const CircuitNode &node = nodes[i];
+        if (node.op == CircuitOp::Input)
+        {
+            plan.input_levels[node.name] = use_level[i];
+            continue;
+        }
+        if (node.leaf())
+            continue;
+        bool rhs = node.op != CircuitOp::Rotate;
+        product[i] = node.op == CircuitOp::Multiply ||
+                     (node.op == CircuitOp::Add && (product[node.lhs] || product[node.rhs]));
+        plan.relinearize[i] = product[i] && settled_use[i];
+        if (plan.relinearize[i])
+            product[i] = false;
+
+        std::size_t ready = 0;
+        for (std::size_t operand : { node.lhs, node.rhs })
+        {
+            if (!nodes[operand].leaf())
+                ready = std::max(ready, wave[operand] + 1);
+            if (!rhs)
+                break;
+        }
+        wave[i] = ready;
+        if (plan.waves.size() <= ready)
+            plan.waves.resize(ready + 1);
+        plan.waves[ready].push_back(i);
+        plan.last_wave[node.lhs] = std::max(plan.last_wave[node.lhs], ready);
+        if (rhs)
+            plan.last_wave[node.rhs] = std::max(plan.last_wave[node.rhs], ready);
+    }
+    return plan;
+}
+
+/*****Evaluate*****/
+// Client side: encodes and encrypts every input the plan reads at its
+// planned level.
+template <typename Scheme>
+std::map<std::string, typename Scheme::Ciphertext> EncryptCircuitInputs(
+    const Scheme &he, const CircuitPlan &plan, const std::map<std::string, std::vector<double>> &values)
+{
+    std::map<std::string, typename Scheme::Ciphertext> inputs;
+    for (const auto &input : plan.input_levels)
+    {
+        auto found = values.find(input.first);
+        if (found == values.end())
+        {
+            throw std::invalid_argument("no values for circuit input " + input.first);
+        }
+        inputs.emplace(input.first, he.encrypt(he.encode(found->second, input.second)));
+    }
+    return inputs;
+}
+
+// Lowers the plan onto the Scheme's calls. A product is rescaled as soon
+// as it is formed and relinearized where the plan says; an operand at a
+// shallower level is aligned to the deeper one before a binary operation;
+// constants are encoded at the level of the ciphertext they meet. Each
+// wave runs on the pool, intermediates are freed after their last wave.
+// Must not be called from one of pool's own tasks.
+template <typename Scheme>
+std::map<std::string, typename Scheme::Ciphertext> EvaluateCircuit(
+    const Scheme &he, const CircuitPlan &plan, const std::map<std::string, typename Scheme::Ciphertext> &inputs,
+    ThreadPool &pool)
+{
+    using Ciphertext = typename Scheme::Ciphertext;
+    const std::vector<CircuitNode> &nodes = plan.nodes;
+    std::vector<std::unique_ptr<Ciphertext>> owned(nodes.size());
+    std::vector<const Ciphertext *> value(nodes.size(), nullptr);
+    for (std::size_t i = 0; i < nodes.size(); i++)
+    {
+        if (nodes[i].op != CircuitOp::Input)
+            continue;
+        auto found = inputs.find(nodes[i].name);
+        if (found == inputs.end())
+        {
+            throw std::invalid_argument("circuit input " + nodes[i].name + " was not provided");
+        }
+        value[i] = &found->second;
+    }
+    std::vector<std::size_t> level(nodes.size(), 0);
+    for (std::size_t i = 0; i < nodes.size(); i++)
+    {
+        level[i] = nodes[i].op == CircuitOp::Input ? plan.input_levels.at(nodes[i].name) : plan.depth[i];
+    }
+
+    auto constant = [&](const CircuitNode &node, std::size_t at) {
+        return he.encode(std::vector<double>(he.slot_count(), node.value), at);
+    };
+    auto compute = [&](std::size_t i) -> Ciphertext {
+        const CircuitNode &node = nodes[i];
+        if (node.op == CircuitOp::Rotate)
+        {
+            return he.rotate(*value[node.lhs], node.step);
+        }
+        std::size_t x = node.lhs, y = node.rhs;
+        if (nodes[x].op == CircuitOp::Constant)
+            std::swap(x, y);
+        bool add = node.op == CircuitOp::Add;
+        if (nodes[y].op == CircuitOp::Constant)
+        {
+            if (add)
+                return he.add_plain(*value[x], constant(nodes[y], level[x]));
+            return he.rescale(he.multiply_plain(*value[x], constant(nodes[y], level[x])));
+        }
+        if (level[x] < level[y])
+            std::swap(x, y);
+        if (level[x] != level[y])
+        {
+            Ciphertext aligned = he.align(*value[y], *value[x]);
+            return add ? he.add(*value[x], aligned) : he.rescale(he.multiply(*value[x], aligned));
+        }
+        return add ? he.add(*value[x], *value[y]) : he.rescale(he.multiply(*value[x], *value[y]));
+    };
+
+    std::vector<bool> output(nodes.size(), false);
+    for (const auto &out : plan.outputs)
+    {
+        output[out.second] = true;
+    }
+    for (std::size_t w = 0; w < plan.waves.size(); w++)
+    {
+        const std::vector<std::size_t> &wave = plan.waves[w];
+        pool.parallel_for(wave.size(), [&](std::size_t k) {
+            std::size_t i = wave[k];
+            Ciphertext result = compute(i);
+            owned[i].reset(new Ciphertext(plan.relinearize[i] ? he.relinearize(result) : std::move(result)));
+            value[i] = owned[i].get();
+        });
+        for (std::size_t i = 0; i < nodes.size(); i++)
+        {
+            if (owned[i] && !output[i] && plan.last_wave[i] == w)
+            {
+                owned[i].reset();
+            }
+        }
+    }
+
+    std::map<std::string, Ciphertext> results;
+    for (const auto &out : plan.outputs)
+    {
+        results.emplace(out.first, *value[out.second]);
+    }
+    return results;
+}
+
+} // namespace hebench
@@ -0,0 +1,194 @@
+/****************************************************/
+/* Memory accounting for the HE examples/benchmark  */
+/* Peak RSS, heap in use, optional operator new     */
+/* byte counter and serialized object sizes         */
+/****************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <sys/resource.h>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+namespace hebench
+{
+
+// Peak resident set size of the process so far.
+inline std::uint64_t PeakRssBytes()
+{
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+#if defined(__APPLE__)
+    return static_cast<std::uint64_t>(usage.ru_maxrss); // bytes on macOS
+#else
+    return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024; // KiB on Linux
+#endif
+}
+
+// Bytes malloc currently has handed out (arenas + mmapped blocks), all threads.
+// Covers NTL's direct malloc calls as well as operator new.
+inline std::int64_t HeapInUseBytes()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    return static_cast<std::int64_t>(info.uordblks + info.hblkhd);
+#elif defined(__GLIBC__)
+    // mallinfo's int fields wrap above 2 GiB.
+    struct mallinfo info = mallinfo();
+    return static_cast<std::int64_t>(static_cast<unsigned int>(info.uordblks)) +
+           static_cast<unsigned int>(info.hblkhd);
+#else
+    return 0;
+#endif
+}
+
+// Running total of bytes requested through operator new. Stays 0 unless one
+// translation unit defines HEBENCH_COUNT_ALLOCATIONS before including this
+// header, which installs the counting operator new/delete below. A
+// function-local static, so the header also builds as C++11 (the examples
+// are compiled inside palisade-release with -std=c++11).
+inline std::atomic<std::uint64_t> &AllocatedBytesCounter()
+{
+    static std::atomic<std::uint64_t> allocated_bytes{ 0 };
+    return allocated_bytes;
+}
+
+inline std::uint64_t AllocatedBytes()
+{
+    return AllocatedBytesCounter().load(std::memory_order_relaxed);
+}
+
+// True once the counting operator new is installed and has run.
+inline bool AllocationCountingEnabled()
+{
+    return AllocatedBytes() > 0;
+}
+
+// Counts the bytes an object serializes to without buffering them.
+class CountingStreambuf : public std::streambuf
+{
+public:
+    std::uint64_t count() const
+    {
+        return count_;
+    }
+
+protected:
+    int_type overflow(int_type ch) override
+    {
+        if (!traits_type::eq_int_type(ch, traits_type::eof()))
+        {
+            count_++;
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    std::streamsize xsputn(const char_type *, std::streamsize n) override
+    {
+        count_ += static_cast<std::uint64_t>(n);
+        return n;
+    }
+
+private:
+    std::uint64_t count_ = 0;
+};
+
+// Size of whatever write(stream) serializes, e.g.
+//   SerializedBytes([&](std::ostream &out) { Serial::Serialize(key, out, SerType::BINARY); });
+template <typename F>
+std::uint64_t SerializedBytes(F &&write)
+{
+    CountingStreambuf buffer;
+    std::ostream out(&buffer);
+    write(out);
+    return buffer.count();
+}
+
+// No default member initializers: the examples brace-initialize it, which
+// C++11 only allows for aggregates.
+struct ObjectSize
+{
+    std::string name;
+    std::uint64_t bytes;
+};
+
+inline void PrintObjectSize(std::ostream &out, const ObjectSize &size)
+{
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::left << std::setw(22) << size.name << ": " << std::right << std::setw(12) << size.bytes << " bytes ("
+        << std::fixed << std::setprecision(2) << size.bytes / (1024.0 * 1024.0) << " MiB)" << std::endl;
+    out.flags(flags);
+    out.precision(precision);
+}
+
+} // namespace hebench
+
+#ifdef HEBENCH_COUNT_ALLOCATIONS
+// Replacement allocation functions; define HEBENCH_COUNT_ALLOCATIONS in
+// exactly one translation unit of a program. Kept out of line so GCC does
+// not pair the inlined free() with operator new and warn.
+#if defined(__GNUC__)
+#define HEBENCH_NOINLINE __attribute__((noinline))
+#else
+#define HEBENCH_NOINLINE
+#endif
+
+HEBENCH_NOINLINE void *operator new(std::size_t size)
+{
+    hebench::AllocatedBytesCounter().fetch_add(size, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+HEBENCH_NOINLINE void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+HEBENCH_NOINLINE void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    hebench::AllocatedBytesCounter().fetch_add(size, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+HEBENCH_NOINLINE void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+HEBENCH_NOINLINE void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+HEBENCH_NOINLINE void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+HEBENCH_NOINLINE void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+HEBENCH_NOINLINE void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+#endif
@@ -0,0 +1,133 @@
+/****************************************************/
+/* Per-thread object recycling                      */
+/* Free lists of spent plaintexts and ciphertexts   */
+/* so the next chunk on the same thread reuses      */
+/* their buffers instead of allocating new ones,    */
+/* with counters of what was reused                 */
+/****************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace hebench
+{
+
+struct RecycleCounts
+{
+    std::uint64_t acquired = 0; // objects handed out
+    std::uint64_t reused = 0;   // ... of which came off a free list
+    std::uint64_t released = 0; // objects handed back and kept
+    std::uint64_t dropped = 0;  // ... and freed because the list was full
+
+    RecycleCounts operator-(const RecycleCounts &before) const
+    {
+        return { acquired - before.acquired, reused - before.reused, released - before.released,
+                 dropped - before.dropped };
+    }
+};
+
+namespace detail
+{
+
+struct RecycleCounters
+{
+    std::atomic<std::uint64_t> acquired{ 0 };
+    std::atomic<std::uint64_t> reused{ 0 };
+    std::atomic<std::uint64_t> released{ 0 };
+    std::atomic<std::uint64_t> dropped{ 0 };
+};
+
+// Totals over every recycled type.
+inline RecycleCounters recycle_counters;
+
+} // namespace detail
+
+inline RecycleCounts RecycleTotals()
+{
+    auto load = [](const std::atomic<std::uint64_t> &counter) { return counter.load(std::memory_order_relaxed); };
+    return { load(detail::recycle_counters.acquired), load(detail::recycle_counters.reused),
+             load(detail::recycle_counters.released), load(detail::recycle_counters.dropped) };
+}
+
+// One free list of T per thread, so acquire and release take no lock. Meant
+// for types whose assignment and in-place writes reuse an existing buffer
+// when it is large enough (SEAL's Ciphertext and Plaintext): a recycled
+// object is overwritten, not cleared. Objects must be released on the thread
+// that will acquire them next, e.g. within one chunk of ChunkedEngine; at
+// most Capacity are kept per thread, the rest are freed.
+template <typename T, std::size_t Capacity = 8>
+class Recycler
+{
+public:
+    static T acquire()
+    {
+        detail::recycle_counters.acquired.fetch_add(1, std::memory_order_relaxed);
+        std::vector<T> &list = FreeList();
+        if (list.empty())
+        {
+            return T();
+        }
+        detail::recycle_counters.reused.fetch_add(1, std::memory_order_relaxed);
+        T object = std::move(list.back());
+        list.pop_back();
+        return object;
+    }
+
+    static void release(T &&object)
+    {
+        std::vector<T> &list = FreeList();
+        if (list.size() >= Capacity)
+        {
+            detail::recycle_counters.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        detail::recycle_counters.released.fetch_add(1, std::memory_order_relaxed);
+        list.push_back(std::move(object));
+    }
+
+private:
+    static std::vector<T> &FreeList()
+    {
+        thread_local std::vector<T> list;
+        return list;
+    }
+};
+
+/*****Engine hooks*****/
+// backend.recycle(std::move(object)) if the backend takes spent objects
+// back, otherwise object is simply destroyed.
+template <typename Backend, typename T>
+auto RecycleWith(const Backend &backend, T &&object, int)
+    -> decltype(backend.recycle(std::forward<T>(object)), void())
+{
+    backend.recycle(std::forward<T>(object));
+}
+
+template <typename Backend, typename T>
+void RecycleWith(const Backend &, T &&, long)
+{}
+
+template <typename Backend, typename T>
+void RecycleWith(const Backend &backend, T &&object)
+{
+    RecycleWith(backend, std::forward<T>(object), 0);
+}
+
+// Backends that draw from a memory pool report its bytes through
+// memory_pool_bytes().
+template <typename Backend, typename = void>
+struct ReportsPoolBytes : std::false_type
+{};
+
+template <typename Backend>
+struct ReportsPoolBytes<Backend, std::void_t<decltype(std::declval<const Backend &>().memory_pool_bytes())>>
+    : std::true_type
+{};
+
+} // namespace hebench
@@ -0,0 +1,274 @@
+/****************************************************/
+/* Machine-readable benchmark results               */
+/* One flat row per (run, phase), written as JSON   */
+/* or CSV so backends can be compared directly      */
+/****************************************************/
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace hebench
+{
+
+class BenchReport
+{
+public:
+    class Row
+    {
+    public:
+        Row &set(const std::string &key, const std::string &value)
+        {
+            return put(key, value, true);
+        }
+
+        Row &set(const std::string &key, const char *value)
+        {
+            return put(key, value, true);
+        }
+
+        // NaN and infinities have no JSON literal: they are left empty, which
+        // the CSV shows as a missing value and the JSON as null.
+        Row &set(const std::string &key, double value)
+        {
+            if (!std::isfinite(value))
+            {
+                return put(key, "", false);
+            }
+            std::ostringstream out;
+            out << std::setprecision(9) << value;
+            return put(key, out.str(), false);
+        }
+
+        template <typename T>
+        typename std::enable_if<std::is_integral<T>::value, Row &>::type set(const std::string &key, T value)
+        {
+            return put(key, std::to_string(value), false);
+        }
+
+    private:
+        friend class BenchReport;
+
+        struct Field
+        {
+            std::string key;
+            std::string value;
+            bool quoted;
+        };
+
+        Row &put(const std::string &key, const std::string &value, bool quoted)
+        {
+            for (auto &field : fields_)
+            {
+                if (field.key == key)
+                {
+                    field.value = value;
+                    field.quoted = quoted;
+                    return *this;
+                }
+            }
+            fields_.push_back({ key, value, quoted });
+            return *this;
+        }
+
+        const Field *find(const std::string &key) const
+        {
+            for (const auto &field : fields_)
+            {
+                if (field.key == key)
+                {
+                    return &field;
+                }
+            }
+            return nullptr;
+        }
+
+        std::vector<Field> fields_;
+    };
+
+    Row &add_row()
+    {
+        rows_.emplace_back();
+        return rows_.back();
+    }
+
+    const std::vector<Row> &rows() const
+    {
+        return rows_;
+    }
+
+    void write_json(std::ostream &out) const
+    {
+        out << "{\n  \"results\": [";
+        for (std::size_t r = 0; r < rows_.size(); r++)
+        {
+            out << (r ? ",\n    {" : "\n    {");
+            const auto &fields = rows_[r].fields_;
+            for (std::size_t f = 0; f < fields.size(); f++)
+            {
+                out << (f ? ", " : "") << '"' << Escape(fields[f].key) << "\": ";
+                if (fields[f].quoted)
+                    out << '"' << Escape(fields[f].value) << '"';
+                else
+                    out << (fields[f].value.empty() ? "null" : fields[f].value);
+            }
+            out << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    // Columns are the union of all row keys in first-seen order. Fields are
+    // quoted as RFC 4180 asks when they hold a comma, quote or line break
+    // (coeff_bits, crt_moduli and error messages do).
+    void write_csv(std::ostream &out, bool with_header = true) const
+    {
+        std::vector<std::string> columns = this->columns();
+        if (with_header)
+        {
+            out << header(columns) << "\r\n";
+        }
+        for (const auto &row : rows_)
+        {
+            for (std::size_t c = 0; c < columns.size(); c++)
+            {
+                const Row::Field *field = row.find(columns[c]);
+                out << (c ? "," : "") << (field ? CsvField(field->value) : "");
+            }
+            out << "\r\n";
+        }
+    }
+
+    void save_json(const std::string &path) const
+    {
+        std::ofstream out(path);
+        if (!out)
+        {
+            throw std::runtime_error("cannot open " + path);
+        }
+        write_json(out);
+    }
+
+    // Appends to an existing file so runs of different backends land in one table;
+    // the header is only written when the file is new or empty. Columns depend
+    // on the options of a run, so a file whose header differs is refused
+    // rather than given rows that do not line up with it.
+    void append_csv(const std::string &path) const
+    {
+        std::string existing;
+        {
+            std::ifstream in(path);
+            if (in && std::getline(in, existing) && !existing.empty() && existing.back() == '\r')
+            {
+                existing.pop_back();
+            }
+        }
+        bool empty = existing.empty();
+        if (!empty && existing != header(columns()))
+        {
+            throw std::runtime_error(path + " has other columns than this run (" + header(columns()) +
+                                     "); write to a new --csv file");
+        }
+        std::ofstream out(path, std::ios::app);
+        if (!out)
+        {
+            throw std::runtime_error("cannot open " + path);
+        }
+        write_csv(out, empty);
+    }
+
+private:
+    std::vector<std::string> columns() const
+    {
+        std::vector<std::string> columns;
+        for (const auto &row : rows_)
+        {
+            for (const auto &field : row.fields_)
+            {
+                bool seen = false;
+                for (const auto &column : columns)
+                {
+                    seen = seen || column == field.key;
+                }
+                if (!seen)
+                {
+                    columns.push_back(field.key);
+                }
+            }
+        }
+        return columns;
+    }
+
+    static std::string header(const std::vector<std::string> &columns)
+    {
+        std::string line;
+        for (std::size_t c = 0; c < columns.size(); c++)
+        {
+            line += (c ? "," : "") + CsvField(columns[c]);
+        }
+        return line;
+    }
+
+    // Wrapped in quotes, with quotes doubled, when the text needs it.
+    static std::string CsvField(const std::string &text)
+    {
+        if (text.find_first_of(",\"\r\n") == std::string::npos)
+        {
+            return text;
+        }
+        std::string quoted = "\"";
+        for (char c : text)
+        {
+            if (c == '"')
+            {
+                quoted += '"';
+            }
+            quoted += c;
+        }
+        return quoted + '"';
+    }
+
+    // JSON string contents: quotes and backslashes escaped, line breaks and
+    // tabs by name, the other control characters as \u00XX.
+    static std::string Escape(const std::string &text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                escaped += '\\';
+                escaped += c;
+            }
+            else if (c == '\n')
+                escaped += "\\n";
+            else if (c == '\r')
+                escaped += "\\r";
+            else if (c == '\t')
+                escaped += "\\t";
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                static const char hex[] = "0123456789abcdef";
+                escaped += "\\u00";
+                escaped += hex[static_cast<unsigned char>(c) >> 4];
+                escaped += hex[c & 0xf];
+            }
+            else
+                escaped += c;
+        }
+        return escaped;
+    }
+
+    std::vector<Row> rows_;
+};
+
+} // namespace hebench
@@ -0,0 +1,99 @@
+/****************************************************/
+/* Library-independent HE evaluation interface      */
+/* Workloads written once against a Scheme template */
+/* parameter: SEALScheme, PalisadeScheme or         */
+/* HElibScheme, chosen at compile time              */
+/****************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "VelocityData.h"
+
+namespace hebench
+{
+
+// What a Scheme provides. There is no base class: workloads are templates
+// over the Scheme, so every call is resolved (and can be inlined) at compile
+// time, with no virtual dispatch between the workload and the library.
+//
+//   using Plaintext, Ciphertext          the library's own types
+//   static const char *Name()
+//   static bool Supports(scheme)         bfv, bgv or ckks
+//   explicit Scheme(const BenchConfig &) context, same parameters as the
+//                                        library's velocity backend
+//   void keygen(const RotationPlan &)    public/secret, relinearization and
+//                                        the planned rotation keys
+//   std::size_t slot_count() const
+//   std::size_t row_size() const         slots a rotation cycles through:
+//                                        half of them for SEAL and PALISADE
+//                                        BFV/BGV (two rows), else all
+//
+//   Plaintext encode(values, level = 0)  level: multiplications the value
+//                                        waits for before it is consumed;
+//                                        every product that deep, operands
+//                                        aligned, meets it without fix-up
+//   Ciphertext encrypt(plain)
+//   std::vector<double> decrypt(ct, n)   integers centered in (-t/2, t/2]
+//
+//   add(a, b), add_plain(a, plain)
+//   multiply(a, b)                       unrelinearized, unrescaled
+//   multiply_plain(a, plain)
+//   relinearize(a)                       back to two polynomials
+//   rescale(a)                           SEAL CKKS; identity where the
+//                                        library manages levels itself
+//   rotate(a, step)                      left by step slots (RotationPlan)
+//   align(y, x)                          y at x's level and scale, y no
+//                                        deeper than x (SEAL CKKS; identity
+//                                        elsewhere)
+//
+// All evaluation calls are const and take and return values, so one Scheme
+// is shared by every thread once keygen has run.
+
+// Integer inputs as the encoder's doubles.
+inline std::vector<double> ToSlots(const std::vector<std::int64_t> &values)
+{
+    return std::vector<double>(values.begin(), values.end());
+}
+
+/*****Workloads*****/
+// final velocity = v + a * t, every operand encrypted. v is encoded at
+// level 1, where the rescaled product lands.
+template <typename Scheme>
+typename Scheme::Ciphertext VelocityCircuit(const Scheme &he, const typename Scheme::Ciphertext &v,
+                                            const typename Scheme::Ciphertext &a,
+                                            const typename Scheme::Ciphertext &t)
+{
+    return he.add(v, he.rescale(he.relinearize(he.multiply(a, t))));
+}
+
+// Slot i becomes the sum of slots i .. i+n-1, n a power of two; needs
+// RotationPlan::window_sum(n) keys.
+template <typename Scheme>
+typename Scheme::Ciphertext WindowSum(const Scheme &he, typename Scheme::Ciphertext x, std::size_t n)
+{
+    if (n == 0 || (n & (n - 1)) != 0)
+    {
+        throw std::invalid_argument("window sums need a power-of-two window, got " + std::to_string(n));
+    }
+    for (std::size_t step = 1; step < n; step *= 2)
+    {
+        x = he.add(x, he.rotate(x, static_cast<int>(step)));
+    }
+    return x;
+}
+
+// Encodes and encrypts one velocity chunk and runs VelocityCircuit.
+template <typename Scheme>
+std::vector<double> EvaluateVelocity(const Scheme &he, const VelocityData &data)
+{
+    auto v = he.encrypt(he.encode(ToSlots(data.initial_velocity), 1));
+    auto a = he.encrypt(he.encode(ToSlots(data.acc)));
+    auto t = he.encrypt(he.encode(ToSlots(data.times)));
+    return he.decrypt(VelocityCircuit(he, v, a, t), data.size());
+}
+
+} // namespace hebench
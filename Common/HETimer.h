@@ -0,0 +1,311 @@
+/****************************************************/
+/* Phase timer for the HE examples and benchmark    */
+/* Wall time from steady_clock plus process and     */
+/* thread CPU time, with warm-up runs, repetitions  */
+/* and p50/p95/p99 per phase; heap and peak RSS    */
+/* per phase from HEMemory.h                        */
+/****************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <chrono>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "HEMemory.h"
+
+namespace hebench
+{
+
+// Process CPU time, summed over every thread (OpenMP workers included).
+inline double ProcessCpuSeconds()
+{
+#if defined(CLOCK_PROCESS_CPUTIME_ID)
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#else
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+// CPU time of the calling thread only.
+inline double ThreadCpuSeconds()
+{
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#else
+    return ProcessCpuSeconds();
+#endif
+}
+
+struct PhaseSample
+{
+    double wall_s = 0;
+    double cpu_s = 0;        // process CPU
+    double thread_cpu_s = 0; // CPU of the thread that ran the phase
+    std::int64_t heap_delta_bytes = 0;  // change of heap in use, retained by the phase
+    std::uint64_t allocated_bytes = 0;  // requested through operator new, if counted
+    std::uint64_t peak_rss_bytes = 0;   // process peak RSS at the end of the phase
+    // Taken while other threads ran: heap and allocation counters are
+    // process-wide, so the two memory fields include their work too.
+    bool process_wide_memory = false;
+};
+
+struct PhaseStats
+{
+    std::string name;
+    std::size_t reps = 0;
+    double wall_mean_s = 0;
+    double wall_p50_s = 0;
+    double wall_p95_s = 0;
+    double wall_p99_s = 0;
+    double wall_min_s = 0;
+    double wall_max_s = 0;
+    double cpu_mean_s = 0;
+    double thread_cpu_mean_s = 0;
+    double heap_delta_mean_bytes = 0;
+    double allocated_mean_bytes = 0;
+    std::uint64_t peak_rss_bytes = 0;
+    bool process_wide_memory = false; // any sample was
+};
+
+class Stopwatch
+{
+public:
+    Stopwatch()
+    {
+        start();
+    }
+
+    void start()
+    {
+        wall_ = std::chrono::steady_clock::now();
+        cpu_ = ProcessCpuSeconds();
+        thread_cpu_ = ThreadCpuSeconds();
+        heap_ = HeapInUseBytes();
+        allocated_ = AllocatedBytes();
+    }
+
+    // concurrent: other threads may allocate before the sample is taken.
+    PhaseSample elapsed(bool concurrent = false) const
+    {
+        PhaseSample sample;
+        sample.process_wide_memory = concurrent;
+        sample.wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_).count();
+        sample.cpu_s = ProcessCpuSeconds() - cpu_;
+        sample.thread_cpu_s = ThreadCpuSeconds() - thread_cpu_;
+        sample.heap_delta_bytes = HeapInUseBytes() - heap_;
+        sample.allocated_bytes = AllocatedBytes() - allocated_;
+        sample.peak_rss_bytes = PeakRssBytes();
+        return sample;
+    }
+
+private:
+    std::chrono::steady_clock::time_point wall_;
+    double cpu_ = 0;
+    double thread_cpu_ = 0;
+    std::int64_t heap_ = 0;
+    std::uint64_t allocated_ = 0;
+};
+
+// Nearest-rank percentile of an ascending vector, p in [0, 100].
+inline double Percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    std::size_t rank = static_cast<std::size_t>(std::ceil(p / 100.0 * sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<std::size_t>(rank, 1)) - 1];
+}
+
+class HETimer
+{
+public:
+    explicit HETimer(std::size_t warmup = 0, std::size_t reps = 1) : warmup_(warmup), reps_(std::max<std::size_t>(reps, 1))
+    {}
+
+    std::size_t warmup() const
+    {
+        return warmup_;
+    }
+
+    std::size_t reps() const
+    {
+        return reps_;
+    }
+
+    // One-shot phases whose results are used afterwards (context, keys).
+    void start(const std::string &phase)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_[phase].start();
+    }
+
+    void stop(const std::string &phase)
+    {
+        PhaseSample sample;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = running_.find(phase);
+            if (it == running_.end())
+            {
+                throw std::logic_error("phase " + phase + " was never started");
+            }
+            sample = it->second.elapsed();
+            running_.erase(it);
+        }
+        record(phase, sample);
+    }
+
+    // Runs body warmup() times untimed, then reps() times timed.
+    template <typename F>
+    void measure(const std::string &phase, F &&body)
+    {
+        for (std::size_t i = 0; i < warmup_; i++)
+        {
+            body();
+        }
+        for (std::size_t i = 0; i < reps_; i++)
+        {
+            Stopwatch stopwatch;
+            body();
+            record(phase, stopwatch.elapsed());
+        }
+    }
+
+    // Safe to call from worker threads.
+    void record(const std::string &phase, const PhaseSample &sample)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = samples_.find(phase);
+        if (it == samples_.end())
+        {
+            order_.push_back(phase);
+            it = samples_.emplace(phase, std::vector<PhaseSample>()).first;
+        }
+        it->second.push_back(sample);
+    }
+
+    PhaseStats stats(const std::string &phase) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        PhaseStats stats;
+        stats.name = phase;
+        auto it = samples_.find(phase);
+        if (it == samples_.end() || it->second.empty())
+        {
+            return stats;
+        }
+
+        const std::vector<PhaseSample> &samples = it->second;
+        std::vector<double> wall;
+        for (const auto &sample : samples)
+        {
+            wall.push_back(sample.wall_s);
+            stats.wall_mean_s += sample.wall_s;
+            stats.cpu_mean_s += sample.cpu_s;
+            stats.thread_cpu_mean_s += sample.thread_cpu_s;
+            stats.heap_delta_mean_bytes += sample.heap_delta_bytes;
+            stats.allocated_mean_bytes += sample.allocated_bytes;
+            stats.peak_rss_bytes = std::max(stats.peak_rss_bytes, sample.peak_rss_bytes);
+            stats.process_wide_memory = stats.process_wide_memory || sample.process_wide_memory;
+        }
+        std::sort(wall.begin(), wall.end());
+
+        stats.reps = samples.size();
+        stats.wall_mean_s /= stats.reps;
+        stats.cpu_mean_s /= stats.reps;
+        stats.thread_cpu_mean_s /= stats.reps;
+        stats.heap_delta_mean_bytes /= stats.reps;
+        stats.allocated_mean_bytes /= stats.reps;
+        stats.wall_p50_s = Percentile(wall, 50);
+        stats.wall_p95_s = Percentile(wall, 95);
+        stats.wall_p99_s = Percentile(wall, 99);
+        stats.wall_min_s = wall.front();
+        stats.wall_max_s = wall.back();
+        return stats;
+    }
+
+    // Every recorded phase, in the order it was first recorded.
+    std::vector<PhaseStats> all_stats() const
+    {
+        std::vector<std::string> order;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            order = order_;
+        }
+        std::vector<PhaseStats> all;
+        for (const auto &phase : order)
+        {
+            all.push_back(stats(phase));
+        }
+        return all;
+    }
+
+    // Seconds; cpu/wall above 1 means the phase ran on several threads.
+    // Memory in MiB: heap retained per repetition, bytes allocated per
+    // repetition (only with HEBENCH_COUNT_ALLOCATIONS) and peak RSS so far.
+    // Rows marked * were sampled while other threads ran, so their heap and
+    // alloc columns are process-wide rather than the phase's own.
+    void print(std::ostream &out) const
+    {
+        const double mib = 1024.0 * 1024.0;
+        bool counted = AllocationCountingEnabled();
+        std::ios::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        out << "Times (s, " << warmup_ << " warm-up) and memory (MiB):" << std::endl;
+        out << std::left << std::setw(24) << "" << std::right << std::setw(6) << "reps" << std::setw(11) << "mean"
+            << std::setw(11) << "p50" << std::setw(11) << "p95" << std::setw(11) << "p99" << std::setw(10) << "cpu/wall"
+            << std::setw(11) << "heap";
+        if (counted)
+        {
+            out << std::setw(11) << "alloc";
+        }
+        out << std::setw(11) << "peak RSS" << std::endl;
+        out << std::fixed << std::setprecision(6);
+        bool shared = false;
+        for (const auto &stats : all_stats())
+        {
+            double parallelism = stats.wall_mean_s > 0 ? stats.cpu_mean_s / stats.wall_mean_s : 0;
+            out << std::left << std::setw(22) << stats.name << ": " << std::right << std::setw(6) << stats.reps
+                << std::setw(11) << stats.wall_mean_s << std::setw(11) << stats.wall_p50_s << std::setw(11)
+                << stats.wall_p95_s << std::setw(11) << stats.wall_p99_s << std::setw(10) << std::setprecision(2)
+                << parallelism << std::setw(11) << stats.heap_delta_mean_bytes / mib;
+            if (counted)
+            {
+                out << std::setw(11) << stats.allocated_mean_bytes / mib;
+            }
+            out << std::setw(11) << stats.peak_rss_bytes / mib << (stats.process_wide_memory ? " *" : "")
+                << std::setprecision(6) << std::endl;
+            shared = shared || stats.process_wide_memory;
+        }
+        if (shared)
+        {
+            out << "* heap" << (counted ? "/alloc" : "") << " sampled process-wide while other threads ran" << std::endl;
+        }
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+private:
+    std::size_t warmup_;
+    std::size_t reps_;
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Stopwatch> running_;
+    std::map<std::string, std::vector<PhaseSample>> samples_;
+    std::vector<std::string> order_;
+};
+
+} // namespace hebench
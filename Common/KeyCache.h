@@ -0,0 +1,292 @@
+/****************************************************/
+/* On-disk key and context cache                    */
+/* Files live in <dir>/<hash of the parameters>/    */
+/* and are memory-mapped for loading, so a warm     */
+/* start deserializes straight from the page cache  */
+/****************************************************/
+
+#pragma once
+
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iomanip>
+#include <istream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace hebench
+{
+
+// FNV-1a; only has to tell parameter sets apart, not resist attacks.
+inline std::uint64_t Fnv1a64(const std::string &text)
+{
+    std::uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : text)
+    {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Read-only view of a whole file.
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("cannot open " + path + ": " + std::strerror(errno));
+        }
+        struct stat info;
+        if (::fstat(fd, &info) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("cannot stat " + path + ": " + std::strerror(errno));
+        }
+        size_ = static_cast<std::size_t>(info.st_size);
+        if (size_ > 0)
+        {
+            void *data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED)
+            {
+                ::close(fd);
+                throw std::runtime_error("cannot map " + path + ": " + std::strerror(errno));
+            }
+            data_ = static_cast<const char *>(data);
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if (data_)
+        {
+            ::munmap(const_cast<char *>(data_), size_);
+        }
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const char *data() const
+    {
+        return data_;
+    }
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+private:
+    const char *data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+// istream buffer over memory the caller keeps alive; no copy is made.
+class MemoryStreambuf : public std::streambuf
+{
+public:
+    MemoryStreambuf(const char *data, std::size_t size)
+    {
+        char *begin = const_cast<char *>(data);
+        setg(begin, begin, begin + size);
+    }
+
+protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+    {
+        if (!(which & std::ios_base::in))
+        {
+            return pos_type(off_type(-1));
+        }
+        char *base = dir == std::ios_base::beg ? eback() : dir == std::ios_base::cur ? gptr() : egptr();
+        char *target = base + off;
+        if (target < eback() || target > egptr())
+        {
+            return pos_type(off_type(-1));
+        }
+        setg(eback(), target, egptr());
+        return pos_type(target - eback());
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+};
+
+// One cache directory per parameter set. params is any text that pins down
+// everything the stored objects depend on (library and version, scheme,
+// ring, moduli, ...); an empty dir disables the cache. Entries hold secret
+// keys, so files are created 0600.
+//
+// Every file starts with the 8-byte generation id of the key set it
+// belongs to (0 for contexts and parameters, which any run rebuilds
+// identically). Files are renamed into place one by one, so two runs that
+// miss at the same time can leave a secret key of one next to a public
+// key of the other; loading with the expected generation turns such a mix
+// into a miss instead of a key set that does not decrypt.
+class KeyCache
+{
+public:
+    KeyCache(const std::string &dir, const std::string &params) : params_(params + " cache_format=2")
+    {
+        if (dir.empty())
+        {
+            return;
+        }
+        std::ostringstream key;
+        key << std::hex << std::setw(16) << std::setfill('0') << Fnv1a64(params_);
+        key_ = key.str();
+        path_ = dir + "/" + key_;
+    }
+
+    bool enabled() const
+    {
+        return !path_.empty();
+    }
+
+    const std::string &key() const
+    {
+        return key_;
+    }
+
+    bool contains(const std::string &name) const
+    {
+        struct stat info;
+        return enabled() && ::stat(file(name).c_str(), &info) == 0;
+    }
+
+    // A fresh nonzero id for a key set about to be generated.
+    static std::uint64_t NewGeneration()
+    {
+        std::random_device device;
+        std::uint64_t id = (static_cast<std::uint64_t>(device()) << 32) ^ device() ^
+                           static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+        return id ? id : 1;
+    }
+
+    // Files stored from now on carry this generation id.
+    void set_generation(std::uint64_t generation)
+    {
+        generation_ = generation;
+    }
+
+    // Generation id of a stored entry; 0 if it is missing.
+    std::uint64_t generation(const std::string &name) const
+    {
+        if (!contains(name))
+        {
+            return 0;
+        }
+        MappedFile mapped(file(name));
+        return mapped.size() < sizeof(std::uint64_t) ? 0 : ReadGeneration(mapped.data());
+    }
+
+    // Calls read(std::istream &) on the mapped entry; false if it is missing
+    // or, with a nonzero generation, belongs to another key set.
+    template <typename F>
+    bool load(const std::string &name, F &&read, std::uint64_t generation = 0) const
+    {
+        if (!contains(name))
+        {
+            return false;
+        }
+        MappedFile mapped(file(name));
+        if (mapped.size() < sizeof(std::uint64_t) ||
+            (generation != 0 && ReadGeneration(mapped.data()) != generation))
+        {
+            return false;
+        }
+        MemoryStreambuf buffer(mapped.data() + sizeof(std::uint64_t), mapped.size() - sizeof(std::uint64_t));
+        std::istream in(&buffer);
+        in.exceptions(std::ios_base::badbit | std::ios_base::failbit);
+        read(in);
+        return true;
+    }
+
+    // Calls write(std::ostream &) into a temporary file and renames it into
+    // place, so concurrent runs never see half-written entries.
+    template <typename F>
+    void store(const std::string &name, F &&write) const
+    {
+        if (!enabled())
+        {
+            return;
+        }
+        make_directories();
+        std::string target = file(name);
+        std::string temporary = target + ".tmp" + std::to_string(::getpid());
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            if (!out)
+            {
+                throw std::runtime_error("cannot write " + temporary);
+            }
+            ::chmod(temporary.c_str(), 0600);
+            out.write(reinterpret_cast<const char *>(&generation_), sizeof(generation_));
+            write(out);
+            if (!out.flush())
+            {
+                throw std::runtime_error("cannot write " + temporary);
+            }
+        }
+        if (std::rename(temporary.c_str(), target.c_str()) != 0)
+        {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("cannot rename " + temporary + " to " + target);
+        }
+    }
+
+private:
+    static std::uint64_t ReadGeneration(const char *data)
+    {
+        std::uint64_t generation;
+        std::memcpy(&generation, data, sizeof(generation));
+        return generation;
+    }
+
+    std::string file(const std::string &name) const
+    {
+        return path_ + "/" + name + ".bin";
+    }
+
+    void make_directories() const
+    {
+        for (std::size_t slash = path_.find('/', 1); ; slash = path_.find('/', slash + 1))
+        {
+            std::string prefix = path_.substr(0, slash);
+            if (::mkdir(prefix.c_str(), 0700) != 0 && errno != EEXIST)
+            {
+                throw std::runtime_error("cannot create " + prefix + ": " + std::strerror(errno));
+            }
+            if (slash == std::string::npos)
+            {
+                break;
+            }
+        }
+        std::ofstream(path_ + "/params.txt") << params_ << std::endl;
+    }
+
+    std::string params_;
+    std::string key_;
+    std::string path_;
+    std::uint64_t generation_ = 0;
+};
+
+} // namespace hebench
@@ -0,0 +1,244 @@
+/****************************************************/
+/* Minimal parameter planner                        */
+/* Smallest ring dimension and modulus chain that   */
+/* fit a circuit's depth, plaintext range or CKKS   */
+/* precision and slot count at a security level,    */
+/* for SEAL, PALISADE and HElib                     */
+/****************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace hebench
+{
+
+struct CircuitRequirements
+{
+    std::string scheme = "bfv";       // bfv, bgv or ckks
+    std::uint32_t depth = 1;          // multiplicative depth
+    std::uint64_t max_plain_value = 0; // BFV/BGV: largest |value| any slot takes
+    std::uint32_t integer_bits = 0;   // CKKS: |value| < 2^integer_bits
+    std::uint32_t precision_bits = 20; // CKKS: bits kept after the binary point
+    std::size_t slots = 0;            // values per ciphertext, 0 = any
+    std::uint32_t security = 128;     // 128, 192 or 256 (classical, ternary secret)
+};
+
+struct ParameterPlan
+{
+    std::size_t ring_dim = 0;
+    std::uint64_t plain_modulus = 0; // BFV/BGV: prime, 1 mod 2*ring_dim
+    std::uint32_t scale_bits = 0;    // CKKS
+    std::vector<int> coeff_bits;     // prime sizes for SEAL's CoeffModulus::Create, special prime last
+
+    std::size_t slot_count(const std::string &scheme) const
+    {
+        return scheme == "ckks" ? ring_dim / 2 : ring_dim;
+    }
+
+    // Ciphertext modulus without the key-switching prime: HElib's
+    // buildModChain bits, which adds its special primes itself.
+    int ciphertext_bits() const
+    {
+        int bits = 0;
+        for (std::size_t i = 0; i + 1 < coeff_bits.size(); i++)
+        {
+            bits += coeff_bits[i];
+        }
+        return bits;
+    }
+
+    int total_bits() const
+    {
+        return ciphertext_bits() + (coeff_bits.empty() ? 0 : coeff_bits.back());
+    }
+};
+
+// Largest log2(q*p) for a ternary secret, from the HE standard's tables (as
+// SEAL's CoeffModulus::MaxBitCount); 0 if the ring is not covered.
+inline int MaxCoeffModulusBits(std::size_t ring_dim, std::uint32_t security)
+{
+    static const std::size_t dims[] = { 1024, 2048, 4096, 8192, 16384, 32768 };
+    static const int bits128[] = { 27, 54, 109, 218, 438, 881 };
+    static const int bits192[] = { 19, 37, 75, 152, 305, 611 };
+    static const int bits256[] = { 14, 29, 58, 118, 237, 476 };
+    const int *bits = security == 128 ? bits128 : security == 192 ? bits192 : security == 256 ? bits256 : nullptr;
+    if (!bits)
+    {
+        throw std::invalid_argument("security must be 128, 192 or 256 bits, got " + std::to_string(security));
+    }
+    for (std::size_t i = 0; i < 6; i++)
+    {
+        if (dims[i] == ring_dim)
+            return bits[i];
+    }
+    return 0;
+}
+
+// Deterministic Miller-Rabin for 64-bit n.
+inline bool IsPrime(std::uint64_t n)
+{
+    if (n < 2)
+        return false;
+    for (std::uint64_t p : { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 })
+    {
+        if (n % p == 0)
+            return n == p;
+    }
+    auto mul = [n](std::uint64_t a, std::uint64_t b) {
+        return static_cast<std::uint64_t>(static_cast<unsigned __int128>(a) * b % n);
+    };
+    std::uint64_t d = n - 1;
+    int s = 0;
+    while (d % 2 == 0)
+    {
+        d /= 2;
+        s++;
+    }
+    for (std::uint64_t a : { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 })
+    {
+        std::uint64_t x = 1, base = a, e = d;
+        while (e)
+        {
+            if (e & 1)
+                x = mul(x, base);
+            base = mul(base, base);
+            e >>= 1;
+        }
+        if (x == 1 || x == n - 1)
+            continue;
+        bool composite = true;
+        for (int r = 1; r < s && composite; r++)
+        {
+            x = mul(x, x);
+            composite = x != n - 1;
+        }
+        if (composite)
+            return false;
+    }
+    return true;
+}
+
+// Smallest batching prime (1 mod 2*ring_dim) above minimum.
+inline std::uint64_t FindPlainModulus(std::uint64_t minimum, std::size_t ring_dim)
+{
+    std::uint64_t step = 2 * ring_dim;
+    for (std::uint64_t p = (minimum / step + 1) * step + 1; p > minimum; p += step)
+    {
+        if (IsPrime(p))
+            return p;
+    }
+    throw std::invalid_argument("no batching plaintext modulus above " + std::to_string(minimum));
+}
+
+// Splits bits into the fewest primes of at most 60 bits, sizes as even as
+// possible.
+inline std::vector<int> SplitPrimes(int bits)
+{
+    int count = (bits + 59) / 60;
+    std::vector<int> primes(count, bits / count);
+    for (int i = 0; i < bits % count; i++)
+    {
+        primes[i]++;
+    }
+    return primes;
+}
+
+// Noise estimates behind the plan (bits, conservative averages rather than
+// worst case, as the libraries' own defaults):
+//   BFV/BGV: fresh noise log2(N)/2 + 8, each multiplication (with
+//     relinearization) log2(t) + log2(N) + 4, decryption needs log2(t) + 2
+//     on top.
+//   CKKS: encoding, rescaling and key switching add errors about sqrt(N)
+//     times a small constant, so the scale is precision + log2(N)/2 + 5
+//     bits; the first prime holds the scale plus the integer part and the
+//     special prime is the largest.
+
+// BFV/BGV ciphertext modulus bits (special prime excluded) for depth
+// multiplications with plaintext modulus t at ring_dim.
+inline int IntegerChainBits(std::size_t ring_dim, std::uint64_t plain_modulus, std::uint32_t depth)
+{
+    int log_n = static_cast<int>(std::log2(static_cast<double>(ring_dim)));
+    int log_t = static_cast<int>(std::ceil(std::log2(static_cast<double>(plain_modulus))));
+    return (log_n + 1) / 2 + 8 + static_cast<int>(depth) * (log_t + log_n + 4) + log_t + 2;
+}
+
+// Every ring from 2^10 up is tried and the first one whose slots and
+// modulus fit the security bound wins.
+inline ParameterPlan PlanParameters(const CircuitRequirements &req)
+{
+    bool ckks = req.scheme == "ckks";
+    if (!ckks && req.scheme != "bfv" && req.scheme != "bgv")
+    {
+        throw std::invalid_argument("unknown scheme " + req.scheme);
+    }
+    std::string reason;
+    for (std::size_t ring_dim = 1024; ring_dim <= 32768; ring_dim *= 2)
+    {
+        ParameterPlan plan;
+        plan.ring_dim = ring_dim;
+        if (plan.slot_count(req.scheme) < req.slots)
+        {
+            reason = std::to_string(req.slots) + " slots";
+            continue;
+        }
+        int log_n = static_cast<int>(std::log2(static_cast<double>(ring_dim)));
+        if (ckks)
+        {
+            plan.scale_bits = req.precision_bits + static_cast<std::uint32_t>((log_n + 1) / 2 + 5);
+            int first = static_cast<int>(plan.scale_bits + req.integer_bits);
+            if (first > 60)
+            {
+                reason = "a first prime of " + std::to_string(first) + " bits (scale plus integer part, max 60)";
+                continue;
+            }
+            plan.coeff_bits.push_back(first);
+            plan.coeff_bits.insert(plan.coeff_bits.end(), req.depth, static_cast<int>(plan.scale_bits));
+            plan.coeff_bits.push_back(std::max(first, static_cast<int>(plan.scale_bits)));
+        }
+        else
+        {
+            plan.plain_modulus = FindPlainModulus(2 * req.max_plain_value, ring_dim);
+            plan.coeff_bits = SplitPrimes(IntegerChainBits(ring_dim, plan.plain_modulus, req.depth));
+            plan.coeff_bits.push_back(*std::max_element(plan.coeff_bits.begin(), plan.coeff_bits.end()));
+        }
+        if (plan.total_bits() > MaxCoeffModulusBits(ring_dim, req.security))
+        {
+            reason = std::to_string(plan.total_bits()) + " modulus bits at " + std::to_string(req.security) +
+                     "-bit security";
+            continue;
+        }
+        return plan;
+    }
+    throw std::invalid_argument("no ring up to 32768 fits depth " + std::to_string(req.depth) + ": the largest needs " +
+                                reason);
+}
+
+// "60,40,60" style list of prime sizes.
+inline std::string CoeffBitsList(const std::vector<int> &coeff_bits)
+{
+    std::string bits;
+    for (int b : coeff_bits)
+    {
+        bits += (bits.empty() ? "" : ",") + std::to_string(b);
+    }
+    return bits;
+}
+
+// "ring_dim=8192 plain_modulus=65537 coeff_bits=40,40,40" style summary.
+inline std::string DescribePlan(const ParameterPlan &plan)
+{
+    std::string text = "ring_dim=" + std::to_string(plan.ring_dim);
+    if (plan.plain_modulus)
+        text += " plain_modulus=" + std::to_string(plan.plain_modulus);
+    if (plan.scale_bits)
+        text += " scale_bits=" + std::to_string(plan.scale_bits);
+    return text + " coeff_bits=" + CoeffBitsList(plan.coeff_bits) + " (" + std::to_string(plan.total_bits()) + " bits)";
+}
+
+} // namespace hebench
@@ -0,0 +1,201 @@
+/****************************************************/
+/* Pipelined velocity engine                        */
+/* encode -> encrypt -> evaluate -> decrypt stages  */
+/* each on their own workers, chunks passed through */
+/* bounded lock-free queues so stages overlap and   */
+/* memory stays constant for any input size         */
+/****************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "BoundedQueue.h"
+#include "HETimer.h"
+#include "VelocityData.h"
+
+namespace hebench
+{
+
+struct StageThreads
+{
+    std::size_t encode = 1;
+    std::size_t encrypt = 1;
+    std::size_t evaluate = 1;
+    std::size_t decrypt = 1;
+};
+
+struct PipelineSummary
+{
+    std::size_t records = 0;
+    std::size_t chunks = 0;
+    double max_error = 0;
+};
+
+// Backend must be keyed and its encode/encrypt/evaluate/decrypt safe to call
+// concurrently. At most 4 * queue_depth chunks plus one per worker are alive
+// at any time; results are checked and dropped as they leave the pipeline.
+template <typename Backend>
+class PipelineEngine
+{
+public:
+    PipelineEngine(const Backend &backend, StageThreads threads, std::size_t queue_depth)
+        : backend_(backend), threads_(threads), queue_depth_(std::max<std::size_t>(queue_depth, 1))
+    {
+        if (!threads.encode || !threads.encrypt || !threads.evaluate || !threads.decrypt)
+        {
+            throw std::invalid_argument("every pipeline stage needs at least one thread");
+        }
+    }
+
+    std::size_t chunk_size() const
+    {
+        return backend_.slot_count();
+    }
+
+    std::size_t thread_count() const
+    {
+        return threads_.encode + threads_.encrypt + threads_.evaluate + threads_.decrypt;
+    }
+
+    // Streams source through the stages. Every stage records one sample per
+    // chunk in timer, so each stage's throughput is chunk_size() / its p50
+    // and the pipeline's approaches that of the slowest stage. The stages
+    // overlap, so those samples' memory fields are process-wide.
+    PipelineSummary run(VelocityStream &source, HETimer &timer) const
+    {
+        BoundedQueue<JobPtr> to_encode(queue_depth_), to_encrypt(queue_depth_), to_evaluate(queue_depth_),
+            to_decrypt(queue_depth_);
+
+        PipelineSummary summary;
+        std::mutex summary_mutex;
+        std::exception_ptr error;
+        std::atomic<bool> failed{ false };
+
+        std::vector<std::thread> workers;
+        // Workers of a failed pipeline keep draining their input so no
+        // producer blocks; the last worker of a stage closes its output.
+        auto start_stage = [&](std::size_t count, BoundedQueue<JobPtr> *in, BoundedQueue<JobPtr> *out, auto work) {
+            auto live = std::make_shared<std::atomic<std::size_t>>(count);
+            for (std::size_t i = 0; i < count; i++)
+            {
+                workers.emplace_back([&, in, out, live, work] {
+                    JobPtr job;
+                    while (in->pop(job))
+                    {
+                        if (failed)
+                        {
+                            continue;
+                        }
+                        try
+                        {
+                            work(*job);
+                            if (out)
+                            {
+                                out->push(std::move(job));
+                            }
+                        }
+                        catch (...)
+                        {
+                            std::lock_guard<std::mutex> lock(summary_mutex);
+                            if (!error)
+                            {
+                                error = std::current_exception();
+                            }
+                            failed = true;
+                        }
+                    }
+                    if (--*live == 0 && out)
+                    {
+                        out->close();
+                    }
+                });
+            }
+        };
+
+        start_stage(threads_.encode, &to_encode, &to_encrypt, [&](Job &job) {
+            Stopwatch stopwatch;
+            job.encoded.reset(new typename Backend::Encoded(backend_.encode(job.data)));
+            timer.record("encode", stopwatch.elapsed(true));
+        });
+        start_stage(threads_.encrypt, &to_encrypt, &to_evaluate, [&](Job &job) {
+            Stopwatch stopwatch;
+            job.encrypted.reset(new typename Backend::Encrypted(backend_.encrypt(*job.encoded)));
+            timer.record("encrypt", stopwatch.elapsed(true));
+            job.encoded.reset();
+        });
+        start_stage(threads_.evaluate, &to_evaluate, &to_decrypt, [&](Job &job) {
+            Stopwatch stopwatch;
+            job.result.reset(new typename Backend::Result(backend_.evaluate(*job.encrypted)));
+            timer.record("evaluate", stopwatch.elapsed(true));
+            job.encrypted.reset();
+        });
+        start_stage(threads_.decrypt, &to_decrypt, nullptr, [&](Job &job) {
+            Stopwatch stopwatch;
+            std::vector<double> final_vel = backend_.decrypt(*job.result, job.data.size());
+            timer.record("decrypt", stopwatch.elapsed(true));
+
+            double max_error = MaxAbsError(final_vel, ExpectedVelocity(job.data));
+            std::lock_guard<std::mutex> lock(summary_mutex);
+            summary.records += job.data.size();
+            summary.chunks++;
+            summary.max_error = std::max(summary.max_error, max_error);
+        });
+
+        // The calling thread is the source; the bounded queue throttles it
+        // to the pace of the encoders.
+        try
+        {
+            while (source.remaining() && !failed)
+            {
+                JobPtr job(new Job);
+                job->data = source.next(chunk_size());
+                to_encode.push(std::move(job));
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(summary_mutex);
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+            failed = true;
+        }
+        to_encode.close();
+
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        return summary;
+    }
+
+private:
+    struct Job
+    {
+        VelocityData data;
+        std::unique_ptr<typename Backend::Encoded> encoded;
+        std::unique_ptr<typename Backend::Encrypted> encrypted;
+        std::unique_ptr<typename Backend::Result> result;
+    };
+
+    using JobPtr = std::unique_ptr<Job>;
+
+    const Backend &backend_;
+    StageThreads threads_;
+    std::size_t queue_depth_;
+};
+
+} // namespace hebench
@@ -0,0 +1,112 @@
+/****************************************************/
+/* Rotation keys derived from the circuit           */
+/* Collects the slot rotations a computation does   */
+/* so only those keys are generated, optionally as  */
+/* a baby-step/giant-step set with far fewer keys   */
+/****************************************************/
+
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace hebench
+{
+
+// Baby-step size for rotations by 0 .. count-1: about sqrt(count), so baby
+// and giant keys come out about even.
+inline std::size_t BabyStepCount(std::size_t count)
+{
+    std::size_t baby = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+    return baby == 0 ? 1 : baby;
+}
+
+// Rotation steps (positive = left, as EvalAtIndex and SEAL's
+// rotate_rows/rotate_vector) a computation performs. Libraries' default
+// key sets cover every power of two in both directions whether the
+// circuit rotates or not.
+class RotationPlan
+{
+public:
+    // One rotation by step slots.
+    RotationPlan &rotate(int step)
+    {
+        if (step != 0)
+        {
+            steps_.insert(step);
+        }
+        return *this;
+    }
+
+    // Sum over n = 2^k adjacent slots by doubling: steps 1, 2, ..., n/2.
+    RotationPlan &window_sum(std::size_t n)
+    {
+        if (n == 0 || (n & (n - 1)) != 0)
+        {
+            throw std::invalid_argument("window sums need a power-of-two window, got " + std::to_string(n));
+        }
+        for (std::size_t step = 1; step < n; step *= 2)
+        {
+            rotate(static_cast<int>(step));
+        }
+        return *this;
+    }
+
+    // Rotations by every step in [0, count), e.g. one per diagonal of a
+    // count x count matrix. With bsgs a rotation by g*j + b is done as a
+    // giant step g*j of a baby step b: about 2*sqrt(count) keys instead of
+    // count-1, at the price of one extra rotation per giant step.
+    RotationPlan &all_steps(std::size_t count, bool bsgs)
+    {
+        if (!bsgs)
+        {
+            for (std::size_t step = 1; step < count; step++)
+            {
+                rotate(static_cast<int>(step));
+            }
+            return *this;
+        }
+        std::size_t baby = BabyStepCount(count);
+        for (std::size_t b = 1; b < baby && b < count; b++)
+        {
+            rotate(static_cast<int>(b));
+        }
+        for (std::size_t giant = baby; giant < count; giant += baby)
+        {
+            rotate(static_cast<int>(giant));
+        }
+        return *this;
+    }
+
+    RotationPlan &merge(const RotationPlan &other)
+    {
+        steps_.insert(other.steps_.begin(), other.steps_.end());
+        return *this;
+    }
+
+    const std::set<int> &steps() const
+    {
+        return steps_;
+    }
+
+    std::size_t key_count() const
+    {
+        return steps_.size();
+    }
+
+    // For PALISADE's EvalAtIndexKeyGen and SEAL's galois_keys_local(steps).
+    std::vector<std::int32_t> indices() const
+    {
+        return std::vector<std::int32_t>(steps_.begin(), steps_.end());
+    }
+
+private:
+    std::set<int> steps_;
+};
+
+} // namespace hebench
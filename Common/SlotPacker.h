@@ -0,0 +1,227 @@
+/****************************************************/
+/* Slot packing of small requests                   */
+/* Places many clients' short vectors at their own  */
+/* slot ranges of shared ciphertexts, evaluates     */
+/* each ciphertext once for all of them and         */
+/* scatters the decrypted slots back per client;    */
+/* zero guards and masks keep clients apart         */
+/****************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "ThreadPool.h"
+
+namespace hebench
+{
+
+// Client c's values sit at slots [offset, offset + size) of ciphertext.
+struct SlotRange
+{
+    std::size_t ciphertext = 0;
+    std::size_t offset = 0;
+    std::size_t size = 0;
+};
+
+// Where every client's vector goes. A slot-wise circuit (reach 0) never
+// mixes slots, so ranges are packed back to back. A circuit that rotates
+// left reads up to reach slots past each result slot (WindowSum(n): n - 1),
+// so every range is followed by reach zero slots, and ranges stay inside
+// one rotation row (Scheme::row_size) so the cyclic wrap only brings in a
+// guard. Negative rotations are not covered: write them as left ones.
+class SlotLayout
+{
+public:
+    // lengths[c]: client c's number of values. Clients are placed largest
+    // first, each in the first row with room (first-fit decreasing).
+    SlotLayout(const std::vector<std::size_t> &lengths, std::size_t slot_count, std::size_t row_size,
+               std::size_t reach = 0)
+        : slot_count_(slot_count), ranges_(lengths.size())
+    {
+        std::size_t row = reach == 0 ? slot_count : row_size;
+        if (row == 0 || slot_count % row != 0)
+        {
+            throw std::invalid_argument("rows of " + std::to_string(row) + " slots do not divide " +
+                                        std::to_string(slot_count) + " slots");
+        }
+        std::size_t rows_per_ciphertext = slot_count / row;
+
+        std::vector<std::size_t> order(lengths.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(),
+                         [&](std::size_t a, std::size_t b) { return lengths[a] > lengths[b]; });
+
+        std::vector<std::size_t> used; // slots taken in each row so far
+        for (std::size_t client : order)
+        {
+            std::size_t need = lengths[client] + reach;
+            if (lengths[client] == 0 || need > row)
+            {
+                throw std::invalid_argument("client " + std::to_string(client) + " has " +
+                                            std::to_string(lengths[client]) + " values; a packed request needs 1 to " +
+                                            std::to_string(row - std::min(row, reach)) + " here");
+            }
+            std::size_t bin = 0;
+            while (bin < used.size() && used[bin] + need > row)
+            {
+                bin++;
+            }
+            if (bin == used.size())
+            {
+                used.push_back(0);
+            }
+            ranges_[client] = { bin / rows_per_ciphertext, (bin % rows_per_ciphertext) * row + used[bin],
+                                lengths[client] };
+            used[bin] += need;
+            occupied_ += lengths[client];
+        }
+        ciphertexts_ = (used.size() + rows_per_ciphertext - 1) / rows_per_ciphertext;
+    }
+
+    // The unpacked baseline: every client alone at the start of its own
+    // ciphertext, as if each request were evaluated by itself.
+    static SlotLayout OnePerCiphertext(const std::vector<std::size_t> &lengths, std::size_t slot_count)
+    {
+        SlotLayout layout(slot_count);
+        for (std::size_t c = 0; c < lengths.size(); c++)
+        {
+            if (lengths[c] == 0 || lengths[c] > slot_count)
+            {
+                throw std::invalid_argument("client " + std::to_string(c) + " has " + std::to_string(lengths[c]) +
+                                            " values, more than a ciphertext holds");
+            }
+            layout.ranges_.push_back({ c, 0, lengths[c] });
+            layout.occupied_ += lengths[c];
+        }
+        layout.ciphertexts_ = lengths.size();
+        return layout;
+    }
+
+    std::size_t client_count() const
+    {
+        return ranges_.size();
+    }
+
+    std::size_t ciphertext_count() const
+    {
+        return ciphertexts_;
+    }
+
+    const SlotRange &range(std::size_t client) const
+    {
+        return ranges_.at(client);
+    }
+
+    // Share of the ciphertexts' slots that carry a client's value.
+    double occupancy() const
+    {
+        return ciphertexts_ == 0 ? 0 : static_cast<double>(occupied_) / (ciphertexts_ * slot_count_);
+    }
+
+    // Slots of every ciphertext: values[c] at client c's range, 0 in the
+    // guards and every unused slot.
+    std::vector<std::vector<double>> pack(const std::vector<std::vector<double>> &values) const
+    {
+        if (values.size() != ranges_.size())
+        {
+            throw std::invalid_argument("expected values for " + std::to_string(ranges_.size()) + " clients, got " +
+                                        std::to_string(values.size()));
+        }
+        std::vector<std::vector<double>> slots(ciphertexts_, std::vector<double>(slot_count_, 0));
+        for (std::size_t c = 0; c < ranges_.size(); c++)
+        {
+            const SlotRange &range = ranges_[c];
+            if (values[c].size() != range.size)
+            {
+                throw std::invalid_argument("client " + std::to_string(c) + " was laid out for " +
+                                            std::to_string(range.size) + " values, got " +
+                                            std::to_string(values[c].size()));
+            }
+            std::copy(values[c].begin(), values[c].end(), slots[range.ciphertext].begin() + range.offset);
+        }
+        return slots;
+    }
+
+    // Each client's values out of the decrypted slots of every ciphertext.
+    std::vector<std::vector<double>> scatter(const std::vector<std::vector<double>> &decrypted) const
+    {
+        std::vector<std::vector<double>> values(ranges_.size());
+        for (std::size_t c = 0; c < ranges_.size(); c++)
+        {
+            const SlotRange &range = ranges_[c];
+            const std::vector<double> &slots = decrypted.at(range.ciphertext);
+            values[c].assign(slots.begin() + range.offset, slots.begin() + range.offset + range.size);
+        }
+        return values;
+    }
+
+    // 1 on client's range, 0 everywhere else.
+    std::vector<double> mask(std::size_t client) const
+    {
+        const SlotRange &range = ranges_.at(client);
+        std::vector<double> ones(slot_count_, 0);
+        std::fill(ones.begin() + range.offset, ones.begin() + range.offset + range.size, 1.0);
+        return ones;
+    }
+
+private:
+    explicit SlotLayout(std::size_t slot_count) : slot_count_(slot_count)
+    {}
+
+    std::size_t slot_count_;
+    std::vector<SlotRange> ranges_;
+    std::size_t ciphertexts_ = 0;
+    std::size_t occupied_ = 0;
+};
+
+// One circuit input of every client, encoded at level (Scheme::encode).
+struct PackedOperand
+{
+    std::vector<std::vector<double>> values; // per client
+    std::size_t level = 0;
+};
+
+// Packs, encodes and encrypts the operands, runs body once per shared
+// ciphertext on the pool and scatters the decrypted results per client.
+// body(he, inputs) gets the operands' ciphertexts in order and returns
+// the result.
+template <typename Scheme, typename Body>
+std::vector<std::vector<double>> EvaluatePacked(const Scheme &he, const SlotLayout &layout,
+                                                const std::vector<PackedOperand> &operands, Body body,
+                                                ThreadPool &pool)
+{
+    std::vector<std::vector<std::vector<double>>> slots; // [operand][ciphertext]
+    for (const PackedOperand &operand : operands)
+    {
+        slots.push_back(layout.pack(operand.values));
+    }
+    std::vector<std::vector<double>> decrypted(layout.ciphertext_count());
+    pool.parallel_for(layout.ciphertext_count(), [&](std::size_t k) {
+        std::vector<typename Scheme::Ciphertext> inputs;
+        for (std::size_t i = 0; i < operands.size(); i++)
+        {
+            inputs.push_back(he.encrypt(he.encode(slots[i][k], operands[i].level)));
+        }
+        decrypted[k] = he.decrypt(body(he, inputs), he.slot_count());
+    });
+    return layout.scatter(decrypted);
+}
+
+// Client's slots of a packed result as a ciphertext of its own, every
+// other slot multiplied by 0, for results that go back encrypted and must
+// not carry other clients' values. depth: multiplications behind packed,
+// so the mask meets it at its level (as HECircuit.h does for constants);
+// the mask costs one more.
+template <typename Scheme>
+typename Scheme::Ciphertext MaskClient(const Scheme &he, const SlotLayout &layout, std::size_t client,
+                                       const typename Scheme::Ciphertext &packed, std::size_t depth)
+{
+    return he.rescale(he.multiply_plain(packed, he.encode(layout.mask(client), depth)));
+}
+
+} // namespace hebench
@@ -0,0 +1,150 @@
+/****************************************************/
+/* Fixed-size thread pool for the HE benchmark      */
+/* Workers are started once and reused; tasks are   */
+/* plain closures, parallel_for hands out indices   */
+/****************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hebench
+{
+
+// 0 means one thread per hardware thread.
+inline std::size_t ResolveThreadCount(std::size_t threads)
+{
+    if (threads == 0)
+    {
+        threads = std::thread::hardware_concurrency();
+    }
+    return std::max<std::size_t>(threads, 1);
+}
+
+class ThreadPool
+{
+public:
+    explicit ThreadPool(std::size_t threads = 0)
+    {
+        threads = ResolveThreadCount(threads);
+        workers_.reserve(threads);
+        for (std::size_t i = 0; i < threads; i++)
+        {
+            workers_.emplace_back([this] { work(); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        ready_.notify_all();
+        for (auto &worker : workers_)
+        {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    std::size_t size() const
+    {
+        return workers_.size();
+    }
+
+    // Runs task on a worker; the future carries its exception, if any.
+    std::future<void> submit(std::function<void()> task)
+    {
+        auto packaged = std::make_shared<std::packaged_task<void()>>(std::move(task));
+        std::future<void> done = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.emplace_back([packaged] { (*packaged)(); });
+        }
+        ready_.notify_one();
+        return done;
+    }
+
+    // Calls body(i) for every i in [0, n), indices handed out one at a time
+    // so uneven work balances itself. Blocks until all are done and rethrows
+    // the first exception; must not be called from inside a pool task.
+    template <typename F>
+    void parallel_for(std::size_t n, F &&body)
+    {
+        std::atomic<std::size_t> next{ 0 };
+        auto run = [&] {
+            for (std::size_t i = next++; i < n; i = next++)
+            {
+                body(i);
+            }
+        };
+
+        std::vector<std::future<void>> running;
+        for (std::size_t t = 0; t < std::min(n, size()); t++)
+        {
+            running.push_back(submit(run));
+        }
+
+        std::exception_ptr error;
+        for (auto &done : running)
+        {
+            try
+            {
+                done.get();
+            }
+            catch (...)
+            {
+                if (!error)
+                {
+                    error = std::current_exception();
+                    next = n; // stop handing out indices
+                }
+            }
+        }
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    void work()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+                if (tasks_.empty())
+                {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    bool stopping_ = false;
+};
+
+} // namespace hebench
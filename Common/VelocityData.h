@@ -0,0 +1,106 @@
+/****************************************************/
+/* Velocity dataset shared by all backends          */
+/* final velocity = V_i + at   m/s                  */
+/****************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace hebench
+{
+
+struct VelocityData
+{
+    std::vector<std::int64_t> initial_velocity;
+    std::vector<std::int64_t> acc;
+    std::vector<std::int64_t> times;
+
+    std::size_t size() const
+    {
+        return acc.size();
+    }
+};
+
+// Yields the dataset chunk by chunk, so inputs of any size need no more
+// memory than the chunks in flight. Values come straight from mt19937_64,
+// whose output is fixed by the standard, so the same seed gives the same
+// records on every backend and platform.
+class VelocityStream
+{
+public:
+    VelocityStream(std::size_t records, std::uint64_t seed, std::int64_t max_value)
+        : remaining_(records), rng_(seed), max_value_(static_cast<std::uint64_t>(max_value))
+    {}
+
+    std::size_t remaining() const
+    {
+        return remaining_;
+    }
+
+    // Next min(n, remaining()) records.
+    VelocityData next(std::size_t n)
+    {
+        n = std::min(n, remaining_);
+        remaining_ -= n;
+
+        VelocityData chunk;
+        chunk.initial_velocity.reserve(n);
+        chunk.acc.reserve(n);
+        chunk.times.reserve(n);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            chunk.acc.push_back(draw());
+            chunk.initial_velocity.push_back(draw());
+            chunk.times.push_back(draw());
+        }
+        return chunk;
+    }
+
+private:
+    std::int64_t draw()
+    {
+        return static_cast<std::int64_t>(rng_() % max_value_) + 1;
+    }
+
+    std::size_t remaining_;
+    std::mt19937_64 rng_;
+    std::uint64_t max_value_;
+};
+
+inline VelocityData MakeVelocityData(std::size_t n, std::uint64_t seed, std::int64_t max_value)
+{
+    return VelocityStream(n, seed, max_value).next(n);
+}
+
+inline std::vector<std::int64_t> ExpectedVelocity(const VelocityData &data)
+{
+    std::vector<std::int64_t> expected(data.size());
+    for (std::size_t i = 0; i < data.size(); i++)
+    {
+        expected[i] = data.initial_velocity[i] + data.acc[i] * data.times[i];
+    }
+    return expected;
+}
+
+// Largest |decrypted - expected|; 0 for exact schemes, small for CKKS.
+inline double MaxAbsError(const std::vector<double> &decrypted, const std::vector<std::int64_t> &expected)
+{
+    if (decrypted.size() != expected.size())
+    {
+        throw std::logic_error("decrypted result has the wrong number of records");
+    }
+    double max_error = 0;
+    for (std::size_t i = 0; i < expected.size(); i++)
+    {
+        max_error = std::max(max_error, std::fabs(decrypted[i] - static_cast<double>(expected[i])));
+    }
+    return max_error;
+}
+
+} // namespace hebench
@@ -0,0 +1,658 @@
+/****************************************************/
+/* Local encrypted-compute service                  */
+/* A long-running velocity evaluator on a Unix      */
+/* socket: context and keys are loaded once,        */
+/* concurrent requests are coalesced into batches   */
+/* on a worker pool, and request latency and queue  */
+/* depth are kept for p50/p99 reports               */
+/****************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+#include "BenchConfig.h"
+#include "HEReport.h"
+#include "HETimer.h"
+#include "ThreadPool.h"
+
+namespace hebench
+{
+
+/*****Wire Protocol*****/
+// Every message is a kind byte, the payload length (8 bytes, host order:
+// both ends are on this machine) and the payload. Evaluate carries one
+// chunk's ciphertexts (Backend::save_encrypted) and is answered by Result
+// (Backend::save_result) or Error; Stats is answered by Stats with the
+// service's report as text.
+enum class MessageKind : char
+{
+    Evaluate = 'E',
+    Result = 'R',
+    Stats = 'S',
+    Error = 'X'
+};
+
+struct Message
+{
+    MessageKind kind = MessageKind::Error;
+    std::string payload;
+};
+
+// A ring-dimension 32768 chunk with a long modulus chain stays well below.
+constexpr std::uint64_t kMaxPayloadBytes = std::uint64_t(1) << 32;
+
+inline void WriteAll(int fd, const char *data, std::size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(std::string("socket write failed: ") + std::strerror(errno));
+        }
+        data += sent;
+        size -= static_cast<std::size_t>(sent);
+    }
+}
+
+// False if the peer closed the connection before the first byte.
+inline bool ReadAll(int fd, char *data, std::size_t size)
+{
+    std::size_t done = 0;
+    while (done < size)
+    {
+        ssize_t got = ::recv(fd, data + done, size - done, 0);
+        if (got < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            throw std::runtime_error(std::string("socket read failed: ") + std::strerror(errno));
+        }
+        if (got == 0)
+        {
+            if (done == 0)
+                return false;
+            throw std::runtime_error("connection closed in the middle of a message");
+        }
+        done += static_cast<std::size_t>(got);
+    }
+    return true;
+}
+
+inline void SendMessage(int fd, MessageKind kind, const std::string &payload)
+{
+    char header[1 + sizeof(std::uint64_t)];
+    std::uint64_t size = payload.size();
+    header[0] = static_cast<char>(kind);
+    std::memcpy(header + 1, &size, sizeof(size));
+    WriteAll(fd, header, sizeof(header));
+    WriteAll(fd, payload.data(), payload.size());
+}
+
+// False once the peer has closed the connection.
+inline bool ReceiveMessage(int fd, Message &message)
+{
+    char header[1 + sizeof(std::uint64_t)];
+    if (!ReadAll(fd, header, sizeof(header)))
+    {
+        return false;
+    }
+    std::uint64_t size = 0;
+    std::memcpy(&size, header + 1, sizeof(size));
+    if (size > kMaxPayloadBytes)
+    {
+        throw std::runtime_error("message of " + std::to_string(size) + " bytes exceeds the limit");
+    }
+    message.kind = static_cast<MessageKind>(header[0]);
+    message.payload.resize(static_cast<std::size_t>(size));
+    if (size > 0 && !ReadAll(fd, &message.payload[0], message.payload.size()))
+    {
+        throw std::runtime_error("connection closed in the middle of a message");
+    }
+    return true;
+}
+
+/*****Sockets*****/
+class UnixSocket
+{
+public:
+    explicit UnixSocket(int fd = -1) : fd_(fd)
+    {}
+
+    UnixSocket(UnixSocket &&other) noexcept : fd_(other.fd_)
+    {
+        other.fd_ = -1;
+    }
+
+    UnixSocket &operator=(UnixSocket &&other) noexcept
+    {
+        std::swap(fd_, other.fd_);
+        return *this;
+    }
+
+    UnixSocket(const UnixSocket &) = delete;
+    UnixSocket &operator=(const UnixSocket &) = delete;
+
+    ~UnixSocket()
+    {
+        if (fd_ >= 0)
+        {
+            ::close(fd_);
+        }
+    }
+
+    int fd() const
+    {
+        return fd_;
+    }
+
+    // A stale socket file left by a service that did not shut down cleanly
+    // is replaced; any other file at path is an error.
+    static UnixSocket Listen(const std::string &path)
+    {
+        sockaddr_un address = Address(path);
+        struct stat info;
+        if (::lstat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode))
+        {
+            ::unlink(path.c_str());
+        }
+        UnixSocket socket(Open());
+        if (::bind(socket.fd(), reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+            ::listen(socket.fd(), SOMAXCONN) != 0)
+        {
+            throw std::runtime_error("cannot listen on " + path + ": " + std::strerror(errno));
+        }
+        return socket;
+    }
+
+    static UnixSocket Connect(const std::string &path)
+    {
+        sockaddr_un address = Address(path);
+        UnixSocket socket(Open());
+        if (::connect(socket.fd(), reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0)
+        {
+            throw std::runtime_error("cannot connect to " + path + ": " + std::strerror(errno));
+        }
+        return socket;
+    }
+
+    // Waits up to timeout for a client; an empty socket if none came.
+    UnixSocket accept(std::chrono::milliseconds timeout) const
+    {
+        pollfd ready{ fd_, POLLIN, 0 };
+        if (::poll(&ready, 1, static_cast<int>(timeout.count())) <= 0)
+        {
+            return UnixSocket();
+        }
+        return UnixSocket(::accept(fd_, nullptr, nullptr));
+    }
+
+    // Ends blocked reads on this socket from another thread.
+    void shutdown() const
+    {
+        ::shutdown(fd_, SHUT_RDWR);
+    }
+
+private:
+    static int Open()
+    {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+        {
+            throw std::runtime_error(std::string("cannot create a socket: ") + std::strerror(errno));
+        }
+        return fd;
+    }
+
+    static sockaddr_un Address(const std::string &path)
+    {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(address.sun_path))
+        {
+            throw std::invalid_argument("socket path must have 1 to " + std::to_string(sizeof(address.sun_path) - 1) +
+                                        " characters: '" + path + "'");
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size());
+        return address;
+    }
+
+    int fd_;
+};
+
+/*****Metrics*****/
+constexpr std::size_t kMetricWindow = 65536;
+
+// The most recent samples of one metric, so a service that runs for days
+// reports current percentiles in bounded memory.
+class SampleWindow
+{
+public:
+    explicit SampleWindow(std::size_t capacity = kMetricWindow) : capacity_(capacity)
+    {}
+
+    void add(double value)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (samples_.size() < capacity_)
+            samples_.push_back(value);
+        else
+            samples_[next_] = value;
+        next_ = (next_ + 1) % capacity_;
+        count_++;
+    }
+
+    // Samples seen in total, including those that left the window.
+    std::uint64_t count() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return count_;
+    }
+
+    std::vector<double> sorted() const
+    {
+        std::vector<double> values;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            values = samples_;
+        }
+        std::sort(values.begin(), values.end());
+        return values;
+    }
+
+private:
+    std::size_t capacity_;
+    mutable std::mutex mutex_;
+    std::vector<double> samples_;
+    std::size_t next_ = 0;
+    std::uint64_t count_ = 0;
+};
+
+struct MetricSummary
+{
+    std::string name;
+    std::uint64_t count = 0;
+    double p50 = 0;
+    double p99 = 0;
+    double max = 0;
+};
+
+inline MetricSummary Summarize(const std::string &name, const SampleWindow &window)
+{
+    std::vector<double> values = window.sorted();
+    MetricSummary summary;
+    summary.name = name;
+    summary.count = window.count();
+    summary.p50 = Percentile(values, 50);
+    summary.p99 = Percentile(values, 99);
+    summary.max = values.empty() ? 0 : values.back();
+    return summary;
+}
+
+/*****Service*****/
+// Serves the velocity circuit of one keyed Backend to any number of local
+// clients. A reader thread per connection queues Evaluate requests; the
+// dispatcher takes up to max_batch of them, waiting at most the batch
+// window after the first, and evaluates the batch on the worker pool while
+// the next one queues up. Backend must be safe to call concurrently, as for
+// ChunkedEngine, and provide the wire format (load_encrypted, save_result).
+template <typename Backend>
+class VelocityService
+{
+public:
+    VelocityService(const Backend &backend, const BenchConfig &config)
+        : backend_(backend), pool_(config.threads), max_batch_(config.max_batch),
+          max_pending_(4 * config.max_batch), window_(config.batch_window_us),
+          listener_(UnixSocket::Listen(config.socket_path)), path_(config.socket_path)
+    {}
+
+    ~VelocityService()
+    {
+        ::unlink(path_.c_str());
+    }
+
+    std::size_t worker_count() const
+    {
+        return pool_.size();
+    }
+
+    // Accepts and serves clients until stop is set (e.g. by a signal
+    // handler), then closes every connection and drops pending requests.
+    void run(const std::atomic<bool> &stop)
+    {
+        std::thread dispatcher([this] { dispatch(); });
+        while (!stop.load())
+        {
+            UnixSocket client = listener_.accept(std::chrono::milliseconds(200));
+            reap();
+            if (client.fd() < 0)
+            {
+                continue;
+            }
+            auto connection = std::make_shared<Connection>(std::move(client));
+            sessions_.push_back(Session{ connection, std::thread([this, connection] { read(connection); }) });
+        }
+
+        // Closing first also releases readers blocked on a full queue.
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        ready_.notify_all();
+        space_.notify_all();
+        for (Session &session : sessions_)
+        {
+            session.connection->socket.shutdown();
+            session.reader.join();
+        }
+        sessions_.clear();
+        dispatcher.join();
+    }
+
+    // Latencies in seconds, from the request's arrival to its reply: time
+    // spent queued, deserialize + evaluate + serialize, and both together.
+    // Queue depth is sampled when a batch is taken.
+    std::vector<MetricSummary> metrics() const
+    {
+        return { Summarize("request_s", request_s_), Summarize("queue_wait_s", queue_wait_s_),
+                 Summarize("evaluate_s", evaluate_s_), Summarize("queue_depth", queue_depth_),
+                 Summarize("batch_size", batch_size_) };
+    }
+
+    std::uint64_t failed() const
+    {
+        return failed_.load();
+    }
+
+    std::string report() const
+    {
+        std::ostringstream out;
+        out << "Service metrics (last " << kMetricWindow << " samples each, " << failed() << " failed requests):\n";
+        out << std::left << std::setw(16) << "" << std::right << std::setw(12) << "count" << std::setw(14) << "p50"
+            << std::setw(14) << "p99" << std::setw(14) << "max" << "\n";
+        for (const MetricSummary &metric : metrics())
+        {
+            out << std::left << std::setw(14) << metric.name << ": " << std::right << std::setw(12) << metric.count
+                << std::setw(14) << metric.p50 << std::setw(14) << metric.p99 << std::setw(14) << metric.max << "\n";
+        }
+        return out.str();
+    }
+
+    void add_rows(BenchReport &report) const
+    {
+        for (const MetricSummary &metric : metrics())
+        {
+            report.add_row()
+                .set("backend", Backend::Name())
+                .set("scheme", backend_.scheme())
+                .set("ring_dim", backend_.ring_dimension())
+                .set("workers", worker_count())
+                .set("max_batch", max_batch_)
+                .set("batch_window_us", static_cast<std::uint64_t>(window_.count()))
+                .set("metric", metric.name)
+                .set("count", metric.count)
+                .set("p50", metric.p50)
+                .set("p99", metric.p99)
+                .set("max", metric.max)
+                .set("failed", failed())
+                .set("error", "");
+        }
+    }
+
+private:
+    struct Connection
+    {
+        explicit Connection(UnixSocket socket) : socket(std::move(socket))
+        {}
+
+        // Replies from different workers must not interleave. False if the
+        // client is gone.
+        bool send(MessageKind kind, const std::string &payload)
+        {
+            std::lock_guard<std::mutex> lock(write_mutex);
+            try
+            {
+                SendMessage(socket.fd(), kind, payload);
+                return true;
+            }
+            catch (const std::exception &)
+            {
+                return false;
+            }
+        }
+
+        UnixSocket socket;
+        std::mutex write_mutex;
+        std::atomic<bool> finished{ false };
+    };
+
+    struct Session
+    {
+        std::shared_ptr<Connection> connection;
+        std::thread reader;
+    };
+
+    struct Request
+    {
+        std::shared_ptr<Connection> connection;
+        std::string payload;
+        std::chrono::steady_clock::time_point arrival;
+    };
+
+    static double SecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Joins the readers of connections that have closed.
+    void reap()
+    {
+        for (auto it = sessions_.begin(); it != sessions_.end();)
+        {
+            if (it->connection->finished.load())
+            {
+                it->reader.join();
+                it = sessions_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    void read(std::shared_ptr<Connection> connection)
+    {
+        Message message;
+        try
+        {
+            while (ReceiveMessage(connection->socket.fd(), message))
+            {
+                if (message.kind == MessageKind::Evaluate)
+                    enqueue(Request{ connection, std::move(message.payload), std::chrono::steady_clock::now() });
+                else if (message.kind == MessageKind::Stats)
+                    connection->send(MessageKind::Stats, report());
+                else
+                    connection->send(MessageKind::Error, "unexpected message kind");
+            }
+        }
+        catch (const std::exception &)
+        {
+            // A broken connection only ends its own session.
+        }
+        connection->finished.store(true);
+    }
+
+    // Blocks while max_pending_ requests wait, so a flood of clients is
+    // slowed down at their sockets instead of growing the queue.
+    void enqueue(Request request)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            space_.wait(lock, [&] { return closed_ || pending_.size() < max_pending_; });
+            if (closed_)
+            {
+                return;
+            }
+            pending_.push_back(std::move(request));
+        }
+        ready_.notify_one();
+    }
+
+    void dispatch()
+    {
+        for (;;)
+        {
+            std::vector<Request> batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                ready_.wait(lock, [&] { return closed_ || !pending_.empty(); });
+                if (closed_)
+                {
+                    return;
+                }
+                auto deadline = pending_.front().arrival + window_;
+                ready_.wait_until(lock, deadline, [&] { return closed_ || pending_.size() >= max_batch_; });
+                if (closed_)
+                {
+                    return;
+                }
+                queue_depth_.add(static_cast<double>(pending_.size()));
+                std::size_t take = std::min(max_batch_, pending_.size());
+                for (std::size_t i = 0; i < take; i++)
+                {
+                    batch.push_back(std::move(pending_.front()));
+                    pending_.pop_front();
+                }
+            }
+            space_.notify_all();
+            batch_size_.add(static_cast<double>(batch.size()));
+            pool_.parallel_for(batch.size(), [&](std::size_t i) { serve(batch[i]); });
+        }
+    }
+
+    void serve(Request &request)
+    {
+        queue_wait_s_.add(SecondsSince(request.arrival));
+        auto started = std::chrono::steady_clock::now();
+        std::string reply;
+        MessageKind kind = MessageKind::Result;
+        try
+        {
+            std::istringstream in(request.payload);
+            auto result = backend_.evaluate(backend_.load_encrypted(in));
+            std::ostringstream out;
+            backend_.save_result(result, out);
+            reply = out.str();
+        }
+        catch (const std::exception &e)
+        {
+            kind = MessageKind::Error;
+            reply = e.what();
+            failed_++;
+        }
+        evaluate_s_.add(SecondsSince(started));
+        request.connection->send(kind, reply);
+        request_s_.add(SecondsSince(request.arrival));
+    }
+
+    const Backend &backend_;
+    ThreadPool pool_;
+    std::size_t max_batch_;
+    std::size_t max_pending_;
+    std::chrono::microseconds window_;
+    UnixSocket listener_;
+    std::string path_;
+    std::list<Session> sessions_;
+
+    std::mutex mutex_;
+    std::condition_variable ready_; // a request arrived or the service closed
+    std::condition_variable space_; // a batch left the queue
+    std::deque<Request> pending_;
+    bool closed_ = false;
+
+    SampleWindow request_s_;
+    SampleWindow queue_wait_s_;
+    SampleWindow evaluate_s_;
+    SampleWindow queue_depth_;
+    SampleWindow batch_size_;
+    std::atomic<std::uint64_t> failed_{ 0 };
+};
+
+/*****Client*****/
+// One connection to a VelocityService. Backend must hold the same context
+// and keys as the service's (share its --key-cache); it encrypts and
+// decrypts here, the service only evaluates.
+template <typename Backend>
+class VelocityClient
+{
+public:
+    VelocityClient(const Backend &backend, const std::string &path)
+        : backend_(backend), socket_(UnixSocket::Connect(path))
+    {}
+
+    typename Backend::Result evaluate(const typename Backend::Encrypted &encrypted)
+    {
+        std::ostringstream out;
+        backend_.save_encrypted(encrypted, out);
+        SendMessage(socket_.fd(), MessageKind::Evaluate, out.str());
+        std::istringstream in(expect(MessageKind::Result));
+        return backend_.load_result(in);
+    }
+
+    // The service's report() text.
+    std::string stats()
+    {
+        SendMessage(socket_.fd(), MessageKind::Stats, std::string());
+        return expect(MessageKind::Stats);
+    }
+
+private:
+    std::string expect(MessageKind kind)
+    {
+        Message reply;
+        if (!ReceiveMessage(socket_.fd(), reply))
+        {
+            throw std::runtime_error("the service closed the connection");
+        }
+        if (reply.kind == MessageKind::Error)
+        {
+            throw std::runtime_error("service error: " + reply.payload);
+        }
+        if (reply.kind != kind)
+        {
+            throw std::runtime_error("unexpected reply from the service");
+        }
+        return reply.payload;
+    }
+
+    const Backend &backend_;
+    UnixSocket socket_;
+};
+
+} // namespace hebench
@@ -6,12 +6,17 @@
 /* demo-packing.cpp                                 */
 /* final velocity = V_i + at   m/s                  */
 /****************************************************/
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <time.h>
 #include <stdlib.h>
+#include <NTL/BasicThreadPool.h>
 #include <helib/helib.h>
 #include <helib/PAlgebra.h>
+#include "HETimer.h"
+#include "ThreadPool.h"
+#include "VelocityData.h"
 
 using namespace std;
 using namespace helib;
@@ -42,43 +47,33 @@ void print(vector<long> v, long length)
 
 int main()
 {
-	//findM
-	// long m=0, p=2333, r=1; // Native plaintext space
- //                        // Computations will be 'modulo p'
- //    long nbits=4;           //Levels -> nbits->Increase L will increase N
- //    long c=2;           // Columns in key switching matrix
- //    long w=64;          // Hamming weight of secret key->number of non-zero coefficients
- //    long d=1;
- //    long security = 128;
- //    long slot = 2760;
- //    //ZZX G;
- //    m=FindM(security,nbits,c,p,d,slot,0,true);
-    //std::cout << "m: " << m <<std::endl;
-    //std::cout << FindM(security,L,c,p,d,0,0) <<std::endl;
-    //--------------------------------------
-	srand(time(NULL));
+	//1 untimed warm-up run, then 10 timed repetitions of encryption, evaluation and decryption
+	hebench::HETimer timer(1, 10);
+
+	//NTL's thread pool spreads the chunks below over every core; with a single chunk
+	//HElib's own per-prime loops use it instead (HElib and NTL built with threads)
+	NTL::SetNumThreads(static_cast<long>(hebench::ResolveThreadCount(0)));
+
 	/*****Set Parameters*****/
-	clock_t cc_clock;
-	cc_clock = clock();
+	timer.start("Parameter Generation");
 
-	unsigned long prime_mod      = 2333; //55001
-	unsigned long cyc_poly       = 22; //32109
+	unsigned long prime_mod      = 65537;
 	unsigned long bits_mod_chain = 300;
-	unsigned long key_switch_col = 1;
+	unsigned long key_switch_col = 2;
+	long security                = 128;
+	long min_slots               = 4096;
+	//FindM picks the cyclotomic m with at least min_slots slots for this p, chain size
+	//and security level (m = 22, p = 2333 gave only 10 slots)
+	unsigned long cyc_poly = FindM(security, bits_mod_chain, key_switch_col, prime_mod, 0, min_slots, 0);
 
-	//
-	//std::cout << "phi(m): " << getPhiM() << std::endl;
 	//Generate context and add primes to chain
 	Context context(cyc_poly, prime_mod, 1);
-	//std::cout << "bitsPerLevel: " << context.bitsPerLevel() << std::endl;
 	buildModChain(context, bits_mod_chain, key_switch_col);
-	//std::cout << "Security: " << context.securityLevel() << std::endl;
 
-	cc_clock = clock() - cc_clock;
+	timer.stop("Parameter Generation");
 
 	//Key Generation
-	clock_t key_clock;
-	key_clock = clock();
+	timer.start("Key Generation");
 
 	SecKey secret_key(context);
 	secret_key.GenSecKey();
@@ -86,85 +81,145 @@ int main()
 	PubKey& public_key = secret_key;
 
 	const EncryptedArray& ea = *(context.ea);
-	long num_slots = ea.size(); //24
-	//std::cout << "Number of slots: " << num_slots << std::endl;
-
-	key_clock = clock() - key_clock;
-
-	std::cout << "Number of slots: " << num_slots << std::endl;
+	long num_slots = ea.size();
+
+	timer.stop("Key Generation");
+
+	std::cout << "m: " << cyc_poly << ", phi(m): " << context.zMStar.getPhiM() << ", number of slots: " << num_slots << std::endl;
+
+	//Same seeded dataset as the velocity benchmark; more records than one ciphertext
+	//holds, split into chunks of num_slots
+	size_t records = 3 * num_slots + num_slots / 2;
+	hebench::VelocityData data = hebench::MakeVelocityData(records, 1, 100);
+	long chunks = static_cast<long>((records + num_slots - 1) / num_slots);
+
+	//Encoding: one batch plaintext per operand and chunk, slots past the end stay 0
+	auto encode = [&](const vector<int64_t> &values, long chunk) {
+		vector<long> slots(num_slots, 0);
+		for (size_t i = chunk * num_slots; i < records && i < size_t(chunk + 1) * num_slots; i++)
+		{
+			slots[i - chunk * num_slots] = values[i];
+		}
+		return Ptxt<BGV>(context, slots);
+	};
+	vector<Ptxt<BGV>> ptxt_initial_vel, ptxt_times, ptxt_acc;
+	for (long c = 0; c < chunks; c++)
+	{
+		ptxt_initial_vel.push_back(encode(data.initial_velocity, c));
+		ptxt_times.push_back(encode(data.times, c));
+		ptxt_acc.push_back(encode(data.acc, c));
+	}
 
 	//Encryption
-	clock_t enc_clock;
-	enc_clock = clock();
-
-	
-
-	vector<long> initial_velocity={1,2,3,4,5,6,7,8,9,1};
-	vector<long> times= {10,14,24,23,18,9,13,7,9,1};
-	vector<long> acc={1,2,3,2,1,2,1,2,9,1};
-
-	// for(int i = 0; i < num_slots; i++)long
-	// {
-	// 	int64_t a = rand() % 25;
-	// 	acc.push_back(a);
-
-	// 	int64_t b = rand() % 50;
-	// 	initial_velocity.push_back(b);
-
-	// 	int64_t c = rand() % 30;
-	// 	times.push_back(c);
-	// }
-
-	Ctxt enc_initial_vel(public_key);
-	Ctxt enc_times(public_key);
-	Ctxt enc_acc(public_key);
-	Ctxt enc_final_vel(public_key);
-	ea.encrypt(enc_initial_vel, public_key, initial_velocity);
-	ea.encrypt(enc_times, public_key, times);
-	ea.encrypt(enc_acc, public_key, acc);
-
-	enc_clock = clock() - enc_clock;
+	vector<Ctxt> enc_initial_vel(chunks, Ctxt(public_key));
+	vector<Ctxt> enc_times(chunks, Ctxt(public_key));
+	vector<Ctxt> enc_acc(chunks, Ctxt(public_key));
+	vector<Ctxt> enc_final_vel(chunks, Ctxt(public_key));
+	timer.measure("Encryption", [&]() {
+		NTL_EXEC_RANGE(chunks, first, last)
+		for (long c = first; c < last; c++)
+		{
+			public_key.Encrypt(enc_initial_vel[c], ptxt_initial_vel[c]);
+			public_key.Encrypt(enc_times[c], ptxt_times[c]);
+			public_key.Encrypt(enc_acc[c], ptxt_acc[c]);
+		}
+		NTL_EXEC_RANGE_END
+	});
 
 	//Evaluation
-	clock_t eval_clock;
-	eval_clock = clock();
-
-	enc_final_vel += enc_acc;
-	enc_final_vel *= enc_times;
-	enc_final_vel += enc_initial_vel;
-
-	eval_clock = clock() - eval_clock;
+	//The product starts from a copy of acc; no zero ciphertext to add into first
+	timer.measure("Evaluation (v_i + at)", [&]() {
+		NTL_EXEC_RANGE(chunks, first, last)
+		for (long c = first; c < last; c++)
+		{
+			Ctxt enc_vel(enc_acc[c]);
+			enc_vel.multiplyBy(enc_times[c]);
+			enc_vel += enc_initial_vel[c];
+			enc_final_vel[c] = enc_vel;
+		}
+		NTL_EXEC_RANGE_END
+	});
+
+	//Evaluation with public times
+	//When t is known to the evaluator it stays a plaintext, converted to DoubleCRT (NTT form) once;
+	//multByConstant needs no key switching and adds far less noise than a ciphertext product
+	vector<DoubleCRT> dcrt_times;
+	for (long c = 0; c < chunks; c++)
+	{
+		dcrt_times.emplace_back(ptxt_times[c].getPolyRepr(), context, context.fullPrimes());
+	}
+	vector<Ctxt> enc_final_vel_public(chunks, Ctxt(public_key));
+	timer.measure("Evaluation (v_i + at, public t)", [&]() {
+		NTL_EXEC_RANGE(chunks, first, last)
+		for (long c = first; c < last; c++)
+		{
+			Ctxt enc_vel(enc_acc[c]);
+			enc_vel.multByConstant(dcrt_times[c]);
+			enc_vel += enc_initial_vel[c];
+			enc_final_vel_public[c] = enc_vel;
+		}
+		NTL_EXEC_RANGE_END
+	});
 
 	//Decrypt
-	clock_t dec_clock;
-	dec_clock = clock();
-
+	auto decrypt = [&](const vector<Ctxt> &results) {
+		vector<long> values(records);
+		NTL_EXEC_RANGE(chunks, first, last)
+		for (long c = first; c < last; c++)
+		{
+			Ptxt<BGV> plain(context);
+			secret_key.Decrypt(plain, results[c]);
+			auto slots = plain.getSlotRepr();
+			for (size_t i = c * num_slots; i < records && i < size_t(c + 1) * num_slots; i++)
+			{
+				values[i] = static_cast<long>(slots[i - c * num_slots]);
+			}
+		}
+		NTL_EXEC_RANGE_END
+		return values;
+	};
 	vector<long> final_vel;
-	ea.decrypt(enc_final_vel, secret_key, final_vel);
+	timer.measure("Decryption", [&]() {
+		final_vel = decrypt(enc_final_vel);
+	});
 
-	dec_clock = clock() - dec_clock;
 	/*****Print*****/
-	//cout << "Starting the velocity caluculator with " << num_slots << " instances. "<< endl << endl;
-
-	std::cout << "initial_velocity \n\t" << initial_velocity << std::endl;
-	//print(initial_velocity, num_slots);
-
-	std::cout << "time \n\t" << times << std::endl;
-	//print(times, num_slots);
-
-	std::cout << "Acceleration \n\t " << acc << std::endl;
-	//print(acc, num_slots);
-
-	cout << "Final Velocity: " << endl;
-	std::cout << "final_vel \n\t" << final_vel << std::endl;
-	//print(final_vel, num_slots);
-
-	cout << "Times:" <<endl;
-	cout << "Parameter Generation  : " << ((float)cc_clock)/CLOCKS_PER_SEC << endl;
-	cout << "Key Generation        : " << ((float)key_clock)/CLOCKS_PER_SEC << endl;
-	cout << "Encryption            : " << ((float)enc_clock)/CLOCKS_PER_SEC << endl;
-	cout << "Evaluation (v_i + at) : " << ((float)eval_clock)/CLOCKS_PER_SEC << endl;
-	cout << "Decryption            : " << ((float)dec_clock)/CLOCKS_PER_SEC << endl;
+	cout << "Starting the velocity calculator with " << records << " instances in " << chunks << " chunks. " << endl << endl;
+
+	cout << "initial_velocity";
+	print(vector<long>(data.initial_velocity.begin(), data.initial_velocity.end()), records);
+
+	cout << "time";
+	print(vector<long>(data.times.begin(), data.times.end()), records);
+
+	cout << "Acceleration";
+	print(vector<long>(data.acc.begin(), data.acc.end()), records);
+
+	cout << "Final Velocity: ";
+	print(final_vel, records);
+
+	vector<int64_t> expected = hebench::ExpectedVelocity(data);
+	cout << "Matches the plaintext result: " << boolalpha << equal(final_vel.begin(), final_vel.end(), expected.begin()) << endl;
+
+	vector<long> final_vel_public = decrypt(enc_final_vel_public);
+	cout << "Public t gives the same result: " << boolalpha << (final_vel_public == final_vel) << endl;
+	cout << "Capacity left: " << enc_final_vel[0].bitCapacity() << " bits (encrypted t), "
+		 << enc_final_vel_public[0].bitCapacity() << " bits (public t)" << endl;
+
+	/*****Object Sizes*****/
+	//Binary serialized sizes; the public key also holds the key-switching matrices
+	cout << "Serialized sizes:" << endl;
+	hebench::PrintObjectSize(cout, { "Public key", hebench::SerializedBytes([&](std::ostream &out) {
+		writePubKeyBinary(out, public_key);
+	}) });
+	hebench::PrintObjectSize(cout, { "Ciphertext (input)", hebench::SerializedBytes([&](std::ostream &out) {
+		enc_acc[0].write(out);
+	}) });
+	hebench::PrintObjectSize(cout, { "Ciphertext (result)", hebench::SerializedBytes([&](std::ostream &out) {
+		enc_final_vel[0].write(out);
+	}) });
+
+	timer.print(cout);
 	return 0;
 
 }
@@ -0,0 +1,294 @@
+/****************************************************/
+/* HElib backend for the velocity benchmark         */
+/* Same workload as HElibBGV.cpp                    */
+/* final velocity = V_i + at   m/s                  */
+/****************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <NTL/BasicThreadPool.h>
+#include <helib/helib.h>
+#include "BenchConfig.h"
+#include "Compression.h"
+#include "HElibContext.h"
+#include "HEMemory.h"
+#include "KeyCache.h"
+#include "ThreadPool.h"
+#include "VelocityData.h"
+
+namespace hebench
+{
+
+class HElibBackend
+{
+public:
+    // Batch (Ptxt) plaintexts, one value per slot.
+    struct Encoded
+    {
+        helib::Ptxt<helib::BGV> initial_velocity;
+        helib::Ptxt<helib::BGV> acc;
+        helib::Ptxt<helib::BGV> times;
+    };
+
+    // A public operand is kept as a DoubleCRT (the NTT form multByConstant
+    // and addConstant work in); its ciphertext member stays empty.
+    struct Encrypted
+    {
+        helib::Ctxt initial_velocity;
+        helib::Ctxt acc;
+        helib::Ctxt times;
+        std::unique_ptr<helib::DoubleCRT> public_initial_velocity;
+        std::unique_ptr<helib::DoubleCRT> public_acc;
+        std::unique_ptr<helib::DoubleCRT> public_times;
+    };
+
+    using Result = helib::Ctxt;
+
+    static const char *Name()
+    {
+        return "helib";
+    }
+
+    // HElib only implements BGV; BFV runs are mapped onto it so the
+    // integer workload can be compared against the other backends.
+    static bool Supports(const std::string &scheme)
+    {
+        return scheme == "bgv" || scheme == "bfv";
+    }
+
+    /*****Set Parameters*****/
+    // HElibContext.h picks the cyclotomic and chain and rejects ones below
+    // --security; a cached context is checked again, as it may predate that.
+    // buildModChain's prime search dominates setup; a cached context skips it.
+    // NTL's thread pool parallelizes HElib's per-prime loops in setup, keygen
+    // and whatever else runs on this thread; chunks run on the engine's threads.
+    explicit HElibBackend(const BenchConfig &config)
+        : config_(config), public_(config.public_operands), cache_(config.key_cache, std::string(Name()) + " " + helib::version::asString + " " + ParameterKey(config))
+    {
+        if (!Supports(config.scheme))
+        {
+            throw std::invalid_argument("HElib does not support the " + config.scheme + " scheme");
+        }
+        NTL::SetNumThreads(static_cast<long>(ResolveThreadCount(config.threads)));
+        if (cache_.load("context", [&](std::istream &in) {
+                context_ = helib::buildContextFromBinary(in);
+                helib::readContextBinary(in, *context_);
+            }))
+        {
+            CheckHElibSecurity(*context_, config.security);
+            return;
+        }
+
+        context_ = BuildHElibContext(config);
+
+        cache_.store("context", [&](std::ostream &out) {
+            helib::writeContextBaseBinary(out, *context_);
+            helib::writeContextBinary(out, *context_);
+        });
+    }
+
+    /*****Key Generation*****/
+    // The secret key file carries the public key and key-switching matrices
+    // too, so the whole key set is renamed into place at once.
+    void keygen()
+    {
+        secret_key_ = std::make_unique<helib::SecKey>(*context_);
+        keys_cached_ = cache_.load("secret_key", [&](std::istream &in) { helib::readSecKeyBinary(in, *secret_key_); });
+        if (!keys_cached_)
+        {
+            secret_key_->GenSecKey();
+            cache_.store("secret_key", [&](std::ostream &out) { helib::writeSecKeyBinary(out, *secret_key_); });
+        }
+    }
+
+    // "off", "hit" (keys loaded from the cache) or "miss" (generated and stored).
+    const char *key_cache_status() const
+    {
+        return !cache_.enabled() ? "off" : keys_cached_ ? "hit" : "miss";
+    }
+
+    std::string scheme() const
+    {
+        return "bgv";
+    }
+
+    std::size_t ring_dimension() const
+    {
+        return context_->zMStar.getPhiM();
+    }
+
+    std::size_t slot_count() const
+    {
+        return context_->ea->size();
+    }
+
+    /*****Encode*****/
+    Encoded encode(const VelocityData &data) const
+    {
+        if (data.size() > slot_count())
+        {
+            throw std::invalid_argument("more records than slots in one HElib ciphertext");
+        }
+        return { encode_vector(data.initial_velocity), encode_vector(data.acc), encode_vector(data.times) };
+    }
+
+    /*****Encryption*****/
+    // Public operands are converted to DoubleCRT here, once per chunk;
+    // passing the ZZX would convert it again on every operation.
+    Encrypted encrypt(const Encoded &encoded) const
+    {
+        const helib::PubKey &public_key = *secret_key_;
+        Encrypted encrypted{ helib::Ctxt(public_key), helib::Ctxt(public_key), helib::Ctxt(public_key) };
+        if (public_.initial_velocity)
+            encrypted.public_initial_velocity = double_crt(encoded.initial_velocity);
+        else
+            public_key.Encrypt(encrypted.initial_velocity, encoded.initial_velocity);
+        if (public_.acc)
+            encrypted.public_acc = double_crt(encoded.acc);
+        else
+            public_key.Encrypt(encrypted.acc, encoded.acc);
+        if (public_.times)
+            encrypted.public_times = double_crt(encoded.times);
+        else
+            public_key.Encrypt(encrypted.times, encoded.times);
+        return encrypted;
+    }
+
+    /*****Evaluation*****/
+    Result evaluate(const Encrypted &encrypted) const
+    {
+        helib::Ctxt enc_final_vel(public_.acc ? encrypted.times : encrypted.acc);
+        if (public_.acc)
+            enc_final_vel.multByConstant(*encrypted.public_acc);
+        else if (public_.times)
+            enc_final_vel.multByConstant(*encrypted.public_times);
+        else
+            enc_final_vel.multiplyBy(encrypted.times);
+
+        if (public_.initial_velocity)
+            enc_final_vel.addConstant(*encrypted.public_initial_velocity);
+        else
+            enc_final_vel += encrypted.initial_velocity;
+        return enc_final_vel;
+    }
+
+    /*****Wire Format*****/
+    // One chunk as the evaluation service (VelocityService.h) exchanges it:
+    // the three input ciphertexts up, the result down, in Ctxt's binary form.
+    void save_encrypted(const Encrypted &encrypted, std::ostream &out) const
+    {
+        encrypted.initial_velocity.write(out);
+        encrypted.acc.write(out);
+        encrypted.times.write(out);
+    }
+
+    Encrypted load_encrypted(std::istream &in) const
+    {
+        const helib::PubKey &public_key = *secret_key_;
+        Encrypted encrypted{ helib::Ctxt(public_key), helib::Ctxt(public_key), helib::Ctxt(public_key) };
+        encrypted.initial_velocity.read(in);
+        encrypted.acc.read(in);
+        encrypted.times.read(in);
+        return encrypted;
+    }
+
+    void save_result(const Result &result, std::ostream &out) const
+    {
+        result.write(out);
+    }
+
+    Result load_result(std::istream &in) const
+    {
+        Result result(*secret_key_);
+        result.read(in);
+        return result;
+    }
+
+    /*****Noise Budget*****/
+    // Bits of modulus left above the noise estimate.
+    int noise_budget_bits(const Result &result) const
+    {
+        return static_cast<int>(result.bitCapacity());
+    }
+
+    /*****Decrypt*****/
+    std::vector<double> decrypt(const Result &result, std::size_t n) const
+    {
+        helib::Ptxt<helib::BGV> plain_final_vel(*context_);
+        secret_key_->Decrypt(plain_final_vel, result);
+        auto decoded = plain_final_vel.getSlotRepr();
+
+        std::vector<double> final_vel(n);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            final_vel[i] = static_cast<double>(static_cast<long>(decoded[i]));
+        }
+        return final_vel;
+    }
+
+    /*****Object Sizes*****/
+    // HElib keeps the key-switching (relinearization) matrices inside the
+    // public key, so public_key covers both.
+    std::vector<ObjectSize> object_sizes(const Encrypted &encrypted, const Result &result) const
+    {
+        const helib::PubKey &public_key = *secret_key_;
+        const helib::Ctxt &input = public_.acc ? encrypted.times : encrypted.acc;
+        return { { "public_key",
+                   SerializedBytes([&](std::ostream &out) { helib::writePubKeyBinary(out, public_key); }) },
+                 { "input_ciphertext", SerializedBytes([&](std::ostream &out) { input.write(out); }) },
+                 { "result_ciphertext", SerializedBytes([&](std::ostream &out) { result.write(out); }) } };
+    }
+
+    /*****Transport Sizes*****/
+    // Bytes on the wire for one chunk. HElib has no seeded or symmetric
+    // upload format and results keep their primes, so only compression
+    // applies. Public operands are not uploaded.
+    std::vector<ObjectSize> transport_sizes(const Encoded &encoded, const Result &result,
+                                            const std::string &compression) const
+    {
+        Encrypted encrypted = encrypt(encoded);
+        std::uint64_t upload = 0;
+        for (auto operand : { std::make_pair(public_.initial_velocity, &encrypted.initial_velocity),
+                              std::make_pair(public_.acc, &encrypted.acc),
+                              std::make_pair(public_.times, &encrypted.times) })
+        {
+            if (!operand.first)
+            {
+                upload += CompressedSerializedBytes(compression, [&](std::ostream &out) { operand.second->write(out); });
+            }
+        }
+        std::uint64_t download = CompressedSerializedBytes(compression, [&](std::ostream &out) { result.write(out); });
+        return { { "upload_ciphertexts", upload }, { "download_ciphertext", download } };
+    }
+
+private:
+    std::unique_ptr<helib::DoubleCRT> double_crt(const helib::Ptxt<helib::BGV> &plain) const
+    {
+        return std::make_unique<helib::DoubleCRT>(plain.getPolyRepr(), *context_, context_->fullPrimes());
+    }
+
+    // Slots past the end of the chunk stay 0.
+    helib::Ptxt<helib::BGV> encode_vector(const std::vector<std::int64_t> &values) const
+    {
+        std::vector<long> slots(slot_count(), 0);
+        std::copy(values.begin(), values.end(), slots.begin());
+        return helib::Ptxt<helib::BGV>(*context_, slots);
+    }
+
+    BenchConfig config_;
+    PublicOperands public_;
+    KeyCache cache_;
+    bool keys_cached_ = false;
+
+    std::unique_ptr<helib::Context> context_;
+    std::unique_ptr<helib::SecKey> secret_key_;
+};
+
+} // namespace hebench
@@ -0,0 +1,84 @@
+/****************************************************/
+/* HElib context for a benchmark config             */
+/* Cyclotomic and modulus chain shared by           */
+/* HElibBackend and HElibScheme, checked against    */
+/* the requested security level                     */
+/****************************************************/
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <helib/helib.h>
+#include "BenchConfig.h"
+#include "ParameterPlanner.h"
+
+namespace hebench
+{
+
+// A planned chain (--params auto) gives the ciphertext modulus bits;
+// otherwise they follow from --depth with the planner's noise estimate.
+// HElib adds its key-switching primes on top, as the special prime.
+inline unsigned long HElibChainBits(const BenchConfig &config)
+{
+    if (!config.coeff_bits.empty())
+    {
+        return static_cast<unsigned long>(PlannedParameters(config).ciphertext_bits());
+    }
+    return static_cast<unsigned long>(IntegerChainBits(config.ring_dim, config.plain_modulus, config.depth));
+}
+
+// Power-of-two rings are held to the HE standard's bound on the whole
+// modulus, as PlanParameters and SEAL do; the other cyclotomics FindM
+// picks have no table entry, so HElib's own estimate decides there.
+inline void CheckHElibSecurity(const helib::Context &context, std::uint32_t security)
+{
+    long phi_m = context.zMStar.getPhiM();
+    if ((phi_m & (phi_m - 1)) == 0)
+    {
+        int bits = static_cast<int>(std::ceil(context.logOfProduct(context.fullPrimes()) / std::log(2.0)));
+        int limit = MaxCoeffModulusBits(static_cast<std::size_t>(phi_m), security);
+        if (bits > limit)
+        {
+            throw std::invalid_argument("HElib modulus of " + std::to_string(bits) + " bits at ring dimension " +
+                                        std::to_string(phi_m) + " is below " + std::to_string(security) +
+                                        "-bit security (at most " + std::to_string(limit) +
+                                        " bits); lower --depth or raise --ring-dim");
+        }
+    }
+    else if (context.securityLevel() < security)
+    {
+        throw std::invalid_argument("HElib estimates " + std::to_string(context.securityLevel()) +
+                                    " bits of security for m = " + std::to_string(context.zMStar.getM()) +
+                                    ", below the requested " + std::to_string(security));
+    }
+}
+
+// m = 2 * ring_dim gives a power-of-two cyclotomic with the same ring
+// dimension as SEAL/PALISADE; p = 1 mod m then gives one slot per coefficient.
+// Any other p would leave few slots there (HElibBGV.cpp's old m = 22 had
+// 10), so FindM picks an m with at least ring_dim / 2 slots for p and the
+// chain at --security instead.
+inline std::unique_ptr<helib::Context> BuildHElibContext(const BenchConfig &config)
+{
+    unsigned long bits_mod_chain = HElibChainBits(config);
+    unsigned long key_switch_col = 2;
+
+    unsigned long cyc_poly = 2 * config.ring_dim;
+    if (config.plain_modulus % cyc_poly != 1)
+    {
+        cyc_poly = static_cast<unsigned long>(helib::FindM(
+            config.security, static_cast<long>(bits_mod_chain), static_cast<long>(key_switch_col),
+            static_cast<long>(config.plain_modulus), 0, static_cast<long>(config.ring_dim / 2), 0));
+    }
+
+    auto context = std::make_unique<helib::Context>(cyc_poly, config.plain_modulus, 1);
+    helib::buildModChain(*context, bits_mod_chain, key_switch_col);
+    CheckHElibSecurity(*context, config.security);
+    return context;
+}
+
+} // namespace hebench
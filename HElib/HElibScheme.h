@@ -0,0 +1,178 @@
+/****************************************************/
+/* HElib implementation of the generic HE interface */
+/* BGV behind the operations HEScheme.h lists       */
+/****************************************************/
+
+#pragma once
+
+#include <cmath>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <NTL/BasicThreadPool.h>
+#include <helib/helib.h>
+#include "BenchConfig.h"
+#include "HElibContext.h"
+#include "RotationPlan.h"
+#include "ThreadPool.h"
+
+namespace hebench
+{
+
+class HElibScheme
+{
+public:
+    using Plaintext = helib::Ptxt<helib::BGV>;
+    using Ciphertext = helib::Ctxt;
+
+    static const char *Name()
+    {
+        return "helib";
+    }
+
+    // BFV runs are mapped onto BGV, as in HElibBackend.
+    static bool Supports(const std::string &scheme)
+    {
+        return scheme == "bgv" || scheme == "bfv";
+    }
+
+    /*****Context*****/
+    // Same cyclotomic and chain as HElibBackend for the same config.
+    explicit HElibScheme(const BenchConfig &config) : config_(config)
+    {
+        if (!Supports(config.scheme))
+        {
+            throw std::invalid_argument("HElib does not support the " + config.scheme + " scheme");
+        }
+        NTL::SetNumThreads(static_cast<long>(ResolveThreadCount(config.threads)));
+
+        context_ = BuildHElibContext(config);
+    }
+
+    // The relinearization matrix comes with GenSecKey; rotations add the
+    // 1D key-switching matrices ea->rotate composes any step from.
+    void keygen(const RotationPlan &rotations = RotationPlan())
+    {
+        secret_key_ = std::make_unique<helib::SecKey>(*context_);
+        secret_key_->GenSecKey();
+        if (rotations.key_count() > 0)
+        {
+            helib::addSome1DMatrices(*secret_key_);
+        }
+    }
+
+    std::size_t slot_count() const
+    {
+        return context_->ea->size();
+    }
+
+    // ea->rotate cycles through every slot.
+    std::size_t row_size() const
+    {
+        return slot_count();
+    }
+
+    /*****Encode, encrypt, decrypt*****/
+    // HElib switches moduli itself, so level does not change the encoding.
+    // Values are rounded; slots past the end stay 0.
+    Plaintext encode(const std::vector<double> &values, std::size_t = 0) const
+    {
+        std::vector<long> slots(slot_count(), 0);
+        for (std::size_t i = 0; i < values.size(); i++)
+        {
+            slots[i] = std::lround(values[i]);
+        }
+        return Plaintext(*context_, slots);
+    }
+
+    Ciphertext encrypt(const Plaintext &plain) const
+    {
+        const helib::PubKey &public_key = *secret_key_;
+        Ciphertext encrypted(public_key);
+        public_key.Encrypt(encrypted, plain);
+        return encrypted;
+    }
+
+    // Values come back centered in (-p/2, p/2], as PALISADE's do.
+    std::vector<double> decrypt(const Ciphertext &encrypted, std::size_t n) const
+    {
+        Plaintext plain(*context_);
+        secret_key_->Decrypt(plain, encrypted);
+        auto decoded = plain.getSlotRepr();
+
+        long p = static_cast<long>(config_.plain_modulus);
+        std::vector<double> values(n);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            long value = static_cast<long>(decoded[i]);
+            values[i] = static_cast<double>(value > p / 2 ? value - p : value);
+        }
+        return values;
+    }
+
+    /*****Evaluate*****/
+    Ciphertext add(const Ciphertext &a, const Ciphertext &b) const
+    {
+        Ciphertext sum(a);
+        sum += b;
+        return sum;
+    }
+
+    Ciphertext add_plain(const Ciphertext &a, const Plaintext &plain) const
+    {
+        Ciphertext sum(a);
+        sum += plain;
+        return sum;
+    }
+
+    // Unrelinearized: multLowLvl skips multiplyBy's key switch.
+    Ciphertext multiply(const Ciphertext &a, const Ciphertext &b) const
+    {
+        Ciphertext product(a);
+        product.multLowLvl(b);
+        return product;
+    }
+
+    Ciphertext multiply_plain(const Ciphertext &a, const Plaintext &plain) const
+    {
+        Ciphertext product(a);
+        product *= plain;
+        return product;
+    }
+
+    Ciphertext relinearize(const Ciphertext &a) const
+    {
+        Ciphertext relinearized(a);
+        relinearized.reLinearize();
+        return relinearized;
+    }
+
+    // HElib modulus-switches before each multiplication by itself.
+    Ciphertext rescale(const Ciphertext &a) const
+    {
+        return a;
+    }
+
+    // Ctxt operators match prime sets themselves.
+    Ciphertext align(const Ciphertext &y, const Ciphertext &) const
+    {
+        return y;
+    }
+
+    // Left by step slots; EncryptedArray::rotate rotates right.
+    Ciphertext rotate(const Ciphertext &a, int step) const
+    {
+        Ciphertext rotated = relinearize(a);
+        context_->ea->rotate(rotated, -step);
+        return rotated;
+    }
+
+private:
+    BenchConfig config_;
+
+    std::unique_ptr<helib::Context> context_;
+    std::unique_ptr<helib::SecKey> secret_key_;
+};
+
+} // namespace hebench
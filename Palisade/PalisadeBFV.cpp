@@ -13,6 +13,8 @@
 #include <vector>
 #include <time.h>
 #include <stdlib.h>
+#include "HETimer.h"
+#include "PalisadeMultiplyAdd.h"
 
 using namespace std;
 using namespace lbcrypto;
@@ -50,9 +52,11 @@ int main()
 	#endif
 	srand(time(NULL));
 
+	//1 untimed warm-up run, then 10 timed repetitions of encryption, evaluation and decryption
+	hebench::HETimer timer(1, 10);
+
 	/*****Set up the CryptoContext*****/
-	clock_t cc_clock;
-	cc_clock = clock();
+	timer.start("Parameter Generation");
 	//Parameter Selection based on standard parameters from HE standardization workshop
  	int plaintextModulus = 65537; //536903681 //1032193 //786433 //65537
  	//cout << "plaintextModulus " << plaintextModulus << endl;
@@ -68,11 +72,10 @@ int main()
 	cryptoContext->Enable(ENCRYPTION);
 	cryptoContext->Enable(SHE);
 	//std::cout << "securityLevel:" << securityLevel << std::endl;
-	cc_clock = clock() - cc_clock;
+	timer.stop("Parameter Generation");
 
 	/*****Generate Keys*****/ 
-	clock_t key_clock;
-	key_clock = clock();
+	timer.start("Key Generation");
 
 	//Create the container for the public key   
 	LPKeyPair<DCRTPoly> keyPair;
@@ -83,14 +86,11 @@ int main()
 	//Generate the relinearization key
 	cryptoContext->EvalMultKeyGen(keyPair.secretKey); 
 
-	//Generate the Sun Key
-	cryptoContext->EvalSumKeyGen(keyPair.secretKey);
+	//No EvalSum/rotation keys: v_i + at never rotates
 
-	key_clock = clock() - key_clock;
+	timer.stop("Key Generation");
 
 	/*****Encryption*****/
-	clock_t enc_clock;
-	enc_clock = clock();
 
 	//Create and encode the plaintext vectors and variables
     int N = 8192; //2760 8192 16384 32768
@@ -110,36 +110,59 @@ int main()
 		times.push_back(c);
 	}
 
-	//std::cout<< acc.size() << std::endl;
-	Plaintext plain_acc = cryptoContext->MakePackedPlaintext(acc);
-	Plaintext plain_initial_vel = cryptoContext->MakePackedPlaintext(initial_velocity);
-	Plaintext plain_times = cryptoContext->MakePackedPlaintext(times);
-	//Plaintext plain_N_mean = cryptoContext->MakePackedPlaintext(N_mean); //linear regression
+	Plaintext plain_acc, plain_initial_vel, plain_times;
+	Ciphertext<DCRTPoly> enc_acc, enc_initial_vel, enc_times;
 
-	//Encrypt the encodings
-	auto enc_acc = cryptoContext->Encrypt(keyPair.publicKey, plain_acc);
-	auto enc_initial_vel = cryptoContext->Encrypt(keyPair.publicKey, plain_initial_vel);
-	auto enc_times = cryptoContext->Encrypt(keyPair.publicKey, plain_times);
-	//auto enc_N_mean = cryptoContext->Encrypt(keyPair.publicKey, plain_N_mean); //linear regression
+	timer.measure("Encryption", [&]() {
+		//std::cout<< acc.size() << std::endl;
+		plain_acc = cryptoContext->MakePackedPlaintext(acc);
+		plain_initial_vel = cryptoContext->MakePackedPlaintext(initial_velocity);
+		plain_times = cryptoContext->MakePackedPlaintext(times);
+		//Plaintext plain_N_mean = cryptoContext->MakePackedPlaintext(N_mean); //linear regression
 
-	enc_clock = clock() - enc_clock;
+		//Encrypt the encodings
+		enc_acc = cryptoContext->Encrypt(keyPair.publicKey, plain_acc);
+		enc_initial_vel = cryptoContext->Encrypt(keyPair.publicKey, plain_initial_vel);
+		enc_times = cryptoContext->Encrypt(keyPair.publicKey, plain_times);
+		//auto enc_N_mean = cryptoContext->Encrypt(keyPair.publicKey, plain_N_mean); //linear regression
+	});
 
 	/*****Evaluation*****/
-  	clock_t eval_clock;
-	eval_clock = clock();
-
-	auto enc_acc_mult_times = cryptoContext->EvalMult(enc_acc, enc_times);                  
-	auto enc_final_vel = cryptoContext->EvalAdd(enc_initial_vel, enc_acc_mult_times);			
-	eval_clock = clock() - eval_clock;
+	Ciphertext<DCRTPoly> enc_final_vel;
+
+	timer.measure("Evaluation (v_i + at)", [&]() {
+		auto enc_acc_mult_times = cryptoContext->EvalMult(enc_acc, enc_times);                  
+		enc_final_vel = cryptoContext->EvalAdd(enc_initial_vel, enc_acc_mult_times);
+	});
+
+	/*****Evaluation with public times*****/
+	//When t is known to the evaluator it stays a plaintext, moved to evaluation (NTT) form once;
+	//EvalMult(ciphertext, plaintext) then needs no relinearization and adds far less noise
+	Plaintext plain_times_public = cryptoContext->MakePackedPlaintext(times);
+	plain_times_public->SetFormat(EVALUATION);
+	Ciphertext<DCRTPoly> enc_final_vel_public;
+
+	timer.measure("Evaluation (v_i + at, public t)", [&]() {
+		auto enc_acc_mult_times = cryptoContext->EvalMult(enc_acc, plain_times_public);
+		enc_final_vel_public = cryptoContext->EvalAdd(enc_initial_vel, enc_acc_mult_times);
+	});
+
+	/*****Evaluation with an in-place add*****/
+	//v_i is added into the product's own buffer (EvalAddInPlace) instead of a third ciphertext;
+	//the multiply and its relinearization are the same as above
+	hebench::MultiplyAccumulator fused(cryptoContext);
+	Ciphertext<DCRTPoly> enc_final_vel_fused;
+
+	timer.measure("Evaluation (v_i + at, in place)", [&]() {
+		enc_final_vel_fused = fused.multiply_then_add(enc_initial_vel, enc_acc, enc_times);
+	});
 
 	/*****Decryption*****/
-	clock_t dec_clock;
-	dec_clock = clock();
-
 	Plaintext plain_final_velocity;
-	cryptoContext->Decrypt(keyPair.secretKey, enc_final_vel, &plain_final_velocity);
 
-	dec_clock = clock() - dec_clock;
+	timer.measure("Decryption", [&]() {
+		cryptoContext->Decrypt(keyPair.secretKey, enc_final_vel, &plain_final_velocity);
+	});
 
 	/*****Print*****/
 	cout << "Starting the velocity caluculator with " << N << " instances. "<< endl << endl;
@@ -156,12 +179,17 @@ int main()
 	cout << " Final Velocity: " << endl;
 	print(plain_final_velocity, N);
 
-	cout << "Times:" <<endl;
-	cout << "Parameter Generation  : " << ((float)cc_clock)/CLOCKS_PER_SEC << endl;
-	cout << "Key Generation        : " << ((float)key_clock)/CLOCKS_PER_SEC << endl;
-	cout << "Encryption            : " << ((float)enc_clock)/CLOCKS_PER_SEC << endl;
-	cout << "Evaluation (v_i + at) : " << ((float)eval_clock)/CLOCKS_PER_SEC << endl;
-	cout << "Decryption            : " << ((float)dec_clock)/CLOCKS_PER_SEC << endl;
+	Plaintext plain_final_velocity_public;
+	cryptoContext->Decrypt(keyPair.secretKey, enc_final_vel_public, &plain_final_velocity_public);
+	cout << "Public t gives the same result: " << boolalpha
+		 << (plain_final_velocity_public->GetPackedValue() == plain_final_velocity->GetPackedValue()) << endl;
+
+	Plaintext plain_final_velocity_fused;
+	cryptoContext->Decrypt(keyPair.secretKey, enc_final_vel_fused, &plain_final_velocity_fused);
+	cout << "Fused multiply-add gives the same result: " << boolalpha
+		 << (plain_final_velocity_fused->GetPackedValue() == plain_final_velocity->GetPackedValue()) << endl;
+
+	timer.print(cout);
 	return 0;
 }
 
@@ -13,6 +13,8 @@
 #include <vector>
 #include <time.h>
 #include <stdlib.h>
+#include "HETimer.h"
+#include "PalisadeReduction.h"
 
 using namespace std;
 using namespace lbcrypto;
@@ -40,7 +42,7 @@ using namespace lbcrypto;
 	    
 	    cout << endl;
 	};
-int main()
+int main(int argc, char *argv[])
 {
 
 	//Check to see if BFVrns is available
@@ -50,14 +52,21 @@ int main()
 	#endif
 	srand(time(NULL));
 
+	//--evalsum also generates EvalSumKeyGen's keys and times EvalInnerProduct next to the
+	//tree inner product; by default only the rotation keys the circuit uses are generated
+	bool compare_evalsum = argc > 1 && string(argv[1]) == "--evalsum";
+
+	//1 untimed warm-up run, then 10 timed repetitions of every phase after key generation
+	hebench::HETimer timer(1, 10);
+
 	/*****Set up the CryptoContext*****/
-	clock_t cc_clock;
-	cc_clock = clock();
+	timer.start("Parameter Generation");
 	//Parameter Selection based on standard parameters from HE standardization workshop
  	int plaintextModulus = 1032193; //536903681 //1032193
 	double sigma = 3.2;
 	SecurityLevel securityLevel = HEStd_128_classic;
 	uint32_t depth = 2;
+	int N = 4096; //2760 8192 16384 32768
 
 
 	//Create the cryptoContext with the desired parameters
@@ -67,11 +76,10 @@ int main()
 	cryptoContext->Enable(ENCRYPTION);
 	cryptoContext->Enable(SHE);
 	//std::cout << "securityLevel:" << securityLevel << std::endl;
-	cc_clock = clock() - cc_clock;
+	timer.stop("Parameter Generation");
 
 	/*****Generate Keys*****/ 
-	clock_t key_clock;
-	key_clock = clock();
+	timer.start("Key Generation");
 
 	//Create the container for the public key   
 	LPKeyPair<DCRTPoly> keyPair;
@@ -82,17 +90,27 @@ int main()
 	//Generate the relinearization key
 	cryptoContext->EvalMultKeyGen(keyPair.secretKey);
 
-	//Generate the Sun Key
-	cryptoContext->EvalSumKeyGen(keyPair.secretKey);
+	timer.stop("Key Generation");
+
+	//Rotation keys derived from the circuit: only the log2(N) steps a sum over N slots performs
+	hebench::SlotReducer reducer(cryptoContext, 1);
+	hebench::RotationPlan rotations = reducer.rotations(N);
+	timer.start("Key Generation (circuit rotation keys)");
+	cryptoContext->EvalAtIndexKeyGen(keyPair.secretKey, rotations.indices());
+	timer.stop("Key Generation (circuit rotation keys)");
+	cout << "Rotation keys for the circuit: " << rotations.key_count() << endl;
 
-	key_clock = clock() - key_clock;
+	//Generate the Sun Key: EvalSumKeyGen covers every power of two up to the ring dimension
+	if (compare_evalsum)
+	{
+		timer.start("Key Generation (EvalSum keys)");
+		cryptoContext->EvalSumKeyGen(keyPair.secretKey);
+		timer.stop("Key Generation (EvalSum keys)");
+	}
 
 	/*****Encryption*****/
-	clock_t enc_clock;
-	enc_clock = clock();
 
 	//Create and encode the plaintext vectors and variables
-    int N = 4096; //2760 8192 16384 32768
 	vector<int64_t> initial_velocity; //vector<int64_t> initial_velocity={1,2,3,4,5,6,7,8,9,1}; 
 	vector<int64_t> times; //vector<int64_t> times= {10,14,24,23,18,9,13,7,9,1}; 
 	vector<int64_t> acc;  //vector<int64_t> acc={1,2,3,2,1,2,1,2,9,1}; 
@@ -109,50 +127,60 @@ int main()
 		times.push_back(c);
 	}
 
-	//std::cout<< acc.size() << std::endl;
-	Plaintext plain_acc = cryptoContext->MakePackedPlaintext(acc);
-	Plaintext plain_initial_vel = cryptoContext->MakePackedPlaintext(initial_velocity);
-	Plaintext plain_times = cryptoContext->MakePackedPlaintext(times);
-	//Plaintext plain_N_mean = cryptoContext->MakePackedPlaintext(N_mean); //linear regression
+	Plaintext plain_acc, plain_initial_vel, plain_times;
+	Ciphertext<DCRTPoly> enc_acc, enc_initial_vel, enc_times;
 
-	//Encrypt the encodings
-	auto enc_acc = cryptoContext->Encrypt(keyPair.publicKey, plain_acc);
-	auto enc_initial_vel = cryptoContext->Encrypt(keyPair.publicKey, plain_initial_vel);
-	auto enc_times = cryptoContext->Encrypt(keyPair.publicKey, plain_times);
-	//auto enc_N_mean = cryptoContext->Encrypt(keyPair.publicKey, plain_N_mean); //linear regression
+	timer.measure("Encryption", [&]() {
+		//std::cout<< acc.size() << std::endl;
+		plain_acc = cryptoContext->MakePackedPlaintext(acc);
+		plain_initial_vel = cryptoContext->MakePackedPlaintext(initial_velocity);
+		plain_times = cryptoContext->MakePackedPlaintext(times);
+		//Plaintext plain_N_mean = cryptoContext->MakePackedPlaintext(N_mean); //linear regression
 
-	enc_clock = clock() - enc_clock;
+		//Encrypt the encodings
+		enc_acc = cryptoContext->Encrypt(keyPair.publicKey, plain_acc);
+		enc_initial_vel = cryptoContext->Encrypt(keyPair.publicKey, plain_initial_vel);
+		enc_times = cryptoContext->Encrypt(keyPair.publicKey, plain_times);
+		//auto enc_N_mean = cryptoContext->Encrypt(keyPair.publicKey, plain_N_mean); //linear regression
+	});
 
 	/*****Evaluation*****/
-  	clock_t eval_clock;
-	eval_clock = clock();
-
-	auto enc_acc_mult_times = cryptoContext->EvalMult(enc_acc, enc_times);                  
-	auto enc_final_vel = cryptoContext->EvalAdd(enc_initial_vel, enc_acc_mult_times);		
+	Ciphertext<DCRTPoly> enc_final_vel;
 
-	eval_clock = clock() - eval_clock;
+	timer.measure("Evaluation (v_i + at)", [&]() {
+		auto enc_acc_mult_times = cryptoContext->EvalMult(enc_acc, enc_times);                  
+		enc_final_vel = cryptoContext->EvalAdd(enc_initial_vel, enc_acc_mult_times);
+	});
 
 	/*****Decryption*****/
-	clock_t dec_clock;
-	dec_clock = clock();
-
 	Plaintext plain_final_velocity;
-	cryptoContext->Decrypt(keyPair.secretKey, enc_final_vel, &plain_final_velocity);
 
-	dec_clock = clock() - dec_clock;
+	timer.measure("Decryption", [&]() {
+		cryptoContext->Decrypt(keyPair.secretKey, enc_final_vel, &plain_final_velocity);
+	});
 
 
-	//EvalInnerProduct
-	clock_t eval_IP_clock;
-	eval_IP_clock = clock();
-	auto enc_final_vel_InnerProduct = cryptoContext->EvalInnerProduct(enc_initial_vel,enc_initial_vel, N);
-	eval_IP_clock = clock() - eval_IP_clock;
+	//Inner product: one product, then a tree of rotations by 1, 2, 4, ...
+	Ciphertext<DCRTPoly> enc_final_vel_InnerProduct;
+	timer.measure("Tree inner product", [&]() {
+		enc_final_vel_InnerProduct = reducer.inner_product(enc_initial_vel, enc_initial_vel, N);
+	});
 
-	clock_t dec_IP_clock;
-	dec_IP_clock = clock();
 	Plaintext plain_initial_velocity_InnerProduct;
-	cryptoContext->Decrypt(keyPair.secretKey, enc_final_vel_InnerProduct, &plain_initial_velocity_InnerProduct);
-	dec_IP_clock = clock() - dec_IP_clock;
+	timer.measure("Decryption (inner product)", [&]() {
+		cryptoContext->Decrypt(keyPair.secretKey, enc_final_vel_InnerProduct, &plain_initial_velocity_InnerProduct);
+	});
+
+	//Same inner product through EvalInnerProduct and the EvalSum keys
+	Plaintext plain_evalsum_InnerProduct;
+	if (compare_evalsum)
+	{
+		Ciphertext<DCRTPoly> enc_evalsum_InnerProduct;
+		timer.measure("EvalInnerProduct", [&]() {
+			enc_evalsum_InnerProduct = cryptoContext->EvalInnerProduct(enc_initial_vel,enc_initial_vel, N);
+		});
+		cryptoContext->Decrypt(keyPair.secretKey, enc_evalsum_InnerProduct, &plain_evalsum_InnerProduct);
+	}
 
 	/*****Print*****/
 	cout << "Starting the velocity caluculator with " << N << " instances. "<< endl << endl;
@@ -175,5 +203,12 @@ int main()
 	cout << " Initial Velocity Inner Product: " << endl;
 	print(plain_initial_velocity_InnerProduct, N);
 
+	if (compare_evalsum)
+		cout << "Tree inner product matches EvalInnerProduct: " << boolalpha
+			 << (plain_initial_velocity_InnerProduct->GetPackedValue()[0] == plain_evalsum_InnerProduct->GetPackedValue()[0])
+			 << " (" << reducer.full_rotations(N) << " rotations)" << endl;
+
+	timer.print(cout);
+
 	return 0;
 }
@@ -9,10 +9,16 @@
 
 #include "palisade.h"
 #include "math/matrix.h"
+#include "ciphertext-ser.h"
+#include "cryptocontext-ser.h"
+#include "pubkeylp-ser.h"
+#include "scheme/bfvrns/bfvrns-ser.h"
 #include <iostream>
 #include <vector>
 #include <time.h>
 #include <stdlib.h>
+#include "HETimer.h"
+#include "PalisadeReduction.h"
 
 using namespace std;
 using namespace lbcrypto;
@@ -40,7 +46,7 @@ using namespace lbcrypto;
 	    
 	    cout << endl;
 	};
-int main()
+int main(int argc, char *argv[])
 {
 
 	//Check to see if BFVrns is available
@@ -50,14 +56,36 @@ int main()
 	#endif
 	srand(time(NULL));
 
+	//--evalsum also generates EvalSumKeyGen's keys and times EvalSum next to the tree sum;
+	//by default only the rotation keys the circuit uses are generated.
+	//--baby-steps B (a power of two above 1) times hoisted baby steps against B = 1 and EvalSum
+	bool compare_evalsum = false;
+	size_t baby_steps = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (arg == "--evalsum")
+			compare_evalsum = true;
+		else if (arg == "--baby-steps" && i + 1 < argc)
+			baby_steps = stoul(argv[++i]);
+		else
+		{
+			cerr << "usage: " << argv[0] << " [--evalsum] [--baby-steps B]" << endl;
+			return 1;
+		}
+	}
+
+	//1 untimed warm-up run, then 10 timed repetitions of every phase after key generation
+	hebench::HETimer timer(1, 10);
+
 	/*****Set up the CryptoContext*****/
-	clock_t cc_clock;
-	cc_clock = clock();
+	timer.start("Parameter Generation");
 	//Parameter Selection based on standard parameters from HE standardization workshop
  	int plaintextModulus = 1032193; //536903681 //1032193
 	double sigma = 3.2;
 	SecurityLevel securityLevel = HEStd_128_classic;
 	uint32_t depth = 2;
+	int N = 4096; //2760 8192 16384 32768
 
 
 	//Create the cryptoContext with the desired parameters
@@ -67,11 +95,10 @@ int main()
 	cryptoContext->Enable(ENCRYPTION);
 	cryptoContext->Enable(SHE);
 	//std::cout << "securityLevel:" << securityLevel << std::endl;
-	cc_clock = clock() - cc_clock;
+	timer.stop("Parameter Generation");
 
 	/*****Generate Keys*****/ 
-	clock_t key_clock;
-	key_clock = clock();
+	timer.start("Key Generation");
 
 	//Create the container for the public key   
 	LPKeyPair<DCRTPoly> keyPair;
@@ -82,17 +109,27 @@ int main()
 	//Generate the relinearization key
 	cryptoContext->EvalMultKeyGen(keyPair.secretKey);
 
-	//Generate the Sun Key
-	cryptoContext->EvalSumKeyGen(keyPair.secretKey);
+	timer.stop("Key Generation");
 
-	key_clock = clock() - key_clock;
+	//Rotation keys derived from the circuit: only the log2(N) steps a sum over N slots performs
+	hebench::SlotReducer reducer(cryptoContext, 1);
+	hebench::RotationPlan rotations = reducer.rotations(N);
+	timer.start("Key Generation (circuit rotation keys)");
+	cryptoContext->EvalAtIndexKeyGen(keyPair.secretKey, rotations.indices());
+	timer.stop("Key Generation (circuit rotation keys)");
+	cout << "Rotation keys for the circuit: " << rotations.key_count() << endl;
+
+	//Generate the Sun Key: EvalSumKeyGen covers every power of two up to the ring dimension
+	if (compare_evalsum)
+	{
+		timer.start("Key Generation (EvalSum keys)");
+		cryptoContext->EvalSumKeyGen(keyPair.secretKey);
+		timer.stop("Key Generation (EvalSum keys)");
+	}
 
 	/*****Encryption*****/
-	clock_t enc_clock;
-	enc_clock = clock();
 
 	//Create and encode the plaintext vectors and variables
-    int N = 4096; //2760 8192 16384 32768
 	vector<int64_t> initial_velocity; //vector<int64_t> initial_velocity={1,2,3,4,5,6,7,8,9,1}; 
 	vector<int64_t> times; //vector<int64_t> times= {10,14,24,23,18,9,13,7,9,1}; 
 	vector<int64_t> acc;  //vector<int64_t> acc={1,2,3,2,1,2,1,2,9,1}; 
@@ -109,52 +146,77 @@ int main()
 		times.push_back(c);
 	}
 
-	//std::cout<< acc.size() << std::endl;
-	Plaintext plain_acc = cryptoContext->MakePackedPlaintext(acc);
-	Plaintext plain_initial_vel = cryptoContext->MakePackedPlaintext(initial_velocity);
-	Plaintext plain_times = cryptoContext->MakePackedPlaintext(times);
-	//Plaintext plain_N_mean = cryptoContext->MakePackedPlaintext(N_mean); //linear regression
+	Plaintext plain_acc, plain_initial_vel, plain_times;
+	Ciphertext<DCRTPoly> enc_acc, enc_initial_vel, enc_times;
 
-	//Encrypt the encodings
-	auto enc_acc = cryptoContext->Encrypt(keyPair.publicKey, plain_acc);
-	auto enc_initial_vel = cryptoContext->Encrypt(keyPair.publicKey, plain_initial_vel);
-	auto enc_times = cryptoContext->Encrypt(keyPair.publicKey, plain_times);
-	//auto enc_N_mean = cryptoContext->Encrypt(keyPair.publicKey, plain_N_mean); //linear regression
+	timer.measure("Encryption", [&]() {
+		//std::cout<< acc.size() << std::endl;
+		plain_acc = cryptoContext->MakePackedPlaintext(acc);
+		plain_initial_vel = cryptoContext->MakePackedPlaintext(initial_velocity);
+		plain_times = cryptoContext->MakePackedPlaintext(times);
+		//Plaintext plain_N_mean = cryptoContext->MakePackedPlaintext(N_mean); //linear regression
 
-	enc_clock = clock() - enc_clock;
+		//Encrypt the encodings
+		enc_acc = cryptoContext->Encrypt(keyPair.publicKey, plain_acc);
+		enc_initial_vel = cryptoContext->Encrypt(keyPair.publicKey, plain_initial_vel);
+		enc_times = cryptoContext->Encrypt(keyPair.publicKey, plain_times);
+		//auto enc_N_mean = cryptoContext->Encrypt(keyPair.publicKey, plain_N_mean); //linear regression
+	});
 
 	/*****Evaluation*****/
-  	clock_t eval_clock;
-	eval_clock = clock();
+	Ciphertext<DCRTPoly> enc_final_vel;
 
-	auto enc_acc_mult_times = cryptoContext->EvalMult(enc_acc, enc_times);                  
-	auto enc_final_vel = cryptoContext->EvalAdd(enc_initial_vel, enc_acc_mult_times);		
-
-	eval_clock = clock() - eval_clock;
+	timer.measure("Evaluation (v_i + at)", [&]() {
+		auto enc_acc_mult_times = cryptoContext->EvalMult(enc_acc, enc_times);                  
+		enc_final_vel = cryptoContext->EvalAdd(enc_initial_vel, enc_acc_mult_times);
+	});
 
 	/*****Decryption*****/
-	clock_t dec_clock;
-	dec_clock = clock();
-
 	Plaintext plain_final_velocity;
-	cryptoContext->Decrypt(keyPair.secretKey, enc_final_vel, &plain_final_velocity);
 
-	dec_clock = clock() - dec_clock;
+	timer.measure("Decryption", [&]() {
+		cryptoContext->Decrypt(keyPair.secretKey, enc_final_vel, &plain_final_velocity);
+	});
 
-	//Test advance operations
-	clock_t eval_sum_clock;
-	eval_sum_clock = clock();
-	//Evalsum
-	auto enc_final_vel_sum = cryptoContext->EvalSum(enc_final_vel, N);
-	eval_sum_clock = clock() - eval_sum_clock;
+	//Test advance operations: the sum as a tree of rotations by 1, 2, 4, ...
+	Ciphertext<DCRTPoly> enc_final_vel_sum;
+	timer.measure("Tree sum", [&]() {
+		enc_final_vel_sum = reducer.sum(enc_final_vel, N);
+	});
 	//decrypt
-	clock_t dec_sum_clock;
-	dec_sum_clock = clock();
-
 	Plaintext plain_final_velocity_sum;
-	cryptoContext->Decrypt(keyPair.secretKey, enc_final_vel_sum, &plain_final_velocity_sum);
+	timer.measure("Decryption (sum)", [&]() {
+		cryptoContext->Decrypt(keyPair.secretKey, enc_final_vel_sum, &plain_final_velocity_sum);
+	});
+
+	//Same sum through EvalSum and its own keys
+	Ciphertext<DCRTPoly> enc_final_vel_evalsum;
+	if (compare_evalsum)
+	{
+		timer.measure("EvalSum", [&]() {
+			enc_final_vel_evalsum = cryptoContext->EvalSum(enc_final_vel, N);
+		});
+	}
 
-	dec_sum_clock = clock() - dec_sum_clock;
+	//Summing several ciphertexts: add first, rotate once
+	vector<Ciphertext<DCRTPoly>> enc_inputs{ enc_acc, enc_initial_vel, enc_times };
+	Ciphertext<DCRTPoly> enc_inputs_sum;
+	timer.measure("Tree sum of 3 ciphertexts", [&]() {
+		enc_inputs_sum = reducer.sum(enc_inputs, N);
+	});
+
+	//Per-segment sums, e.g. one total per group of 16 records
+	size_t segment = 16;
+	Ciphertext<DCRTPoly> enc_segment_sums;
+	timer.measure("Segment sums (16 slots)", [&]() {
+		enc_segment_sums = reducer.segment_sums(enc_final_vel, segment, N);
+	});
+
+	Plaintext plain_evalsum, plain_inputs_sum, plain_segment_sums;
+	if (compare_evalsum)
+		cryptoContext->Decrypt(keyPair.secretKey, enc_final_vel_evalsum, &plain_evalsum);
+	cryptoContext->Decrypt(keyPair.secretKey, enc_inputs_sum, &plain_inputs_sum);
+	cryptoContext->Decrypt(keyPair.secretKey, enc_segment_sums, &plain_segment_sums);
 
 	/*****Print*****/
 	cout << "Starting the velocity caluculator with " << N << " instances. "<< endl << endl;
@@ -174,5 +236,87 @@ int main()
 	cout << " Final Velocity Sum: " << endl;
 	print(plain_final_velocity_sum, N);
 
+	if (compare_evalsum)
+		cout << "Tree sum matches EvalSum: " << boolalpha
+			 << (plain_final_velocity_sum->GetPackedValue()[0] == plain_evalsum->GetPackedValue()[0]) << " ("
+			 << reducer.full_rotations(N) << " rotations)" << endl;
+	cout << "Sum of acc, initial velocity and time: " << plain_inputs_sum->GetPackedValue()[0] << endl;
+	cout << "First segment sums of " << segment << " final velocities: " << plain_segment_sums->GetPackedValue()[0]
+		 << ", " << plain_segment_sums->GetPackedValue()[segment] << ", ..." << endl;
+
+	/*****Hoisted baby steps*****/
+	//BFVrns has no EvalFastRotation in PALISADE 1.10, so the baby steps are timed on a BGVrns
+	//context with the same plaintext modulus: the plain tree (B = 1), B - 1 rotations hoisted off
+	//one decomposition plus the remaining tree, and EvalSum. Hoisting only pays if the second is
+	//faster than the first; each hoisted rotation still does its own key switch
+	if (baby_steps > 1)
+	{
+		CryptoContext<DCRTPoly> bgv =
+			CryptoContextFactory<DCRTPoly>::genCryptoContextBGVrns(depth, plaintextModulus, securityLevel, sigma, depth, OPTIMIZED, BV);
+		bgv->Enable(ENCRYPTION);
+		bgv->Enable(SHE);
+		LPKeyPair<DCRTPoly> bgvKeys = bgv->KeyGen();
+
+		hebench::SlotReducer tree(bgv, 1);
+		hebench::SlotReducer hoisted(bgv, baby_steps);
+		hebench::RotationPlan bgvRotations = tree.rotations(N);
+		bgvRotations.merge(hoisted.rotations(N));
+		bgv->EvalAtIndexKeyGen(bgvKeys.secretKey, bgvRotations.indices());
+		bgv->EvalSumKeyGen(bgvKeys.secretKey);
+
+		Ciphertext<DCRTPoly> enc_bgv = bgv->Encrypt(bgvKeys.publicKey, bgv->MakePackedPlaintext(initial_velocity));
+		Ciphertext<DCRTPoly> enc_tree, enc_hoisted, enc_evalsum;
+		timer.measure("BGVrns tree sum (B = 1)", [&]() {
+			enc_tree = tree.sum(enc_bgv, N);
+		});
+		timer.measure("BGVrns hoisted sum (B = " + to_string(baby_steps) + ")", [&]() {
+			enc_hoisted = hoisted.sum(enc_bgv, N);
+		});
+		timer.measure("BGVrns EvalSum", [&]() {
+			enc_evalsum = bgv->EvalSum(enc_bgv, N);
+		});
+
+		Plaintext plain_tree, plain_hoisted, plain_bgv_evalsum;
+		bgv->Decrypt(bgvKeys.secretKey, enc_tree, &plain_tree);
+		bgv->Decrypt(bgvKeys.secretKey, enc_hoisted, &plain_hoisted);
+		bgv->Decrypt(bgvKeys.secretKey, enc_evalsum, &plain_bgv_evalsum);
+		bool match = plain_tree->GetPackedValue()[0] == plain_hoisted->GetPackedValue()[0] &&
+					 plain_tree->GetPackedValue()[0] == plain_bgv_evalsum->GetPackedValue()[0];
+
+		hebench::PhaseStats tree_stats = timer.stats("BGVrns tree sum (B = 1)");
+		hebench::PhaseStats hoisted_stats = timer.stats("BGVrns hoisted sum (B = " + to_string(baby_steps) + ")");
+		cout << "Baby steps B = " << baby_steps << (hoisted.hoisting() ? "" : " (no EvalFastRotation, not hoisted)")
+			 << ": " << hoisted.hoisted_rotations(N) << " hoisted + " << hoisted.full_rotations(N)
+			 << " full rotations against " << tree.full_rotations(N) << "; p50 " << hoisted_stats.wall_p50_s
+			 << " s against " << tree_stats.wall_p50_s << " s for B = 1, "
+			 << (hoisted_stats.wall_p50_s < tree_stats.wall_p50_s ? "hoisting wins" : "hoisting does not pay")
+			 << "; sums match: " << boolalpha << match << endl;
+	}
+
+	/*****Object Sizes*****/
+	//Binary serialized sizes; the EvalSum keys are the rotation keys EvalSumKeyGen generated (--evalsum)
+	cout << "Serialized sizes:" << endl;
+	hebench::PrintObjectSize(cout, { "Public key", hebench::SerializedBytes([&](std::ostream &out) {
+		Serial::Serialize(keyPair.publicKey, out, SerType::BINARY);
+	}) });
+	hebench::PrintObjectSize(cout, { "Relin keys", hebench::SerializedBytes([&](std::ostream &out) {
+		cryptoContext->SerializeEvalMultKey(out, SerType::BINARY, cryptoContext);
+	}) });
+	if (compare_evalsum)
+		hebench::PrintObjectSize(cout, { "EvalSum keys", hebench::SerializedBytes([&](std::ostream &out) {
+			cryptoContext->SerializeEvalSumKey(out, SerType::BINARY, cryptoContext);
+		}) });
+	hebench::PrintObjectSize(cout, { "Rotation keys (circuit)", hebench::SerializedBytes([&](std::ostream &out) {
+		cryptoContext->SerializeEvalAutomorphismKey(out, SerType::BINARY, cryptoContext);
+	}) });
+	hebench::PrintObjectSize(cout, { "Ciphertext (input)", hebench::SerializedBytes([&](std::ostream &out) {
+		Serial::Serialize(enc_acc, out, SerType::BINARY);
+	}) });
+	hebench::PrintObjectSize(cout, { "Ciphertext (sum)", hebench::SerializedBytes([&](std::ostream &out) {
+		Serial::Serialize(enc_final_vel_sum, out, SerType::BINARY);
+	}) });
+
+	timer.print(cout);
+
 	return 0;
 }
\ No newline at end of file
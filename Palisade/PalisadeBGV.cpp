@@ -15,6 +15,7 @@
 #include <fstream>
 #include <random>
 #include <iterator>
+#include "HETimer.h"
 
 
 using namespace std;
@@ -46,9 +47,11 @@ void print(Plaintext v, int length)
 
 int main()
 {
+	//1 untimed warm-up run, then 10 timed repetitions of encryption, evaluation and decryption
+	hebench::HETimer timer(1, 10);
+
 	/*****Parameter Generation*****/
-	clock_t cc_clock;
-	cc_clock = clock();
+	timer.start("Parameter Generation");
 	//test
   	// Set the main parameters
  	int plaintextModulus = 65537; //1032193 generate 8192 slots
@@ -66,11 +69,10 @@ int main()
 	cc->Enable(LEVELEDSHE);
 
 
-	cc_clock = clock() - cc_clock;
+	timer.stop("Parameter Generation");
 
 	/*****KeyGen*****/
-	clock_t key_clock;
-	key_clock = clock();
+	timer.start("Key Generation");
 
 	// Initialize Public Key Containers
   	LPKeyPair<DCRTPoly> keyPair;
@@ -82,7 +84,7 @@ int main()
  	cc->EvalMultKeyGen(keyPair.secretKey);
 
 
-	key_clock = clock() - key_clock;
+	timer.stop("Key Generation");
 
 	/*****Encode and Encrypt*****/
 
@@ -104,38 +106,33 @@ int main()
 		times.push_back(c);
 	}
 
-    //start the clock
-	clock_t enc_clock;
-	enc_clock = clock();
-
-	Plaintext plain_acc = cc->MakePackedPlaintext(acc);
-	Plaintext plain_initial_vel = cc->MakePackedPlaintext(initial_velocity);
-	Plaintext plain_times = cc->MakePackedPlaintext(times);
+	Plaintext plain_acc, plain_initial_vel, plain_times;
+	Ciphertext<DCRTPoly> enc_initial_vel, enc_times, enc_acc;
 
-	auto enc_initial_vel = cc->Encrypt(keyPair.publicKey, plain_initial_vel);
-	auto enc_times = cc->Encrypt(keyPair.publicKey, plain_times);
-	auto enc_acc = cc->Encrypt(keyPair.publicKey, plain_acc);
+	timer.measure("Encryption", [&]() {
+		plain_acc = cc->MakePackedPlaintext(acc);
+		plain_initial_vel = cc->MakePackedPlaintext(initial_velocity);
+		plain_times = cc->MakePackedPlaintext(times);
 
-	enc_clock = clock() - enc_clock;
+		enc_initial_vel = cc->Encrypt(keyPair.publicKey, plain_initial_vel);
+		enc_times = cc->Encrypt(keyPair.publicKey, plain_times);
+		enc_acc = cc->Encrypt(keyPair.publicKey, plain_acc);
+	});
 
 	/*****Evaluate*****/
-	clock_t eval_clock;
-	eval_clock = clock();
+	Ciphertext<DCRTPoly> enc_final_vel;
 
-	auto enc_final_vel = cc->EvalMult(enc_times, enc_acc);
-	enc_final_vel = cc->EvalAdd(enc_final_vel, enc_initial_vel);
-	
-	eval_clock = clock() - eval_clock;
+	timer.measure("Evaluation (v_i + at)", [&]() {
+		enc_final_vel = cc->EvalMult(enc_times, enc_acc);
+		enc_final_vel = cc->EvalAdd(enc_final_vel, enc_initial_vel);
+	});
 	
 	/*****Decrypt*****/
-	clock_t dec_clock;
-	dec_clock = clock();
-
 	Plaintext plain_final_vel;
 
-	cc->Decrypt(keyPair.secretKey, enc_final_vel, &plain_final_vel);
-	
-	dec_clock = clock() - dec_clock;
+	timer.measure("Decryption", [&]() {
+		cc->Decrypt(keyPair.secretKey, enc_final_vel, &plain_final_vel);
+	});
 
 	/*****Print*****/
 	cout << "Starting the velocity caluculator with " << N << " instances. "<< endl << endl;
@@ -152,12 +149,7 @@ int main()
 	cout << " Final Velocity: " << endl;
 	print(plain_final_vel, N);
 
-	cout << "Times:" <<endl;
-	cout << "Parameter Generation  : " << ((float)cc_clock)/CLOCKS_PER_SEC << endl;
-	cout << "Key Generation        : " << ((float)key_clock)/CLOCKS_PER_SEC << endl;
-	cout << "Encryption            : " << ((float)enc_clock)/CLOCKS_PER_SEC << endl;
-	cout << "Evaluation (v_i + at) : " << ((float)eval_clock)/CLOCKS_PER_SEC << endl;
-	cout << "Decryption            : " << ((float)dec_clock)/CLOCKS_PER_SEC << endl;
+	timer.print(cout);
 
 }
 
@@ -0,0 +1,431 @@
+/****************************************************/
+/* PALISADE backend for the velocity benchmark      */
+/* Same workload as PalisadeBFV.cpp, PalisadeBGV.cpp*/
+/* and PalisadeCKKS.cpp                             */
+/* final velocity = V_i + at   m/s                  */
+/****************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <complex>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "palisade.h"
+#include "ciphertext-ser.h"
+#include "cryptocontext-ser.h"
+#include "pubkeylp-ser.h"
+#include "scheme/bfvrns/bfvrns-ser.h"
+#include "scheme/bgvrns/bgvrns-ser.h"
+#include "scheme/ckks/ckks-ser.h"
+#include "BenchConfig.h"
+#include "Compression.h"
+#include "HEMemory.h"
+#include "KeyCache.h"
+#include "PalisadeMultiplyAdd.h"
+#include "VelocityData.h"
+
+// PALISADE's headers carry no version; Benchmark/CMakeLists.txt passes the
+// one find_package(Palisade) found, so the key cache tells releases apart.
+#ifndef HEBENCH_PALISADE_VERSION
+#define HEBENCH_PALISADE_VERSION "unknown"
+#endif
+
+namespace hebench
+{
+
+class PalisadeBackend
+{
+public:
+    using Ciphertext = lbcrypto::Ciphertext<lbcrypto::DCRTPoly>;
+
+    struct Encoded
+    {
+        lbcrypto::Plaintext initial_velocity;
+        lbcrypto::Plaintext acc;
+        lbcrypto::Plaintext times;
+    };
+
+    // A public operand stays a plaintext, already in the form the evaluator
+    // consumes; its ciphertext member is left null.
+    struct Encrypted
+    {
+        Ciphertext initial_velocity;
+        Ciphertext acc;
+        Ciphertext times;
+        lbcrypto::Plaintext public_initial_velocity;
+        lbcrypto::Plaintext public_acc;
+        lbcrypto::Plaintext public_times;
+    };
+
+    using Result = Ciphertext;
+
+    static const char *Name()
+    {
+        return "palisade";
+    }
+
+    static bool Supports(const std::string &scheme)
+    {
+        return scheme == "bfv" || scheme == "bgv" || scheme == "ckks";
+    }
+
+    /*****Set up the CryptoContext*****/
+    // Parameter generation searches for NTT-friendly CRT primes; a cached
+    // context skips the search.
+    explicit PalisadeBackend(const BenchConfig &config)
+        : config_(config), ckks_(config.scheme == "ckks"), public_(config.public_operands),
+          cache_(config.key_cache, std::string(Name()) + " " + HEBENCH_PALISADE_VERSION + " " + ParameterKey(config))
+    {
+        if (!Supports(config.scheme))
+        {
+            throw std::invalid_argument("PALISADE does not support the " + config.scheme + " scheme");
+        }
+        if (!cache_.load("context", [&](std::istream &in) {
+                lbcrypto::Serial::Deserialize(cc_, in, lbcrypto::SerType::BINARY);
+            }))
+        {
+            generate_context();
+            cache_.store("context", [&](std::ostream &out) {
+                lbcrypto::Serial::Serialize(cc_, out, lbcrypto::SerType::BINARY);
+            });
+        }
+
+        cc_->Enable(lbcrypto::ENCRYPTION);
+        cc_->Enable(lbcrypto::SHE);
+        // LevelReduce (transport sizes) and rescaling need it for CKKS too.
+        if (config.scheme == "bgv" || config.scheme == "ckks")
+        {
+            cc_->Enable(lbcrypto::LEVELEDSHE);
+        }
+    }
+
+    /*****Generate Keys*****/
+    // A public factor makes the product plaintext x ciphertext, which needs
+    // no EvalMult (relinearization) key; a later encrypted run on the same
+    // entry derives it from the cached secret key rather than replacing the
+    // key pair others (the service, its clients) hold.
+    void keygen()
+    {
+        std::uint64_t generation = cache_.generation("secret_key");
+        bool key_pair_cached =
+            generation != 0 &&
+            cache_.load("public_key", [&](std::istream &in) {
+                lbcrypto::Serial::Deserialize(keys_.publicKey, in, lbcrypto::SerType::BINARY);
+            }, generation) &&
+            cache_.load("secret_key", [&](std::istream &in) {
+                lbcrypto::Serial::Deserialize(keys_.secretKey, in, lbcrypto::SerType::BINARY);
+            }, generation);
+        if (!key_pair_cached)
+        {
+            generation = KeyCache::NewGeneration();
+            cache_.set_generation(generation);
+            keys_ = cc_->KeyGen();
+            cache_.store("public_key", [&](std::ostream &out) {
+                lbcrypto::Serial::Serialize(keys_.publicKey, out, lbcrypto::SerType::BINARY);
+            });
+            cache_.store("secret_key", [&](std::ostream &out) {
+                lbcrypto::Serial::Serialize(keys_.secretKey, out, lbcrypto::SerType::BINARY);
+            });
+        }
+
+        cache_.set_generation(generation);
+
+        bool relin_cached = true;
+        if (needs_relin_keys() &&
+            !cache_.load("eval_mult_key",
+                         [&](std::istream &in) { cc_->DeserializeEvalMultKey(in, lbcrypto::SerType::BINARY); },
+                         generation))
+        {
+            relin_cached = false;
+            cc_->EvalMultKeyGen(keys_.secretKey);
+            cache_.store("eval_mult_key",
+                         [&](std::ostream &out) { cc_->SerializeEvalMultKey(out, lbcrypto::SerType::BINARY, cc_); });
+        }
+        keys_cached_ = key_pair_cached && relin_cached;
+    }
+
+    // "off", "hit" (keys loaded from the cache) or "miss" (generated and stored).
+    const char *key_cache_status() const
+    {
+        return !cache_.enabled() ? "off" : keys_cached_ ? "hit" : "miss";
+    }
+
+    std::string scheme() const
+    {
+        return config_.scheme;
+    }
+
+    std::size_t ring_dimension() const
+    {
+        return cc_->GetRingDimension();
+    }
+
+    std::size_t slot_count() const
+    {
+        return ckks_ ? cc_->GetRingDimension() / 2 : cc_->GetRingDimension();
+    }
+
+    /*****Encode*****/
+    Encoded encode(const VelocityData &data) const
+    {
+        if (data.size() > slot_count())
+        {
+            throw std::invalid_argument("more records than slots in one PALISADE ciphertext");
+        }
+        // A public CKKS V_i is added to the unrescaled product, so it is
+        // encoded at the product's depth (scale squared).
+        std::size_t initial_velocity_depth = ckks_ && public_.initial_velocity ? 2 : 1;
+        return Encoded{ encode_vector(data.initial_velocity, initial_velocity_depth), encode_vector(data.acc),
+                        encode_vector(data.times) };
+    }
+
+    /*****Encrypt*****/
+    // Public factors are moved to evaluation (NTT) form here, once per
+    // chunk; EvalMult would otherwise transform them on every product.
+    Encrypted encrypt(const Encoded &encoded) const
+    {
+        Encrypted encrypted;
+        if (public_.initial_velocity)
+            encrypted.public_initial_velocity = encoded.initial_velocity;
+        else
+            encrypted.initial_velocity = cc_->Encrypt(keys_.publicKey, encoded.initial_velocity);
+        if (public_.acc)
+            encrypted.public_acc = evaluation_form(encoded.acc);
+        else
+            encrypted.acc = cc_->Encrypt(keys_.publicKey, encoded.acc);
+        if (public_.times)
+            encrypted.public_times = evaluation_form(encoded.times);
+        else
+            encrypted.times = cc_->Encrypt(keys_.publicKey, encoded.times);
+        return encrypted;
+    }
+
+    /*****Evaluation*****/
+    // An encrypted V_i is added into the product's own buffer
+    // (MultiplyAccumulator::multiply_then_add) instead of a third ciphertext.
+    Result evaluate(const Encrypted &encrypted) const
+    {
+        MultiplyAccumulator fused(cc_);
+        if (public_.initial_velocity)
+        {
+            Ciphertext enc_acc_mult_times;
+            if (public_.acc)
+                enc_acc_mult_times = cc_->EvalMult(encrypted.times, encrypted.public_acc);
+            else if (public_.times)
+                enc_acc_mult_times = cc_->EvalMult(encrypted.acc, encrypted.public_times);
+            else
+                enc_acc_mult_times = cc_->EvalMult(encrypted.acc, encrypted.times);
+            return cc_->EvalAdd(enc_acc_mult_times, encrypted.public_initial_velocity);
+        }
+        if (public_.acc)
+            return fused.multiply_then_add(encrypted.initial_velocity, encrypted.times, encrypted.public_acc);
+        if (public_.times)
+            return fused.multiply_then_add(encrypted.initial_velocity, encrypted.acc, encrypted.public_times);
+        return fused.multiply_then_add(encrypted.initial_velocity, encrypted.acc, encrypted.times);
+    }
+
+    /*****Wire Format*****/
+    // One chunk as the evaluation service (VelocityService.h) exchanges it:
+    // the three input ciphertexts up, the result down.
+    void save_encrypted(const Encrypted &encrypted, std::ostream &out) const
+    {
+        lbcrypto::Serial::Serialize(encrypted.initial_velocity, out, lbcrypto::SerType::BINARY);
+        lbcrypto::Serial::Serialize(encrypted.acc, out, lbcrypto::SerType::BINARY);
+        lbcrypto::Serial::Serialize(encrypted.times, out, lbcrypto::SerType::BINARY);
+    }
+
+    Encrypted load_encrypted(std::istream &in) const
+    {
+        Encrypted encrypted;
+        lbcrypto::Serial::Deserialize(encrypted.initial_velocity, in, lbcrypto::SerType::BINARY);
+        lbcrypto::Serial::Deserialize(encrypted.acc, in, lbcrypto::SerType::BINARY);
+        lbcrypto::Serial::Deserialize(encrypted.times, in, lbcrypto::SerType::BINARY);
+        if (!encrypted.initial_velocity || !encrypted.acc || !encrypted.times)
+        {
+            throw std::runtime_error("malformed PALISADE ciphertext");
+        }
+        return encrypted;
+    }
+
+    void save_result(const Result &result, std::ostream &out) const
+    {
+        lbcrypto::Serial::Serialize(result, out, lbcrypto::SerType::BINARY);
+    }
+
+    Result load_result(std::istream &in) const
+    {
+        Result result;
+        lbcrypto::Serial::Deserialize(result, in, lbcrypto::SerType::BINARY);
+        if (!result)
+        {
+            throw std::runtime_error("malformed PALISADE ciphertext");
+        }
+        return result;
+    }
+
+    /*****Noise Budget*****/
+    // PALISADE does not expose the remaining noise budget; -1 = unknown.
+    int noise_budget_bits(const Result &) const
+    {
+        return -1;
+    }
+
+    /*****Decryption*****/
+    std::vector<double> decrypt(const Result &result, std::size_t n) const
+    {
+        lbcrypto::Plaintext plain_final_vel;
+        cc_->Decrypt(keys_.secretKey, result, &plain_final_vel);
+        plain_final_vel->SetLength(n);
+
+        std::vector<double> final_vel(n);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            final_vel[i] = ckks_ ? plain_final_vel->GetCKKSPackedValue()[i].real()
+                                 : static_cast<double>(plain_final_vel->GetPackedValue()[i]);
+        }
+        return final_vel;
+    }
+
+    /*****Object Sizes*****/
+    // Binary serialized sizes; relin_keys is this context's EvalMult key.
+    std::vector<ObjectSize> object_sizes(const Encrypted &encrypted, const Result &result) const
+    {
+        const Ciphertext &input = public_.acc ? encrypted.times : encrypted.acc;
+        std::vector<ObjectSize> sizes{ { "public_key", SerializedBytes([&](std::ostream &out) {
+                                              lbcrypto::Serial::Serialize(keys_.publicKey, out, lbcrypto::SerType::BINARY);
+                                          }) } };
+        if (needs_relin_keys())
+        {
+            sizes.push_back({ "relin_keys", SerializedBytes([&](std::ostream &out) {
+                                  cc_->SerializeEvalMultKey(out, lbcrypto::SerType::BINARY, cc_);
+                              }) });
+        }
+        sizes.push_back({ "input_ciphertext", SerializedBytes([&](std::ostream &out) {
+                              lbcrypto::Serial::Serialize(input, out, lbcrypto::SerType::BINARY);
+                          }) });
+        sizes.push_back({ "result_ciphertext", SerializedBytes([&](std::ostream &out) {
+                              lbcrypto::Serial::Serialize(result, out, lbcrypto::SerType::BINARY);
+                          }) });
+        return sizes;
+    }
+
+    /*****Transport Sizes*****/
+    // Bytes on the wire for one chunk. PALISADE serializes both polynomials
+    // of every ciphertext (no seeded form), so uploads are only compressed;
+    // BGV and CKKS results drop to a single CRT tower before download.
+    // BFVrns has no modulus switching, its result goes out at full size.
+    // Public operands are not uploaded.
+    std::vector<ObjectSize> transport_sizes(const Encoded &encoded, const Result &result,
+                                            const std::string &compression) const
+    {
+        std::uint64_t upload = 0;
+        for (const lbcrypto::Plaintext &plain : secret_operands(encoded))
+        {
+            Ciphertext encrypted = cc_->Encrypt(keys_.publicKey, plain);
+            upload += CompressedSerializedBytes(compression, [&](std::ostream &out) {
+                lbcrypto::Serial::Serialize(encrypted, out, lbcrypto::SerType::BINARY);
+            });
+        }
+
+        Ciphertext lowest = result;
+        std::size_t towers = lowest->GetElements()[0].GetNumOfElements();
+        if (ckks_ && towers > 1)
+        {
+            lowest = cc_->LevelReduce(lowest, nullptr, towers - 1);
+        }
+        else if (config_.scheme == "bgv")
+        {
+            for (; towers > 1; towers--)
+            {
+                lowest = cc_->ModReduce(lowest);
+            }
+        }
+        std::uint64_t download = CompressedSerializedBytes(compression, [&](std::ostream &out) {
+            lbcrypto::Serial::Serialize(lowest, out, lbcrypto::SerType::BINARY);
+        });
+        return { { "upload_ciphertexts", upload }, { "download_ciphertext", download } };
+    }
+
+private:
+    bool needs_relin_keys() const
+    {
+        return !public_.acc && !public_.times;
+    }
+
+    std::vector<lbcrypto::Plaintext> secret_operands(const Encoded &encoded) const
+    {
+        std::vector<lbcrypto::Plaintext> secret;
+        if (!public_.initial_velocity)
+            secret.push_back(encoded.initial_velocity);
+        if (!public_.acc)
+            secret.push_back(encoded.acc);
+        if (!public_.times)
+            secret.push_back(encoded.times);
+        return secret;
+    }
+
+    // Plaintexts are shared, so this transforms the encoded chunk's element;
+    // EvalMult leaves an evaluation-form plaintext as it is.
+    static lbcrypto::Plaintext evaluation_form(const lbcrypto::Plaintext &plain)
+    {
+        plain->SetFormat(lbcrypto::Format::EVALUATION);
+        return plain;
+    }
+
+    void generate_context()
+    {
+        double sigma = 3.2;
+        lbcrypto::SecurityLevel securityLevel = config_.security == 256   ? lbcrypto::HEStd_256_classic
+                                                : config_.security == 192 ? lbcrypto::HEStd_192_classic
+                                                                          : lbcrypto::HEStd_128_classic;
+        uint32_t ring_dim = static_cast<uint32_t>(config_.ring_dim);
+
+        if (config_.scheme == "bfv")
+        {
+            // PALISADE sizes the chain itself; a planned chain (--params
+            // auto) only sets the CRT prime size.
+            uint32_t dcrt_bits = config_.coeff_bits.empty()
+                                     ? 60
+                                     : static_cast<uint32_t>(*std::max_element(config_.coeff_bits.begin(),
+                                                                               config_.coeff_bits.end()));
+            cc_ = lbcrypto::CryptoContextFactory<lbcrypto::DCRTPoly>::genCryptoContextBFVrns(
+                config_.plain_modulus, securityLevel, sigma, 0, config_.depth, 0, lbcrypto::OPTIMIZED, 2, 0, dcrt_bits,
+                ring_dim);
+        }
+        else if (config_.scheme == "bgv")
+        {
+            cc_ = lbcrypto::CryptoContextFactory<lbcrypto::DCRTPoly>::genCryptoContextBGVrns(
+                config_.depth, config_.plain_modulus, securityLevel, sigma, config_.depth, lbcrypto::OPTIMIZED,
+                lbcrypto::BV, ring_dim);
+        }
+        else
+        {
+            cc_ = lbcrypto::CryptoContextFactory<lbcrypto::DCRTPoly>::genCryptoContextCKKS(
+                config_.depth, config_.scale_bits, ring_dim / 2, securityLevel, ring_dim);
+        }
+    }
+
+    lbcrypto::Plaintext encode_vector(const std::vector<std::int64_t> &values, std::size_t depth = 1) const
+    {
+        if (ckks_)
+        {
+            std::vector<std::complex<double>> slots(values.begin(), values.end());
+            return cc_->MakeCKKSPackedPlaintext(slots, depth);
+        }
+        return cc_->MakePackedPlaintext(values);
+    }
+
+    BenchConfig config_;
+    bool ckks_;
+    PublicOperands public_;
+    KeyCache cache_;
+    bool keys_cached_ = false;
+
+    lbcrypto::CryptoContext<lbcrypto::DCRTPoly> cc_;
+    lbcrypto::LPKeyPair<lbcrypto::DCRTPoly> keys_;
+};
+
+} // namespace hebench
@@ -12,6 +12,7 @@
 #include <vector>
 #include <time.h>
 #include <stdlib.h>
+#include "HETimer.h"
 using namespace std;
 using namespace lbcrypto;
 
@@ -41,9 +42,11 @@ void print(Plaintext v, int length)
 
 int main()
 {
+	//1 untimed warm-up run, then 10 timed repetitions of encryption, evaluation and decryption
+	hebench::HETimer timer(1, 10);
+
 	/*****Setup CryptoContext*****/
-	clock_t cc_clock;
-	cc_clock = clock();
+	timer.start("Parameter Generation");
 
 	uint32_t multDepth = 1;
 	uint32_t scaleFactorBits = 50;
@@ -62,23 +65,19 @@ int main()
 	cc->Enable(ENCRYPTION);
 	cc->Enable(SHE);
 
-	cc_clock = clock() - cc_clock;
+	timer.stop("Parameter Generation");
 
 	/*****Key Generation*****/
-	clock_t key_clock;
-	key_clock = clock();
+	timer.start("Key Generation");
 
 	auto keys = cc->KeyGen();
 	cc->EvalMultKeyGen(keys.secretKey);
-	cc->EvalAtIndexKeyGen(keys.secretKey, { 1, -2 });
+	//No rotation keys: v_i + at performs no rotations
 
-	key_clock = clock() - key_clock;
+	timer.stop("Key Generation");
 
 	/*****Encoding*****/
 
-	clock_t enc_clock;
-	enc_clock = clock();
-
 	int N = 4096; 
 	vector<complex<double>> initial_velocity; 
 	vector<complex<double>> times; 
@@ -97,36 +96,35 @@ int main()
 	}
 	
 
-	Plaintext plain_initial_vel = cc->MakeCKKSPackedPlaintext(initial_velocity);
-	Plaintext plain_times = cc->MakeCKKSPackedPlaintext(times);
-	Plaintext plain_acc = cc->MakeCKKSPackedPlaintext(acc);
+	Plaintext plain_initial_vel, plain_times, plain_acc;
+	Ciphertext<DCRTPoly> enc_times, enc_acc, enc_initial_vel;
 
-	// Encrypt the encoded vectors
-	auto enc_times = cc->Encrypt(keys.publicKey, plain_times);
-	auto enc_acc = cc->Encrypt(keys.publicKey, plain_acc);
-	auto enc_initial_vel = cc->Encrypt(keys.publicKey, plain_initial_vel);
+	timer.measure("Encryption", [&]() {
+		plain_initial_vel = cc->MakeCKKSPackedPlaintext(initial_velocity);
+		plain_times = cc->MakeCKKSPackedPlaintext(times);
+		plain_acc = cc->MakeCKKSPackedPlaintext(acc);
 
-	enc_clock = clock() - enc_clock;
+		// Encrypt the encoded vectors
+		enc_times = cc->Encrypt(keys.publicKey, plain_times);
+		enc_acc = cc->Encrypt(keys.publicKey, plain_acc);
+		enc_initial_vel = cc->Encrypt(keys.publicKey, plain_initial_vel);
+	});
 
 	/*****Evaluation*****/
-	clock_t eval_clock;
-	eval_clock = clock();
-
-	auto cMult = cc->EvalMult(enc_times, enc_acc);
-	auto cAdd = cc->EvalAdd(cMult, enc_initial_vel);
+	Ciphertext<DCRTPoly> cAdd;
 
-	eval_clock = clock() - eval_clock;
+	timer.measure("Evaluation (v_i + at)", [&]() {
+		auto cMult = cc->EvalMult(enc_times, enc_acc);
+		cAdd = cc->EvalAdd(cMult, enc_initial_vel);
+	});
 
 	/*****Decryption and output*****/
-	clock_t dec_clock;
-	dec_clock = clock();
-	
 	Plaintext plain_final_vel;
 	cout.precision(6);
 
-	cc->Decrypt(keys.secretKey, cAdd, &plain_final_vel);
-
-	dec_clock = clock() - dec_clock;
+	timer.measure("Decryption", [&]() {
+		cc->Decrypt(keys.secretKey, cAdd, &plain_final_vel);
+	});
 
 	/*****Print*****/
 	cout << "Starting the velocity caluculator with " << N << " instances. "<< endl << endl;
@@ -143,12 +141,7 @@ int main()
 	cout << " Final Velocity: " << endl;
 	print(plain_final_vel, N);
 
-	cout << "Times:" <<endl;
-	cout << "Parameter Generation  : " << ((float)cc_clock)/CLOCKS_PER_SEC << endl;
-	cout << "Key Generation        : " << ((float)key_clock)/CLOCKS_PER_SEC << endl;
-	cout << "Encryption            : " << ((float)enc_clock)/CLOCKS_PER_SEC << endl;
-	cout << "Evaluation (v_i + at) : " << ((float)eval_clock)/CLOCKS_PER_SEC << endl;
-	cout << "Decryption            : " << ((float)dec_clock)/CLOCKS_PER_SEC << endl;
+	timer.print(cout);
 
 	return 0;
 }
@@ -0,0 +1,247 @@
+/****************************************************/
+/* Packed encrypted linear algebra for PALISADE     */
+/* Halevi-Shoup diagonal matrix-vector products and */
+/* column-packed matrix-matrix products on BFVrns   */
+/* and CKKS DCRTPoly contexts: d rotations and d    */
+/* slot-wise products per d x d product             */
+/****************************************************/
+
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "palisade.h"
+#include "RotationPlan.h"
+
+namespace hebench
+{
+
+// Slot layout. A vector of length d (a power of two) sits in a block of 2d
+// slots holding it twice, [v, v], so rotating the whole slot vector by
+// i < d rotates the first half of every block cyclically. `columns` blocks
+// sit side by side, so one product multiplies A by that many vectors at
+// once: columns = 1 is a matrix-vector product, columns = d a full
+// matrix-matrix product A * B. Results are read from the first half of
+// each block; the second halves hold garbage.
+//
+// A is stored by diagonals (Halevi-Shoup): y = sum_i diag_i * rot(v, i)
+// with diag_i[p] = A[p][(p + i) mod d], repeated for every block. With
+// bsgs, i = g*j + b and y = sum_j rot(sum_b diag'_i * rot(v, b), g*j)
+// where diag'_i is diag_i shifted right by g*j (free: done in the clear
+// before encoding). The g baby rotations all rotate v and share one
+// hoisted decomposition; keys drop from d-1 to about 2*sqrt(d).
+//
+// T is std::int64_t for BFV and double for CKKS.
+template <typename T>
+class PackedLinearAlgebra
+{
+public:
+    using Ciphertext = lbcrypto::Ciphertext<lbcrypto::DCRTPoly>;
+    using Matrix = std::vector<std::vector<T>>; // row-major
+
+    // row_slots: slots one rotation cycles through (ring dimension / 2 for
+    // BFVrns, the batch size for CKKS).
+    PackedLinearAlgebra(lbcrypto::CryptoContext<lbcrypto::DCRTPoly> cc, std::size_t d, std::size_t columns,
+                        std::size_t row_slots, bool bsgs)
+        : cc_(cc), d_(d), columns_(columns), row_slots_(row_slots), bsgs_(bsgs),
+          baby_(bsgs ? BabyStepCount(d) : d)
+    {
+        if (d == 0 || (d & (d - 1)) != 0)
+        {
+            throw std::invalid_argument("matrix dimension must be a power of two, got " + std::to_string(d));
+        }
+        if (columns == 0 || 2 * d * columns > row_slots)
+        {
+            throw std::invalid_argument(std::to_string(columns) + " packed columns of length " + std::to_string(d) +
+                                        " need " + std::to_string(2 * d * columns) + " slots, the ring row has " +
+                                        std::to_string(row_slots));
+        }
+    }
+
+    std::size_t dimension() const
+    {
+        return d_;
+    }
+
+    // Rotation keys multiply() needs.
+    RotationPlan rotations() const
+    {
+        return RotationPlan().all_steps(d_, bsgs_);
+    }
+
+    /*****Layout*****/
+    // Columns 0 .. columns-1 of b (d rows), each in its own block.
+    std::vector<T> pack_columns(const Matrix &b) const
+    {
+        std::vector<T> slots(row_slots_, T(0));
+        for (std::size_t c = 0; c < columns_ && c < b[0].size(); c++)
+        {
+            for (std::size_t p = 0; p < d_; p++)
+            {
+                slots[c * 2 * d_ + p] = b[p][c];
+                slots[c * 2 * d_ + d_ + p] = b[p][c];
+            }
+        }
+        return slots;
+    }
+
+    // d x columns matrix read back from decrypted slots.
+    Matrix unpack_columns(const std::vector<T> &slots) const
+    {
+        Matrix result(d_, std::vector<T>(columns_));
+        for (std::size_t c = 0; c < columns_; c++)
+        {
+            for (std::size_t p = 0; p < d_; p++)
+            {
+                result[p][c] = slots[c * 2 * d_ + p];
+            }
+        }
+        return result;
+    }
+
+    // One slot vector per diagonal of a, repeated for every block and
+    // pre-shifted for the giant steps.
+    std::vector<std::vector<T>> diagonals(const Matrix &a) const
+    {
+        std::vector<std::vector<T>> result(d_, std::vector<T>(row_slots_, T(0)));
+        for (std::size_t i = 0; i < d_; i++)
+        {
+            std::size_t shift = i - i % baby_;
+            for (std::size_t c = 0; c < columns_; c++)
+            {
+                for (std::size_t p = 0; p < d_; p++)
+                {
+                    result[i][(c * 2 * d_ + p + shift) % row_slots_] = a[p][(p + i) % d_];
+                }
+            }
+        }
+        return result;
+    }
+
+    // A known to the evaluator (e.g. a model), multiplied in as plaintexts.
+    std::vector<lbcrypto::Plaintext> encode_diagonals(const Matrix &a) const
+    {
+        std::vector<lbcrypto::Plaintext> encoded;
+        for (const std::vector<T> &diagonal : diagonals(a))
+        {
+            encoded.push_back(make_plaintext(diagonal));
+        }
+        return encoded;
+    }
+
+    std::vector<Ciphertext> encrypt_diagonals(const Matrix &a,
+                                              const lbcrypto::LPPublicKey<lbcrypto::DCRTPoly> &public_key) const
+    {
+        std::vector<Ciphertext> encrypted;
+        for (const lbcrypto::Plaintext &diagonal : encode_diagonals(a))
+        {
+            encrypted.push_back(cc_->Encrypt(public_key, diagonal));
+        }
+        return encrypted;
+    }
+
+    lbcrypto::Plaintext make_plaintext(const std::vector<T> &slots) const
+    {
+        return MakePlaintext(cc_, slots);
+    }
+
+    /*****Product*****/
+    // A * (every packed column); Diagonal is lbcrypto::Plaintext or
+    // Ciphertext. Encrypted products are summed unrelinearized and
+    // relinearized once per giant step, before its rotation.
+    template <typename Diagonal>
+    Ciphertext multiply(const std::vector<Diagonal> &diagonals, const Ciphertext &packed) const
+    {
+        if (diagonals.size() != d_)
+        {
+            throw std::invalid_argument("expected " + std::to_string(d_) + " diagonals");
+        }
+        std::vector<Ciphertext> baby = baby_rotations(packed);
+
+        Ciphertext result;
+        for (std::size_t giant = 0; giant < d_; giant += baby_)
+        {
+            std::vector<Ciphertext> terms;
+            for (std::size_t b = 0; b < baby_ && giant + b < d_; b++)
+            {
+                terms.push_back(product(baby[b], diagonals[giant + b]));
+            }
+            Ciphertext inner = terms.size() == 1 ? terms[0] : cc_->EvalAddMany(terms);
+            if (std::is_same<Diagonal, Ciphertext>::value)
+            {
+                inner = cc_->Relinearize(inner);
+            }
+            if (giant > 0)
+            {
+                inner = cc_->EvalAtIndex(inner, static_cast<std::int32_t>(giant));
+            }
+            result = result ? cc_->EvalAdd(result, inner) : inner;
+        }
+        return result;
+    }
+
+private:
+    static lbcrypto::Plaintext MakePlaintext(const lbcrypto::CryptoContext<lbcrypto::DCRTPoly> &cc,
+                                             const std::vector<std::int64_t> &slots)
+    {
+        return cc->MakePackedPlaintext(slots);
+    }
+
+    static lbcrypto::Plaintext MakePlaintext(const lbcrypto::CryptoContext<lbcrypto::DCRTPoly> &cc,
+                                             const std::vector<double> &slots)
+    {
+        return cc->MakeCKKSPackedPlaintext(std::vector<std::complex<double>>(slots.begin(), slots.end()));
+    }
+
+    Ciphertext product(const Ciphertext &rotated, const lbcrypto::Plaintext &diagonal) const
+    {
+        return cc_->EvalMult(rotated, diagonal);
+    }
+
+    Ciphertext product(const Ciphertext &rotated, const Ciphertext &diagonal) const
+    {
+        return cc_->EvalMultNoRelin(rotated, diagonal);
+    }
+
+    // rot(packed, b) for b < baby_, off one hoisted precomputation when the
+    // scheme supports it.
+    std::vector<Ciphertext> baby_rotations(const Ciphertext &packed) const
+    {
+        std::vector<Ciphertext> rotated{ packed };
+        if (baby_ == 1)
+        {
+            return rotated;
+        }
+        try
+        {
+            auto precomputed = cc_->EvalFastRotationPrecompute(packed);
+            std::uint32_t m = cc_->GetCyclotomicOrder();
+            for (std::size_t b = 1; b < baby_; b++)
+            {
+                rotated.push_back(cc_->EvalFastRotation(packed, static_cast<std::uint32_t>(b), m, precomputed));
+            }
+        }
+        catch (const lbcrypto::not_implemented_error &)
+        {
+            rotated.resize(1);
+            for (std::size_t b = 1; b < baby_; b++)
+            {
+                rotated.push_back(cc_->EvalAtIndex(packed, static_cast<std::int32_t>(b)));
+            }
+        }
+        return rotated;
+    }
+
+    lbcrypto::CryptoContext<lbcrypto::DCRTPoly> cc_;
+    std::size_t d_;
+    std::size_t columns_;
+    std::size_t row_slots_;
+    bool bsgs_;
+    std::size_t baby_;
+};
+
+} // namespace hebench
@@ -0,0 +1,93 @@
+/****************************************************/
+/* Multiply-add for PALISADE                        */
+/* Adds products into an existing accumulator in    */
+/* place instead of allocating a result per step;   */
+/* sums of products pay one relinearization         */
+/****************************************************/
+
+#pragma once
+
+#include <stdexcept>
+#include <vector>
+#include "palisade.h"
+
+namespace hebench
+{
+
+// Ciphertexts live in evaluation (NTT) form throughout, so a product and
+// the add that follows never leave it; plaintext factors should be put in
+// evaluation form once up front (PalisadeBackend::encrypt does), or
+// EvalMult transforms them on every call.
+//
+// PALISADE exposes no multiply that writes into an existing ciphertext,
+// and one product needs its relinearization whether it comes before or
+// after the add, so the single-term forms are EvalMult followed by an
+// in-place add: they save the third ciphertext, not any arithmetic. Only
+// the vector form merges work, relinearizing n products once.
+class MultiplyAccumulator
+{
+public:
+    using Ciphertext = lbcrypto::Ciphertext<lbcrypto::DCRTPoly>;
+
+    explicit MultiplyAccumulator(lbcrypto::CryptoContext<lbcrypto::DCRTPoly> cc) : cc_(cc)
+    {}
+
+    // addend + a * b, built in the product's own buffer: the add writes into
+    // it rather than into a third ciphertext. b is a Ciphertext or Plaintext.
+    template <typename Factor>
+    Ciphertext multiply_then_add(const Ciphertext &addend, const Ciphertext &a, const Factor &b) const
+    {
+        Ciphertext product = cc_->EvalMult(a, b);
+        cc_->EvalAddInPlace(product, addend);
+        return product;
+    }
+
+    // accumulator += a * b.
+    template <typename Factor>
+    void multiply_then_add_inplace(Ciphertext &accumulator, const Ciphertext &a, const Factor &b) const
+    {
+        cc_->EvalAddInPlace(accumulator, cc_->EvalMult(a, b));
+    }
+
+    // accumulator += sum_i a[i] * b[i]. Ciphertext products are summed
+    // unrelinearized and relinearized once, n key switches become one.
+    void multiply_add_inplace(Ciphertext &accumulator, const std::vector<Ciphertext> &a,
+                              const std::vector<Ciphertext> &b) const
+    {
+        check_lengths(a.size(), b.size());
+        std::vector<Ciphertext> products;
+        products.reserve(a.size());
+        for (std::size_t i = 0; i < a.size(); i++)
+        {
+            products.push_back(cc_->EvalMultNoRelin(a[i], b[i]));
+        }
+        Ciphertext sum = products.size() == 1 ? products[0] : cc_->EvalAddMany(products);
+        cc_->RelinearizeInPlace(sum);
+        cc_->EvalAddInPlace(accumulator, sum);
+    }
+
+    // Plaintext products need no relinearization, so there is nothing to
+    // merge: each is added in place.
+    void multiply_add_inplace(Ciphertext &accumulator, const std::vector<Ciphertext> &a,
+                              const std::vector<lbcrypto::Plaintext> &b) const
+    {
+        check_lengths(a.size(), b.size());
+        for (std::size_t i = 0; i < a.size(); i++)
+        {
+            multiply_then_add_inplace(accumulator, a[i], b[i]);
+        }
+    }
+
+private:
+    static void check_lengths(std::size_t a, std::size_t b)
+    {
+        if (a == 0 || a != b)
+        {
+            throw std::invalid_argument("products need two non-empty operand vectors of the same length");
+        }
+    }
+
+    lbcrypto::CryptoContext<lbcrypto::DCRTPoly> cc_;
+};
+
+} // namespace hebench
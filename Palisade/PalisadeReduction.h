@@ -0,0 +1,205 @@
+/****************************************************/
+/* Rotation-based slot sums for PALISADE            */
+/* Baby steps share one hoisted key-switch          */
+/* decomposition, giant steps double in a tree;     */
+/* replaces EvalSum / EvalInnerProduct and adds     */
+/* sums per segment of k slots                      */
+/****************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <complex>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "palisade.h"
+#include "RotationPlan.h"
+
+namespace hebench
+{
+
+// Slot i of sum(ct, n) holds x[i] + x[i+1] + ... + x[i+n-1] (cyclically),
+// so slot 0 holds the total as with EvalSum(ct, n), and with n = k every
+// slot that starts a segment of k holds that segment's sum.
+//
+// For n = B * 2^g the first B-1 rotations all rotate the input, so they
+// share one EvalFastRotationPrecompute (the digit decomposition and its
+// NTTs); each of them still key-switches (the inner product with its key
+// and the modulus switch back), and the remaining g rotations double the
+// window as usual. EvalSum costs log2(n) full rotations, this B-1 hoisted
+// plus g full ones: for n = 4096 and B = 8, 7 hoisted + 9 full against 12.
+// B > 1 only pays when B-1 hoisted rotations cost less than the log2(B)
+// full ones they replace; PalisadeBFV_EvalSum.cpp --baby-steps B times
+// both on BGVrns. Until that shows a win B defaults to 1: the plain tree,
+// with EvalSum's cost and the fewest keys.
+class SlotReducer
+{
+public:
+    using Ciphertext = lbcrypto::Ciphertext<lbcrypto::DCRTPoly>;
+
+    // baby_steps: window summed with hoisted rotations, a power of two.
+    // Each baby step needs its own key, so baby_steps = 1 gives the
+    // smallest key set (log2(n) keys) and no hoisting.
+    explicit SlotReducer(lbcrypto::CryptoContext<lbcrypto::DCRTPoly> cc, std::size_t baby_steps = 1)
+        : cc_(cc), baby_steps_(baby_steps),
+          ckks_(std::dynamic_pointer_cast<lbcrypto::LPCryptoParametersCKKS<lbcrypto::DCRTPoly>>(
+                    cc->GetCryptoParameters()) != nullptr)
+    {
+        if (!IsPowerOfTwo(baby_steps))
+        {
+            throw std::invalid_argument("baby steps must be a power of two");
+        }
+    }
+
+    // Rotations sum(ct, n) performs; generate keys for rotations(n).indices().
+    RotationPlan rotations(std::size_t n) const
+    {
+        check_window(n);
+        RotationPlan plan;
+        std::size_t baby = baby_window(n);
+        for (std::size_t j = 1; j < baby; j++)
+        {
+            plan.rotate(static_cast<int>(j));
+        }
+        for (std::size_t step = baby; step < n; step *= 2)
+        {
+            plan.rotate(static_cast<int>(step));
+        }
+        return plan;
+    }
+
+    // Key switches a sum over n slots costs: hoisted ones share a single
+    // decomposition but each still switches keys, full ones each decompose
+    // again.
+    std::size_t hoisted_rotations(std::size_t n) const
+    {
+        return baby_window(n) - 1;
+    }
+
+    std::size_t full_rotations(std::size_t n) const
+    {
+        std::size_t count = 0;
+        for (std::size_t step = baby_window(n); step < n; step *= 2)
+        {
+            count++;
+        }
+        return count;
+    }
+
+    // False once the context turned out to have no EvalFastRotation, so
+    // baby steps run as plain rotations.
+    bool hoisting() const
+    {
+        return hoisting_;
+    }
+
+    Ciphertext sum(const Ciphertext &ciphertext, std::size_t n) const
+    {
+        check_window(n);
+        Ciphertext total = baby_sum(ciphertext, baby_window(n));
+        for (std::size_t step = baby_window(n); step < n; step *= 2)
+        {
+            total = cc_->EvalAdd(total, cc_->EvalAtIndex(total, static_cast<std::int32_t>(step)));
+        }
+        return total;
+    }
+
+    // Adds the ciphertexts first, so the rotations are paid once rather
+    // than once per ciphertext.
+    Ciphertext sum(const std::vector<Ciphertext> &ciphertexts, std::size_t n) const
+    {
+        if (ciphertexts.empty())
+        {
+            throw std::invalid_argument("nothing to sum");
+        }
+        return sum(ciphertexts.size() == 1 ? ciphertexts[0] : cc_->EvalAddMany(ciphertexts), n);
+    }
+
+    // Slot i holds sum_{j<n} a[i+j] * b[i+j], as EvalInnerProduct(a, b, n).
+    Ciphertext inner_product(const Ciphertext &a, const Ciphertext &b, std::size_t n) const
+    {
+        return sum(cc_->EvalMult(a, b), n);
+    }
+
+    // Sum of every segment of k slots, in the segment's first slot; the
+    // other slots are zeroed with one plaintext multiplication (a level on
+    // CKKS, whose mask is a CKKS plaintext).
+    Ciphertext segment_sums(const Ciphertext &ciphertext, std::size_t k, std::size_t slots) const
+    {
+        if (ckks_)
+        {
+            std::vector<std::complex<double>> mask(slots, 0);
+            for (std::size_t i = 0; i < slots; i += k)
+            {
+                mask[i] = 1;
+            }
+            return cc_->EvalMult(sum(ciphertext, k), cc_->MakeCKKSPackedPlaintext(mask));
+        }
+        std::vector<std::int64_t> mask(slots, 0);
+        for (std::size_t i = 0; i < slots; i += k)
+        {
+            mask[i] = 1;
+        }
+        return cc_->EvalMult(sum(ciphertext, k), cc_->MakePackedPlaintext(mask));
+    }
+
+private:
+    static bool IsPowerOfTwo(std::size_t n)
+    {
+        return n != 0 && (n & (n - 1)) == 0;
+    }
+
+    void check_window(std::size_t n) const
+    {
+        if (!IsPowerOfTwo(n))
+        {
+            throw std::invalid_argument("slot sums need a power-of-two window, got " + std::to_string(n));
+        }
+    }
+
+    std::size_t baby_window(std::size_t n) const
+    {
+        return std::min(baby_steps_, n);
+    }
+
+    // ct + rot(ct, 1) + ... + rot(ct, baby-1) from one precomputation.
+    // Schemes without fast rotations in this PALISADE build fall back to
+    // plain EvalAtIndex.
+    Ciphertext baby_sum(const Ciphertext &ciphertext, std::size_t baby) const
+    {
+        std::vector<Ciphertext> terms{ ciphertext };
+        if (baby > 1 && hoisting_)
+        {
+            try
+            {
+                auto precomputed = cc_->EvalFastRotationPrecompute(ciphertext);
+                std::uint32_t m = cc_->GetCyclotomicOrder();
+                for (std::size_t j = 1; j < baby; j++)
+                {
+                    terms.push_back(cc_->EvalFastRotation(ciphertext, static_cast<std::uint32_t>(j), m, precomputed));
+                }
+                return cc_->EvalAddMany(terms);
+            }
+            catch (const lbcrypto::not_implemented_error &)
+            {
+                hoisting_ = false;
+                terms.resize(1);
+            }
+        }
+        for (std::size_t j = 1; j < baby; j++)
+        {
+            terms.push_back(cc_->EvalAtIndex(ciphertext, static_cast<std::int32_t>(j)));
+        }
+        return terms.size() == 1 ? ciphertext : cc_->EvalAddMany(terms);
+    }
+
+    lbcrypto::CryptoContext<lbcrypto::DCRTPoly> cc_;
+    std::size_t baby_steps_;
+    bool ckks_;
+    mutable std::atomic<bool> hoisting_{ true };
+};
+
+} // namespace hebench
@@ -0,0 +1,370 @@
+/****************************************************/
+/* Slot-batched encrypted linear regression         */
+/* Samples packed across the slots of BFVrns/CKKS   */
+/* ciphertexts, X^T X and X^T y by slot-wise        */
+/* products and rotate-and-sum, solved by the       */
+/* client after decryption or by encrypted CKKS     */
+/* gradient descent within a depth budget           */
+/****************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "palisade.h"
+#include "PalisadeReduction.h"
+#include "RotationPlan.h"
+
+namespace hebench
+{
+
+// Least squares by the normal equations (X^T X) b = X^T y, with X and y
+// encrypted column by column: each feature is a list of ciphertexts holding
+// chunk_slots samples each. Every entry of X^T X and X^T y is one slot-wise
+// product per chunk, the chunks added unrelinearized, one relinearization
+// and one rotate-and-sum over the rotation window. The d x d system left is
+// tiny and is solved in the clear after decryption.
+//
+// Rotations only cycle within a window (half the ring for BFVrns, the batch
+// for CKKS), so a chunk of several windows decrypts to one partial total
+// per window, added up by the client.
+//
+// T is std::int64_t for BFV (exact sums, the plaintext modulus must exceed
+// twice a window's total) and double for CKKS, where every value is divided
+// by sqrt(samples) before encoding so the sums stay the size of a mean;
+// both sides of the system scale alike and the solution does not change.
+template <typename T>
+class BatchedRegression
+{
+public:
+    using Ciphertext = lbcrypto::Ciphertext<lbcrypto::DCRTPoly>;
+    using Matrix = std::vector<std::vector<T>>; // samples x features, row-major
+
+    struct EncryptedData
+    {
+        std::vector<std::vector<Ciphertext>> features; // [feature][chunk]
+        std::vector<Ciphertext> targets;               // [chunk]
+        std::size_t samples = 0;
+    };
+
+    // Upper triangle of X^T X (xtx[j][k] for k >= j) and X^T y, each total
+    // spread over the first slot of every window.
+    struct EncryptedMoments
+    {
+        std::vector<std::vector<Ciphertext>> xtx;
+        std::vector<Ciphertext> xty;
+    };
+
+    BatchedRegression(lbcrypto::CryptoContext<lbcrypto::DCRTPoly> cc, std::size_t chunk_slots, std::size_t window,
+                      std::size_t baby_steps = 1)
+        : cc_(cc), chunk_slots_(chunk_slots), window_(window), reducer_(cc, baby_steps)
+    {
+        if (window == 0 || chunk_slots % window != 0)
+        {
+            throw std::invalid_argument("chunk of " + std::to_string(chunk_slots) +
+                                        " slots is not a multiple of the rotation window " + std::to_string(window));
+        }
+    }
+
+    // Rotation keys moments() needs.
+    RotationPlan rotations() const
+    {
+        return reducer_.rotations(window_);
+    }
+
+    std::size_t chunks(std::size_t samples) const
+    {
+        return (samples + chunk_slots_ - 1) / chunk_slots_;
+    }
+
+    /*****Client*****/
+    // CKKS moments come out multiplied by weight, e.g. a gradient step size
+    // (GradientDescentRegression); BFV ignores it.
+    EncryptedData encrypt(const Matrix &x, const std::vector<T> &y,
+                          const lbcrypto::LPPublicKey<lbcrypto::DCRTPoly> &public_key, double weight = 1) const
+    {
+        if (x.empty() || x.size() != y.size())
+        {
+            throw std::invalid_argument("regression needs one target per sample");
+        }
+        EncryptedData data;
+        data.samples = x.size();
+        std::size_t features = x[0].size();
+        data.features.resize(features);
+        for (std::size_t begin = 0; begin < data.samples; begin += chunk_slots_)
+        {
+            std::size_t end = std::min(begin + chunk_slots_, data.samples);
+            for (std::size_t j = 0; j < features; j++)
+            {
+                std::vector<T> slots(chunk_slots_, T(0));
+                for (std::size_t i = begin; i < end; i++)
+                {
+                    slots[i - begin] = Normalize(x[i][j], data.samples, weight);
+                }
+                data.features[j].push_back(cc_->Encrypt(public_key, MakePlaintext(cc_, slots)));
+            }
+            std::vector<T> slots(chunk_slots_, T(0));
+            for (std::size_t i = begin; i < end; i++)
+            {
+                slots[i - begin] = Normalize(y[i], data.samples, weight);
+            }
+            data.targets.push_back(cc_->Encrypt(public_key, MakePlaintext(cc_, slots)));
+        }
+        return data;
+    }
+
+    // Decrypts the moments and solves for the coefficients.
+    std::vector<double> solve(const EncryptedMoments &moments,
+                              const lbcrypto::LPPrivateKey<lbcrypto::DCRTPoly> &secret_key) const
+    {
+        std::size_t d = moments.xty.size();
+        std::vector<std::vector<double>> xtx(d, std::vector<double>(d));
+        std::vector<double> xty(d);
+        for (std::size_t j = 0; j < d; j++)
+        {
+            for (std::size_t k = j; k < d; k++)
+            {
+                xtx[j][k] = xtx[k][j] = total(moments.xtx[j][k - j], secret_key);
+            }
+            xty[j] = total(moments.xty[j], secret_key);
+        }
+        return SolveNormalEquations(std::move(xtx), std::move(xty));
+    }
+
+    /*****Server*****/
+    EncryptedMoments moments(const EncryptedData &data) const
+    {
+        EncryptedMoments moments;
+        std::size_t d = data.features.size();
+        moments.xtx.resize(d);
+        for (std::size_t j = 0; j < d; j++)
+        {
+            for (std::size_t k = j; k < d; k++)
+            {
+                moments.xtx[j].push_back(dot(data.features[j], data.features[k]));
+            }
+            moments.xty.push_back(dot(data.features[j], data.targets));
+        }
+        return moments;
+    }
+
+    // Gaussian elimination with partial pivoting; the system is d x d.
+    static std::vector<double> SolveNormalEquations(std::vector<std::vector<double>> a, std::vector<double> b)
+    {
+        std::size_t d = b.size();
+        for (std::size_t col = 0; col < d; col++)
+        {
+            std::size_t pivot = col;
+            for (std::size_t row = col + 1; row < d; row++)
+            {
+                if (std::fabs(a[row][col]) > std::fabs(a[pivot][col]))
+                    pivot = row;
+            }
+            if (a[pivot][col] == 0)
+            {
+                throw std::runtime_error("X^T X is singular");
+            }
+            std::swap(a[col], a[pivot]);
+            std::swap(b[col], b[pivot]);
+            for (std::size_t row = col + 1; row < d; row++)
+            {
+                double factor = a[row][col] / a[col][col];
+                for (std::size_t k = col; k < d; k++)
+                {
+                    a[row][k] -= factor * a[col][k];
+                }
+                b[row] -= factor * b[col];
+            }
+        }
+        std::vector<double> solution(d);
+        for (std::size_t row = d; row-- > 0;)
+        {
+            double sum = b[row];
+            for (std::size_t k = row + 1; k < d; k++)
+            {
+                sum -= a[row][k] * solution[k];
+            }
+            solution[row] = sum / a[row][row];
+        }
+        return solution;
+    }
+
+private:
+    static std::int64_t Normalize(std::int64_t value, std::size_t, double)
+    {
+        return value;
+    }
+
+    static double Normalize(double value, std::size_t samples, double weight)
+    {
+        return value * std::sqrt(weight / static_cast<double>(samples));
+    }
+
+    static lbcrypto::Plaintext MakePlaintext(const lbcrypto::CryptoContext<lbcrypto::DCRTPoly> &cc,
+                                             const std::vector<std::int64_t> &slots)
+    {
+        return cc->MakePackedPlaintext(slots);
+    }
+
+    static lbcrypto::Plaintext MakePlaintext(const lbcrypto::CryptoContext<lbcrypto::DCRTPoly> &cc,
+                                             const std::vector<double> &slots)
+    {
+        return cc->MakeCKKSPackedPlaintext(std::vector<std::complex<double>>(slots.begin(), slots.end()));
+    }
+
+    static double Slot(const lbcrypto::Plaintext &plain, std::size_t i, std::int64_t)
+    {
+        return static_cast<double>(plain->GetPackedValue()[i]);
+    }
+
+    static double Slot(const lbcrypto::Plaintext &plain, std::size_t i, double)
+    {
+        return plain->GetRealPackedValue()[i];
+    }
+
+    // sum_i a[i] * b[i] over every sample, one total per window.
+    Ciphertext dot(const std::vector<Ciphertext> &a, const std::vector<Ciphertext> &b) const
+    {
+        std::vector<Ciphertext> products;
+        for (std::size_t c = 0; c < a.size(); c++)
+        {
+            products.push_back(cc_->EvalMultNoRelin(a[c], b[c]));
+        }
+        Ciphertext sum = products.size() == 1 ? products[0] : cc_->EvalAddMany(products);
+        return reducer_.sum(cc_->Relinearize(sum), window_);
+    }
+
+    double total(const Ciphertext &moment, const lbcrypto::LPPrivateKey<lbcrypto::DCRTPoly> &secret_key) const
+    {
+        lbcrypto::Plaintext plain;
+        cc_->Decrypt(secret_key, moment, &plain);
+        double sum = 0;
+        for (std::size_t w = 0; w < chunk_slots_; w += window_)
+        {
+            sum += Slot(plain, w, T());
+        }
+        return sum;
+    }
+
+    lbcrypto::CryptoContext<lbcrypto::DCRTPoly> cc_;
+    std::size_t chunk_slots_;
+    std::size_t window_;
+    SlotReducer reducer_;
+};
+
+// Gradient descent on encrypted CKKS moments, so the server returns an
+// encrypted model instead of the system. With G = eta X^T X / n and
+// h = eta X^T y / n (BatchedRegression::encrypt with weight = eta), a step
+// from b_0 = 0 is b_{t+1} = M b_t + h with M = I - G, so
+// b_T = (I + M + ... + M^(T-1)) h. Doubling S_{2t} = S_t + M^t S_t and
+// M^{2t} = M^t M^t reaches T = 2^levels steps at depth levels (plus one
+// for the moments) where stepping one by one costs depth T.
+//
+// Converges for eta < 2 / lambda_max(X^T X / n); with features scaled to
+// [-1, 1] eta = 1 / features is safe. The error left after T steps shrinks
+// like (1 - eta lambda_min)^T: a small approximation error for a fixed,
+// low depth, where the exact rational path needs moduli growing with d.
+class GradientDescentRegression
+{
+public:
+    using Ciphertext = lbcrypto::Ciphertext<lbcrypto::DCRTPoly>;
+    using Moments = BatchedRegression<double>::EncryptedMoments;
+
+    explicit GradientDescentRegression(lbcrypto::CryptoContext<lbcrypto::DCRTPoly> cc) : cc_(cc)
+    {}
+
+    static std::size_t Steps(std::size_t levels)
+    {
+        return std::size_t(1) << levels;
+    }
+
+    // Multiplicative depth fit(moments, levels) needs, moments included.
+    static std::size_t Depth(std::size_t levels)
+    {
+        return levels + 1;
+    }
+
+    // Encrypted coefficients after Steps(levels) descent steps, each in
+    // every slot of its ciphertext.
+    std::vector<Ciphertext> fit(const Moments &moments, std::size_t levels) const
+    {
+        if (levels == 0)
+        {
+            throw std::invalid_argument("gradient descent needs at least one level");
+        }
+        std::size_t d = moments.xty.size();
+        std::vector<std::vector<Ciphertext>> power(d, std::vector<Ciphertext>(d));
+        for (std::size_t j = 0; j < d; j++)
+        {
+            for (std::size_t k = j; k < d; k++)
+            {
+                power[j][k] = power[k][j] = cc_->EvalNegate(moments.xtx[j][k - j]);
+            }
+            power[j][j] = cc_->EvalAdd(power[j][j], 1.0);
+        }
+
+        std::vector<Ciphertext> sum = moments.xty;
+        for (std::size_t level = 0; level < levels; level++)
+        {
+            std::vector<Ciphertext> next(d);
+            for (std::size_t j = 0; j < d; j++)
+            {
+                next[j] = cc_->EvalAdd(sum[j], row_times(power[j], sum));
+            }
+            if (level + 1 < levels)
+            {
+                std::vector<std::vector<Ciphertext>> squared(d, std::vector<Ciphertext>(d));
+                for (std::size_t j = 0; j < d; j++)
+                {
+                    std::vector<Ciphertext> column(d);
+                    for (std::size_t k = 0; k < d; k++)
+                    {
+                        for (std::size_t i = 0; i < d; i++)
+                        {
+                            column[i] = power[i][k];
+                        }
+                        squared[j][k] = row_times(power[j], column);
+                    }
+                }
+                power = std::move(squared);
+            }
+            sum = std::move(next);
+        }
+        return sum;
+    }
+
+    std::vector<double> decrypt(const std::vector<Ciphertext> &coefficients,
+                                const lbcrypto::LPPrivateKey<lbcrypto::DCRTPoly> &secret_key) const
+    {
+        std::vector<double> result;
+        for (const Ciphertext &coefficient : coefficients)
+        {
+            lbcrypto::Plaintext plain;
+            cc_->Decrypt(secret_key, coefficient, &plain);
+            result.push_back(plain->GetRealPackedValue()[0]);
+        }
+        return result;
+    }
+
+private:
+    // sum_k row[k] * v[k], relinearized once.
+    Ciphertext row_times(const std::vector<Ciphertext> &row, const std::vector<Ciphertext> &v) const
+    {
+        std::vector<Ciphertext> products;
+        for (std::size_t k = 0; k < row.size(); k++)
+        {
+            products.push_back(cc_->EvalMultNoRelin(row[k], v[k]));
+        }
+        return cc_->Relinearize(products.size() == 1 ? products[0] : cc_->EvalAddMany(products));
+    }
+
+    lbcrypto::CryptoContext<lbcrypto::DCRTPoly> cc_;
+};
+
+} // namespace hebench
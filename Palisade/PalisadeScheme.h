@@ -0,0 +1,201 @@
+/****************************************************/
+/* PALISADE implementation of the generic HE        */
+/* interface: BFV, BGV and CKKS behind the          */
+/* operations HEScheme.h lists                      */
+/****************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "palisade.h"
+#include "BenchConfig.h"
+#include "RotationPlan.h"
+
+namespace hebench
+{
+
+class PalisadeScheme
+{
+public:
+    using Plaintext = lbcrypto::Plaintext;
+    using Ciphertext = lbcrypto::Ciphertext<lbcrypto::DCRTPoly>;
+
+    static const char *Name()
+    {
+        return "palisade";
+    }
+
+    static bool Supports(const std::string &scheme)
+    {
+        return scheme == "bfv" || scheme == "bgv" || scheme == "ckks";
+    }
+
+    /*****Context*****/
+    // Same parameters as PalisadeBackend for the same config.
+    explicit PalisadeScheme(const BenchConfig &config) : config_(config), ckks_(config.scheme == "ckks")
+    {
+        if (!Supports(config.scheme))
+        {
+            throw std::invalid_argument("PALISADE does not support the " + config.scheme + " scheme");
+        }
+        double sigma = 3.2;
+        lbcrypto::SecurityLevel securityLevel = config.security == 256   ? lbcrypto::HEStd_256_classic
+                                                : config.security == 192 ? lbcrypto::HEStd_192_classic
+                                                                         : lbcrypto::HEStd_128_classic;
+        uint32_t ring_dim = static_cast<uint32_t>(config.ring_dim);
+
+        if (config.scheme == "bfv")
+        {
+            uint32_t dcrt_bits = config.coeff_bits.empty()
+                                     ? 60
+                                     : static_cast<uint32_t>(*std::max_element(config.coeff_bits.begin(),
+                                                                               config.coeff_bits.end()));
+            cc_ = lbcrypto::CryptoContextFactory<lbcrypto::DCRTPoly>::genCryptoContextBFVrns(
+                config.plain_modulus, securityLevel, sigma, 0, config.depth, 0, lbcrypto::OPTIMIZED, 2, 0, dcrt_bits,
+                ring_dim);
+        }
+        else if (config.scheme == "bgv")
+        {
+            cc_ = lbcrypto::CryptoContextFactory<lbcrypto::DCRTPoly>::genCryptoContextBGVrns(
+                config.depth, config.plain_modulus, securityLevel, sigma, config.depth, lbcrypto::OPTIMIZED,
+                lbcrypto::BV, ring_dim);
+        }
+        else
+        {
+            cc_ = lbcrypto::CryptoContextFactory<lbcrypto::DCRTPoly>::genCryptoContextCKKS(
+                config.depth, config.scale_bits, ring_dim / 2, securityLevel, ring_dim);
+        }
+
+        cc_->Enable(lbcrypto::ENCRYPTION);
+        cc_->Enable(lbcrypto::SHE);
+        // LevelReduce (transport sizes) and rescaling need it for CKKS too.
+        if (config.scheme == "bgv" || config.scheme == "ckks")
+        {
+            cc_->Enable(lbcrypto::LEVELEDSHE);
+        }
+    }
+
+    // EvalMult key always, EvalAtIndex keys for the planned rotations.
+    void keygen(const RotationPlan &rotations = RotationPlan())
+    {
+        keys_ = cc_->KeyGen();
+        cc_->EvalMultKeyGen(keys_.secretKey);
+        if (rotations.key_count() > 0)
+        {
+            cc_->EvalAtIndexKeyGen(keys_.secretKey, rotations.indices());
+        }
+    }
+
+    std::size_t slot_count() const
+    {
+        return ckks_ ? cc_->GetRingDimension() / 2 : cc_->GetRingDimension();
+    }
+
+    // BFV/BGV slots form two rows that EvalAtIndex rotates separately.
+    std::size_t row_size() const
+    {
+        return ckks_ ? slot_count() : slot_count() / 2;
+    }
+
+    /*****Encode, encrypt, decrypt*****/
+    // CKKS rescales automatically before the next multiplication, so after
+    // level > 0 multiplications a value sits unrescaled (scale squared) one
+    // tower below the previous product; an addend encoded there is added
+    // without EvalAdd adjusting it. BFV/BGV values are rounded.
+    Plaintext encode(const std::vector<double> &values, std::size_t level = 0) const
+    {
+        if (ckks_)
+        {
+            std::vector<std::complex<double>> slots(values.begin(), values.end());
+            return level == 0 ? cc_->MakeCKKSPackedPlaintext(slots)
+                              : cc_->MakeCKKSPackedPlaintext(slots, 2, static_cast<uint32_t>(level - 1));
+        }
+        std::vector<std::int64_t> slots(values.size());
+        for (std::size_t i = 0; i < values.size(); i++)
+        {
+            slots[i] = std::llround(values[i]);
+        }
+        return cc_->MakePackedPlaintext(slots);
+    }
+
+    Ciphertext encrypt(const Plaintext &plain) const
+    {
+        return cc_->Encrypt(keys_.publicKey, plain);
+    }
+
+    // BFV/BGV values come back centered in (-t/2, t/2].
+    std::vector<double> decrypt(const Ciphertext &encrypted, std::size_t n) const
+    {
+        lbcrypto::Plaintext plain;
+        cc_->Decrypt(keys_.secretKey, encrypted, &plain);
+        plain->SetLength(n);
+
+        std::vector<double> values(n);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            values[i] = ckks_ ? plain->GetCKKSPackedValue()[i].real() : static_cast<double>(plain->GetPackedValue()[i]);
+        }
+        return values;
+    }
+
+    /*****Evaluate*****/
+    Ciphertext add(const Ciphertext &a, const Ciphertext &b) const
+    {
+        return cc_->EvalAdd(a, b);
+    }
+
+    Ciphertext add_plain(const Ciphertext &a, const Plaintext &plain) const
+    {
+        return cc_->EvalAdd(a, plain);
+    }
+
+    // Unrelinearized: three polynomials.
+    Ciphertext multiply(const Ciphertext &a, const Ciphertext &b) const
+    {
+        return cc_->EvalMultNoRelin(a, b);
+    }
+
+    Ciphertext multiply_plain(const Ciphertext &a, const Plaintext &plain) const
+    {
+        return cc_->EvalMult(a, plain);
+    }
+
+    Ciphertext relinearize(const Ciphertext &a) const
+    {
+        return a->GetElements().size() > 2 ? cc_->Relinearize(a) : a;
+    }
+
+    // PALISADE manages levels itself (CKKS rescales before the next
+    // product), so this is the identity; ciphertexts are shared, not copied.
+    Ciphertext rescale(const Ciphertext &a) const
+    {
+        return a;
+    }
+
+    // EvalAdd and EvalMult match levels and depths themselves.
+    Ciphertext align(const Ciphertext &y, const Ciphertext &) const
+    {
+        return y;
+    }
+
+    // Left by step slots.
+    Ciphertext rotate(const Ciphertext &a, int step) const
+    {
+        return cc_->EvalAtIndex(relinearize(a), step);
+    }
+
+private:
+    BenchConfig config_;
+    bool ckks_;
+
+    lbcrypto::CryptoContext<lbcrypto::DCRTPoly> cc_;
+    lbcrypto::LPKeyPair<lbcrypto::DCRTPoly> keys_;
+};
+
+} // namespace hebench
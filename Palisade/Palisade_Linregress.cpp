@@ -1,6 +1,8 @@
 /* Code refer to the linregress.cpp*/
 
+#include <cmath>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <iterator>
 #include <random>
@@ -8,12 +10,17 @@
 #include "palisade.h"
 
 #include "math/matrix.h"
+#include "HETimer.h"
+#include "PalisadeRegression.h"
 
 using namespace std;
 using namespace lbcrypto;
 
 void ArbBGVLinearRegressionPackedArray();
 void ArbBFVLinearRegressionPackedArray();
+void BatchedBFVRegression(hebench::HETimer &timer);
+void BatchedCKKSRegression(hebench::HETimer &timer);
+void GradientDescentCKKSRegression(hebench::HETimer &timer);
 
 template <typename T>
 inline void print_matrix(std::vector<T> matrix, std::size_t row_size)
@@ -63,6 +70,24 @@ int main() {
 
   ArbBGVLinearRegressionPackedArray();
 
+  std::cout
+      << "\n===========SLOT-BATCHED LINEAR REGRESSION (BFVrns / CKKS)===============: "
+      << "X^T X and X^T y by rotate-and-sum over samples packed across slots"
+      << std::endl;
+
+  // single runs: the largest points encrypt a million rows
+  hebench::HETimer timer;
+  BatchedBFVRegression(timer);
+  BatchedCKKSRegression(timer);
+
+  std::cout
+      << "\n===========CKKS GRADIENT DESCENT (LOW DEPTH, APPROXIMATE)===============: "
+      << "encrypted coefficients after 2^levels descent steps at depth levels + 1"
+      << std::endl;
+
+  GradientDescentCKKSRegression(timer);
+  timer.print(std::cout);
+
   return 0;
 }
 
@@ -175,3 +200,232 @@ void ArbBGVLinearRegressionPackedArray() {
             << (*denominator)(1, 0)->GetPackedValue()[0] << std::endl;
 }
 
+// Fits y = 1 + 2 x_1 + ... + d x_{d-1} + noise for growing sample and
+// feature counts, and reports the time of each phase and the largest
+// coefficient error against the same fit in the clear.
+template <typename T>
+void BatchedRegressionSweep(const string &scheme, CryptoContext<DCRTPoly> cc,
+                            size_t chunk_slots, size_t window,
+                            hebench::HETimer &timer) {
+  LPKeyPair<DCRTPoly> kp = cc->KeyGen();
+  cc->EvalMultKeyGen(kp.secretKey);
+
+  hebench::BatchedRegression<T> regression(cc, chunk_slots, window);
+  hebench::RotationPlan rotations = regression.rotations();
+  timer.start(scheme + " rotation keys");
+  cc->EvalAtIndexKeyGen(kp.secretKey, rotations.indices());
+  timer.stop(scheme + " rotation keys");
+
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> value(0, 9);
+  std::uniform_int_distribution<int> noise(-1, 1);
+
+  std::cout << "\n" << scheme << ": " << chunk_slots
+            << " samples per ciphertext, " << rotations.key_count()
+            << " rotation keys" << std::endl;
+  std::cout << std::setw(10) << "samples" << std::setw(10) << "features"
+            << std::setw(12) << "chunks" << std::setw(14) << "encrypt_s"
+            << std::setw(14) << "moments_s" << std::setw(14) << "solve_s"
+            << std::setw(14) << "max_error" << std::endl;
+
+  for (size_t samples : {size_t(1) << 12, size_t(1) << 16, size_t(1) << 20}) {
+    for (size_t features : {size_t(2), size_t(4), size_t(8)}) {
+      vector<vector<T>> x(samples, vector<T>(features));
+      vector<T> y(samples);
+      for (size_t i = 0; i < samples; i++) {
+        x[i][0] = 1;
+        T target = 1 + noise(rng);
+        for (size_t j = 1; j < features; j++) {
+          x[i][j] = value(rng);
+          target += static_cast<T>(j + 1) * x[i][j];
+        }
+        y[i] = target;
+      }
+
+      vector<vector<double>> xtx(features, vector<double>(features, 0));
+      vector<double> xty(features, 0);
+      for (size_t i = 0; i < samples; i++)
+        for (size_t j = 0; j < features; j++) {
+          xty[j] += static_cast<double>(x[i][j]) * y[i];
+          for (size_t k = 0; k < features; k++)
+            xtx[j][k] += static_cast<double>(x[i][j]) * x[i][k];
+        }
+      vector<double> expected =
+          hebench::BatchedRegression<T>::SolveNormalEquations(xtx, xty);
+
+      string label =
+          scheme + " " + to_string(samples) + "x" + to_string(features);
+      typename hebench::BatchedRegression<T>::EncryptedData data;
+      typename hebench::BatchedRegression<T>::EncryptedMoments moments;
+      vector<double> coefficients;
+      timer.measure("Batched regression encryption: " + label,
+                    [&]() { data = regression.encrypt(x, y, kp.publicKey); });
+      timer.measure("Batched regression X^T X, X^T y: " + label,
+                    [&]() { moments = regression.moments(data); });
+      timer.measure("Batched regression decrypt + solve: " + label, [&]() {
+        coefficients = regression.solve(moments, kp.secretKey);
+      });
+
+      double error = 0;
+      for (size_t j = 0; j < features; j++)
+        error = std::max(error, std::fabs(coefficients[j] - expected[j]));
+
+      std::cout << std::setw(10) << samples << std::setw(10) << features
+                << std::setw(12) << regression.chunks(samples)
+                << std::setw(14)
+                << timer.stats("Batched regression encryption: " + label).wall_mean_s
+                << std::setw(14)
+                << timer.stats("Batched regression X^T X, X^T y: " + label).wall_mean_s
+                << std::setw(14)
+                << timer.stats("Batched regression decrypt + solve: " + label).wall_mean_s
+                << std::setw(14) << error << std::endl;
+    }
+  }
+}
+
+void BatchedBFVRegression(hebench::HETimer &timer) {
+  // 41-bit batching prime (1 mod 2^16): 2^20 samples with x < 10 and
+  // y < 320 sum to well under half of it, so the moments are exact
+  PlaintextModulus p = 1099512938497;
+  double sigma = 3.2;
+  uint32_t depth = 1;
+
+  CryptoContext<DCRTPoly> cc =
+      CryptoContextFactory<DCRTPoly>::genCryptoContextBFVrns(
+          p, HEStd_128_classic, sigma, 0, depth, 0, OPTIMIZED);
+  cc->Enable(ENCRYPTION);
+  cc->Enable(SHE);
+
+  // every slot holds a sample; rotations cycle through each half
+  size_t slots = cc->GetRingDimension();
+  BatchedRegressionSweep<int64_t>("BFVrns", cc, slots, slots / 2, timer);
+}
+
+void BatchedCKKSRegression(hebench::HETimer &timer) {
+  // one level more than the product needs: the moments are means of x*y
+  // (hundreds here), which would overflow the last modulus at 2^50 scale
+  uint32_t multDepth = 2;
+  uint32_t scaleFactorBits = 50;
+  uint32_t batchSize = 8192;
+
+  CryptoContext<DCRTPoly> cc =
+      CryptoContextFactory<DCRTPoly>::genCryptoContextCKKS(
+          multDepth, scaleFactorBits, batchSize, HEStd_128_classic);
+  cc->Enable(ENCRYPTION);
+  cc->Enable(SHE);
+
+  BatchedRegressionSweep<double>("CKKS", cc, batchSize, batchSize, timer);
+}
+
+// Features are scaled to [-1, 1] and targets to about [0, 1] by their known
+// ranges before encryption, which keeps X^T X well conditioned and the
+// coefficients small; the coefficients are mapped back after decryption.
+// Each depth budget is compared with the exact fit: the same moments
+// decrypted and solved by the client.
+void GradientDescentCKKSRegression(hebench::HETimer &timer) {
+  const size_t max_levels = 8;
+  uint32_t multDepth = hebench::GradientDescentRegression::Depth(max_levels);
+  uint32_t scaleFactorBits = 50;
+  uint32_t batchSize = 8192;
+
+  CryptoContext<DCRTPoly> cc =
+      CryptoContextFactory<DCRTPoly>::genCryptoContextCKKS(
+          multDepth, scaleFactorBits, batchSize, HEStd_128_classic);
+  cc->Enable(ENCRYPTION);
+  cc->Enable(SHE);
+  std::cout << "CKKS depth " << multDepth << ", ring dimension "
+            << cc->GetRingDimension() << std::endl;
+
+  LPKeyPair<DCRTPoly> kp = cc->KeyGen();
+  cc->EvalMultKeyGen(kp.secretKey);
+  hebench::BatchedRegression<double> regression(cc, batchSize, batchSize);
+  cc->EvalAtIndexKeyGen(kp.secretKey, regression.rotations().indices());
+  hebench::GradientDescentRegression descent(cc);
+
+  const double center = 4.5, radius = 4.5, target_range = 320;
+  const size_t samples = size_t(1) << 16;
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<int> value(0, 9);
+  std::uniform_int_distribution<int> noise(-1, 1);
+
+  std::cout << std::setw(10) << "features" << std::setw(10) << "levels"
+            << std::setw(10) << "steps" << std::setw(14) << "fit_s"
+            << std::setw(14) << "max_error" << std::endl;
+
+  for (size_t features : {size_t(2), size_t(4), size_t(8)}) {
+    vector<vector<double>> x(samples, vector<double>(features));
+    vector<double> y(samples);
+    vector<vector<double>> xtx(features, vector<double>(features, 0));
+    vector<double> xty(features, 0);
+    for (size_t i = 0; i < samples; i++) {
+      vector<double> raw(features, 1);
+      double target = 1 + noise(rng);
+      for (size_t j = 1; j < features; j++) {
+        raw[j] = value(rng);
+        target += (j + 1) * raw[j];
+      }
+      x[i][0] = 1;
+      for (size_t j = 1; j < features; j++)
+        x[i][j] = (raw[j] - center) / radius;
+      y[i] = target / target_range;
+      for (size_t j = 0; j < features; j++) {
+        xty[j] += raw[j] * target;
+        for (size_t k = 0; k < features; k++) xtx[j][k] += raw[j] * raw[k];
+      }
+    }
+    vector<double> expected =
+        hebench::BatchedRegression<double>::SolveNormalEquations(xtx, xty);
+
+    // coefficients of the scaled model back to the raw features
+    auto unscale = [&](const vector<double> &scaled) {
+      vector<double> raw(features);
+      raw[0] = scaled[0];
+      for (size_t j = 1; j < features; j++) {
+        raw[j] = scaled[j] / radius;
+        raw[0] -= scaled[j] * center / radius;
+      }
+      for (double &c : raw) c *= target_range;
+      return raw;
+    };
+    auto max_error = [&](const vector<double> &coefficients) {
+      double error = 0;
+      for (size_t j = 0; j < features; j++)
+        error = std::max(error, std::fabs(coefficients[j] - expected[j]));
+      return error;
+    };
+
+    // step size 1 / features: below 2 / lambda_max for features in [-1, 1]
+    double eta = 1.0 / features;
+    string suffix = " (" + to_string(features) + " features)";
+    hebench::BatchedRegression<double>::EncryptedData data;
+    hebench::BatchedRegression<double>::EncryptedMoments moments;
+    timer.start("Descent encryption" + suffix);
+    data = regression.encrypt(x, y, kp.publicKey, eta);
+    timer.stop("Descent encryption" + suffix);
+    timer.start("Descent X^T X, X^T y" + suffix);
+    moments = regression.moments(data);
+    timer.stop("Descent X^T X, X^T y" + suffix);
+
+    // exact: the system decrypted and solved by the client
+    vector<double> exact;
+    timer.measure("Exact solve" + suffix,
+                  [&]() { exact = regression.solve(moments, kp.secretKey); });
+    std::cout << std::setw(10) << features << std::setw(10) << "exact"
+              << std::setw(10) << "-" << std::setw(14)
+              << timer.stats("Exact solve" + suffix).wall_mean_s
+              << std::setw(14) << max_error(unscale(exact)) << std::endl;
+
+    for (size_t levels = 2; levels <= max_levels; levels += 2) {
+      string label = "Descent, " + to_string(levels) + " levels" + suffix;
+      vector<Ciphertext<DCRTPoly>> encrypted;
+      timer.measure(label, [&]() { encrypted = descent.fit(moments, levels); });
+      vector<double> coefficients =
+          unscale(descent.decrypt(encrypted, kp.secretKey));
+      std::cout << std::setw(10) << features << std::setw(10) << levels
+                << std::setw(10)
+                << hebench::GradientDescentRegression::Steps(levels)
+                << std::setw(14) << timer.stats(label).wall_mean_s
+                << std::setw(14) << max_error(coefficients) << std::endl;
+    }
+  }
+}
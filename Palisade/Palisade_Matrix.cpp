@@ -1,5 +1,6 @@
 /* Code refer to the linregress.cpp*/
 
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <iterator>
@@ -8,11 +9,15 @@
 #include "palisade.h"
 
 #include "math/matrix.h"
+#include "HETimer.h"
+#include "PalisadeLinearAlgebra.h"
 
 using namespace std;
 using namespace lbcrypto;
 
-void ArbBGVLinearRegressionPackedArray();
+void ArbBGVLinearRegressionPackedArray(hebench::HETimer &timer);
+void PackedBFVLinearAlgebra(size_t d, hebench::HETimer &timer);
+void PackedCKKSLinearAlgebra(size_t d, hebench::HETimer &timer);
 //void ArbBFVLinearRegressionPackedArray();
 
 template <typename T>
@@ -60,12 +65,25 @@ int main() {
       << "\n===========BGV TESTS (LINEAR-REGRESSION-ARBITRARY)===============: "
       << std::endl;
 
-  ArbBGVLinearRegressionPackedArray();
+  // 1 untimed warm-up run, then 10 timed repetitions of every phase
+  hebench::HETimer timer(1, 10);
+
+  ArbBGVLinearRegressionPackedArray(timer);
+
+  std::cout
+      << "\n===========PACKED LINEAR ALGEBRA (BFVrns / CKKS, DCRTPoly)===============: "
+      << "X^T X and X^T y for a d x d design matrix, diagonal (Halevi-Shoup) layout"
+      << std::endl;
+
+  PackedBFVLinearAlgebra(16, timer);
+  PackedCKKSLinearAlgebra(16, timer);
+
+  timer.print(std::cout);
 
   return 0;
 }
 
-void ArbBGVLinearRegressionPackedArray() {
+void ArbBGVLinearRegressionPackedArray(hebench::HETimer &timer) {
   PackedEncoding::Destroy();
 
   usint m = 22;
@@ -145,12 +163,17 @@ void ArbBGVLinearRegressionPackedArray() {
   std::cout << "Input array Y \n\t" << yP(0, 0) << std::endl;
   std::cout << "Input array Y \n\t" << yP(1, 0) << std::endl;
   //Encryption
-  shared_ptr<Matrix<RationalCiphertext<Poly>>> x =
-  cc->EncryptMatrix(kp.publicKey, xP);
-  shared_ptr<Matrix<RationalCiphertext<Poly>>> y =
-  cc->EncryptMatrix(kp.publicKey, yP);
+  shared_ptr<Matrix<RationalCiphertext<Poly>>> x;
+  shared_ptr<Matrix<RationalCiphertext<Poly>>> y;
+  timer.measure("EvalLinRegression: encryption (2x2)", [&]() {
+    x = cc->EncryptMatrix(kp.publicKey, xP);
+    y = cc->EncryptMatrix(kp.publicKey, yP);
+  });
   //Linear Regression
-  auto result = cc->EvalLinRegression(x, y);
+  shared_ptr<Matrix<RationalCiphertext<Poly>>> result;
+  timer.measure("EvalLinRegression (2x2)", [&]() {
+    result = cc->EvalLinRegression(x, y);
+  });
   //Decryption into num and denom matrices
   shared_ptr<Matrix<Plaintext>> numerator;
   shared_ptr<Matrix<Plaintext>> denominator;
@@ -168,3 +191,123 @@ void ArbBGVLinearRegressionPackedArray() {
   }
 
 
+void ReadSlots(const Plaintext &plain, vector<int64_t> *slots) {
+  *slots = plain->GetPackedValue();
+}
+
+void ReadSlots(const Plaintext &plain, vector<double> *slots) {
+  *slots = plain->GetRealPackedValue();
+}
+
+bool SameValue(int64_t a, int64_t b) { return a == b; }
+
+bool SameValue(double a, double b) { return std::fabs(a - b) < 1e-3; }
+
+template <typename T>
+bool SameMatrix(const vector<vector<T>> &a, const vector<vector<T>> &b,
+                size_t columns) {
+  for (size_t i = 0; i < a.size(); i++)
+    for (size_t j = 0; j < columns; j++)
+      if (!SameValue(a[i][j], b[i][j])) return false;
+  return true;
+}
+
+// X^T y (one packed column) and X^T X (d packed columns) with the diagonals
+// of X^T and the columns of X encrypted: the products behind the normal
+// equations EvalLinRegression solves, for a d x d design instead of 2x2.
+// Run once with a rotation key per diagonal and once with baby-step /
+// giant-step keys, and checked against the cleartext products.
+template <typename T>
+void PackedNormalEquations(const string &scheme, CryptoContext<DCRTPoly> cc,
+                           size_t row_slots, size_t d,
+                           hebench::HETimer &timer) {
+  LPKeyPair<DCRTPoly> kp = cc->KeyGen();
+  cc->EvalMultKeyGen(kp.secretKey);
+
+  vector<vector<T>> X(d, vector<T>(d)), Xt(d, vector<T>(d));
+  vector<vector<T>> y(d, vector<T>(1));
+  for (size_t i = 0; i < d; i++) {
+    for (size_t j = 0; j < d; j++) X[i][j] = static_cast<T>(rand() % 10);
+    y[i][0] = static_cast<T>(rand() % 10);
+  }
+  for (size_t i = 0; i < d; i++)
+    for (size_t j = 0; j < d; j++) Xt[i][j] = X[j][i];
+
+  vector<vector<T>> xtx(d, vector<T>(d, T(0))), xty(d, vector<T>(1, T(0)));
+  for (size_t i = 0; i < d; i++)
+    for (size_t k = 0; k < d; k++) {
+      xty[i][0] += Xt[i][k] * y[k][0];
+      for (size_t j = 0; j < d; j++) xtx[i][j] += Xt[i][k] * X[k][j];
+    }
+
+  for (bool bsgs : {false, true}) {
+    hebench::PackedLinearAlgebra<T> la(cc, d, d, row_slots, bsgs);
+    string label = scheme + (bsgs ? ", BSGS" : ", diagonal") +
+                   " (d=" + to_string(d) + ")";
+
+    hebench::RotationPlan rotations = la.rotations();
+    timer.start("Packed rotation keys: " + label);
+    cc->EvalAtIndexKeyGen(kp.secretKey, rotations.indices());
+    timer.stop("Packed rotation keys: " + label);
+
+    vector<Ciphertext<DCRTPoly>> enc_xt;
+    Ciphertext<DCRTPoly> enc_x, enc_y;
+    timer.measure("Packed encryption: " + label, [&]() {
+      enc_xt = la.encrypt_diagonals(Xt, kp.publicKey);
+      enc_x = cc->Encrypt(kp.publicKey, la.make_plaintext(la.pack_columns(X)));
+      enc_y = cc->Encrypt(kp.publicKey, la.make_plaintext(la.pack_columns(y)));
+    });
+
+    Ciphertext<DCRTPoly> enc_xty, enc_xtx;
+    timer.measure("Packed mat-vec X^T y: " + label,
+                  [&]() { enc_xty = la.multiply(enc_xt, enc_y); });
+    timer.measure("Packed mat-mat X^T X: " + label,
+                  [&]() { enc_xtx = la.multiply(enc_xt, enc_x); });
+
+    Plaintext plain_xty, plain_xtx;
+    cc->Decrypt(kp.secretKey, enc_xty, &plain_xty);
+    cc->Decrypt(kp.secretKey, enc_xtx, &plain_xtx);
+    vector<T> slots_xty, slots_xtx;
+    ReadSlots(plain_xty, &slots_xty);
+    ReadSlots(plain_xtx, &slots_xtx);
+
+    std::cout << label << ": " << rotations.key_count()
+              << " rotation keys, X^T y matches: " << std::boolalpha
+              << SameMatrix(la.unpack_columns(slots_xty), xty, 1)
+              << ", X^T X matches: "
+              << SameMatrix(la.unpack_columns(slots_xtx), xtx, d) << std::endl;
+  }
+}
+
+void PackedBFVLinearAlgebra(size_t d, hebench::HETimer &timer) {
+  // 65537 supports batching for every power-of-two ring; X^T X stays far
+  // below it for small entries
+  PlaintextModulus p = 65537;
+  double sigma = 3.2;
+  uint32_t depth = 1;
+
+  CryptoContext<DCRTPoly> cc =
+      CryptoContextFactory<DCRTPoly>::genCryptoContextBFVrns(
+          p, HEStd_128_classic, sigma, 0, depth, 0, OPTIMIZED);
+  cc->Enable(ENCRYPTION);
+  cc->Enable(SHE);
+
+  // rotations cycle through each half of the BFV slot matrix
+  PackedNormalEquations<int64_t>("BFVrns", cc, cc->GetRingDimension() / 2, d,
+                                 timer);
+}
+
+void PackedCKKSLinearAlgebra(size_t d, hebench::HETimer &timer) {
+  uint32_t multDepth = 1;
+  uint32_t scaleFactorBits = 50;
+  uint32_t batchSize = 4096;
+
+  CryptoContext<DCRTPoly> cc =
+      CryptoContextFactory<DCRTPoly>::genCryptoContextCKKS(
+          multDepth, scaleFactorBits, batchSize, HEStd_128_classic);
+  cc->Enable(ENCRYPTION);
+  cc->Enable(SHE);
+
+  // rotations cycle through the batch
+  PackedNormalEquations<double>("CKKS", cc, batchSize, d, timer);
+}
@@ -13,15 +13,19 @@
 #include <vector>
 #include "seal/seal.h"
 #include "examples.h"
+#include "HETimer.h"
+#include "SEALLazyEvaluator.h"
 
 using namespace std;
 using namespace seal;
 
 int example_bfv_basics()
 {
+    //1 untimed warm-up run, then 10 timed repetitions of encryption, evaluation and decryption
+    hebench::HETimer timer(1, 10);
+
     /*****Choose Parameters*****/
-    clock_t cc_clock;
-    cc_clock = clock();
+    timer.start("Parameter Generation");
 
     EncryptionParameters parms(scheme_type::BFV);
     size_t poly_modulus_degree = 2048; //8192 or 16384 or 32768
@@ -40,17 +44,16 @@ int example_bfv_basics()
     cout << "Batching enabled: " << boolalpha << qualifiers.using_batching << endl;
     cout << "Parameters for SEAL: " << boolalpha << qualifiers.parameters_set() << endl;
 
+    timer.stop("Parameter Generation");
+
     /*****Generate keys and functions*****/
-    clock_t key_clock;
-    key_clock = clock();
+    timer.start("Key Generation");
 
     KeyGenerator keygen(context);
     PublicKey public_key = keygen.public_key();
     SecretKey secret_key = keygen.secret_key();
     //Serializable<RelinKeys> rlk = keygen.relin_keys();
 
-    key_clock = clock() - key_clock;
-
     Encryptor encryptor(context, public_key);
     Evaluator evaluator(context);
     Decryptor decryptor(context, secret_key);
@@ -62,10 +65,8 @@ int example_bfv_basics()
     size_t row_size = slot_count / 2;
     
     
-    cc_clock = clock() - cc_clock - key_clock;
+    timer.stop("Key Generation");
     
-    clock_t enc_clock;
-    enc_clock = clock();
     //Generate the matrices of values 
     int N = slot_count; //or 100 or 1000 or 2760 or 4096 or 8192 or 16384 or 32768
 
@@ -85,47 +86,74 @@ int example_bfv_basics()
         times.push_back(c);
     }
      
-    /*****Encode*****/
     Plaintext plain_initial_vel;
     Plaintext plain_times;
     Plaintext plain_acc;
-
-    batch_encoder.encode(initial_velocity, plain_initial_vel);
-    batch_encoder.encode(times, plain_times);
-    batch_encoder.encode(acc, plain_acc);
-
-    /*****Encrypt*****/
     Ciphertext enc_initial_vel;
     Ciphertext enc_times;
     Ciphertext enc_acc;
 
-    encryptor.encrypt(plain_initial_vel, enc_initial_vel);
-    encryptor.encrypt(plain_times, enc_times);
-    encryptor.encrypt(plain_acc, enc_acc);
+    timer.measure("Encryption", [&]() {
+        /*****Encode*****/
+        batch_encoder.encode(initial_velocity, plain_initial_vel);
+        batch_encoder.encode(times, plain_times);
+        batch_encoder.encode(acc, plain_acc);
 
-    enc_clock = clock() - enc_clock;
+        /*****Encrypt*****/
+        encryptor.encrypt(plain_initial_vel, enc_initial_vel);
+        encryptor.encrypt(plain_times, enc_times);
+        encryptor.encrypt(plain_acc, enc_acc);
+    });
 
     /*****Evaluate*****/
-    clock_t eval_clock;
-    eval_clock = clock();
-
     Ciphertext enc_final_vel;
 
-    evaluator.multiply(enc_acc, enc_times, enc_final_vel);
-    evaluator.add_inplace(enc_final_vel, enc_initial_vel);
-
-    eval_clock = clock() - eval_clock;
+    timer.measure("Evaluation (v_i + at)", [&]() {
+        evaluator.multiply(enc_acc, enc_times, enc_final_vel);
+        evaluator.add_inplace(enc_final_vel, enc_initial_vel);
+    });
+
+    /*****Evaluate with public times*****/
+    //When t is known to the evaluator it stays a plaintext: multiply_plain with t transformed to NTT form once,
+    //no relinearization and much less noise than a ciphertext product
+    Plaintext plain_times_ntt = plain_times;
+    evaluator.transform_to_ntt_inplace(plain_times_ntt, context->first_parms_id());
+    Ciphertext enc_final_vel_public;
+
+    timer.measure("Evaluation (v_i + at, public t)", [&]() {
+        enc_final_vel_public = enc_acc;
+        evaluator.transform_to_ntt_inplace(enc_final_vel_public);
+        evaluator.multiply_plain_inplace(enc_final_vel_public, plain_times_ntt);
+        evaluator.transform_from_ntt_inplace(enc_final_vel_public);
+        evaluator.add_inplace(enc_final_vel_public, enc_initial_vel);
+    });
+
+    /*****Evaluate as fused multiply-adds*****/
+    //The products are added straight into a copy of v_i, formed in the lazy evaluator's reused per-thread
+    //scratch ciphertext instead of a fresh result each time (no relinearization keys here either)
+    RelinKeys no_relin_keys;
+    hebench::LazyEvaluator lazy_evaluator(context, evaluator, no_relin_keys, 0);
+    Ciphertext enc_final_vel_fused;
+    Ciphertext enc_final_vel_public_fused;
+
+    timer.measure("Evaluation (v_i + at, fused)", [&]() {
+        enc_final_vel_fused = enc_initial_vel;
+        lazy_evaluator.multiply_add_inplace(enc_final_vel_fused, enc_acc, enc_times);
+    });
+
+    timer.measure("Evaluation (v_i + at, public t, fused)", [&]() {
+        enc_final_vel_public_fused = enc_initial_vel;
+        lazy_evaluator.multiply_plain_add_inplace(enc_final_vel_public_fused, enc_acc, plain_times_ntt);
+    });
 
     /*****Decrypt*****/
-    clock_t dec_clock;
-    dec_clock = clock();
-
     Plaintext plain_final_vel;
     vector<uint64_t> final_vel;
 
-    decryptor.decrypt(enc_final_vel, plain_final_vel);
-    //decryptor.decrypt(final_vel, plain_final_vel);
-    dec_clock = clock() - dec_clock;
+    timer.measure("Decryption", [&]() {
+        decryptor.decrypt(enc_final_vel, plain_final_vel);
+        //decryptor.decrypt(final_vel, plain_final_vel);
+    });
 
     /*****Decode*****/
     batch_encoder.decode(plain_final_vel, final_vel);
@@ -145,12 +173,51 @@ int example_bfv_basics()
     //print_matrix(final_vel, row_size);
     print_vector(final_vel);
 
-    cout << "Times:" <<endl;
-    cout << "Parameter Generation  : " << ((float)cc_clock)/CLOCKS_PER_SEC << endl;
-    cout << "Key Generation        : " << ((float)key_clock)/CLOCKS_PER_SEC << endl;
-    cout << "Encryption            : " << ((float)enc_clock)/CLOCKS_PER_SEC << endl;
-    cout << "Evaluation (v_i + at) : " << ((float)eval_clock)/CLOCKS_PER_SEC << endl;
-    cout << "Decryption            : " << ((float)dec_clock)/CLOCKS_PER_SEC << endl;
+    Plaintext plain_final_vel_public;
+    vector<uint64_t> final_vel_public;
+    decryptor.decrypt(enc_final_vel_public, plain_final_vel_public);
+    batch_encoder.decode(plain_final_vel_public, final_vel_public);
+    cout << "Public t gives the same result: " << boolalpha << (final_vel_public == final_vel) << endl;
+
+    Plaintext plain_final_vel_fused;
+    vector<uint64_t> final_vel_fused, final_vel_public_fused;
+    decryptor.decrypt(enc_final_vel_fused, plain_final_vel_fused);
+    batch_encoder.decode(plain_final_vel_fused, final_vel_fused);
+    decryptor.decrypt(enc_final_vel_public_fused, plain_final_vel_fused);
+    batch_encoder.decode(plain_final_vel_fused, final_vel_public_fused);
+    cout << "Fused multiply-add gives the same result: " << boolalpha
+         << (final_vel_fused == final_vel && final_vel_public_fused == final_vel) << endl;
+    cout << "Noise budget left: " << decryptor.invariant_noise_budget(enc_final_vel) << " bits (encrypted t), "
+         << decryptor.invariant_noise_budget(enc_final_vel_public) << " bits (public t)" << endl;
+
+    /*****Object Sizes*****/
+    //Uncompressed serialized sizes; the product is never relinearized, so the result has 3 polynomials
+    cout << "Serialized sizes:" << endl;
+    hebench::PrintObjectSize(cout, { "Public key", static_cast<uint64_t>(public_key.save_size(compr_mode_type::none)) });
+    hebench::PrintObjectSize(cout, { "Ciphertext (input)", static_cast<uint64_t>(enc_acc.save_size(compr_mode_type::none)) });
+    hebench::PrintObjectSize(cout, { "Ciphertext (result)", static_cast<uint64_t>(enc_final_vel.save_size(compr_mode_type::none)) });
+
+    /*****Transport*****/
+    //What a client would upload and get back: seeded symmetric ciphertexts (the second polynomial is
+    //replaced by its PRNG seed) and the result mod-switched to the last level, both with the default compression
+    Encryptor sym_encryptor(context, secret_key);
+    compr_mode_type compr_mode = Serialization::compr_mode_default;
+    uint64_t upload_bytes = 0;
+    for (const Plaintext *plain : { &plain_initial_vel, &plain_times, &plain_acc })
+    {
+        Serializable<Ciphertext> seeded = sym_encryptor.encrypt_symmetric(*plain);
+        upload_bytes += hebench::SerializedBytes([&](ostream &out) { seeded.save(out, compr_mode); });
+    }
+    Ciphertext enc_final_vel_lowest = enc_final_vel;
+    evaluator.mod_switch_to_inplace(enc_final_vel_lowest, context->last_parms_id());
+    uint64_t download_bytes = hebench::SerializedBytes([&](ostream &out) { enc_final_vel_lowest.save(out, compr_mode); });
+
+    cout << "Transport sizes:" << endl;
+    hebench::PrintObjectSize(cout, { "Upload (3 inputs)", upload_bytes });
+    hebench::PrintObjectSize(cout, { "Download (result)", download_bytes });
+    cout << "Bytes per record: " << double(upload_bytes) / N << " up, " << double(download_bytes) / N << " down" << endl;
+
+    timer.print(cout);
 
     return 0;
 }
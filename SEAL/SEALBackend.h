@@ -0,0 +1,553 @@
+/****************************************************/
+/* SEAL backend for the velocity benchmark          */
+/* Same workload as SEALBFV.cpp / SEALCKKS.cpp      */
+/* final velocity = V_i + at   m/s                  */
+/****************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "seal/seal.h"
+#include "BenchConfig.h"
+#include "Compression.h"
+#include "HEMemory.h"
+#include "HERecycler.h"
+#include "KeyCache.h"
+#include "SEALLazyEvaluator.h"
+#include "VelocityData.h"
+
+namespace hebench
+{
+
+class SEALBackend
+{
+public:
+    struct Encoded
+    {
+        seal::Plaintext initial_velocity;
+        seal::Plaintext acc;
+        seal::Plaintext times;
+    };
+
+    // A public operand is kept as a plaintext, already in the form the
+    // evaluator consumes; its ciphertext member stays empty.
+    struct Encrypted
+    {
+        seal::Ciphertext initial_velocity;
+        seal::Ciphertext acc;
+        seal::Ciphertext times;
+        seal::Plaintext public_initial_velocity;
+        seal::Plaintext public_acc;
+        seal::Plaintext public_times;
+    };
+
+    using Result = seal::Ciphertext;
+
+    static const char *Name()
+    {
+        return "seal";
+    }
+
+    static bool Supports(const std::string &scheme)
+    {
+        return scheme == "bfv" || scheme == "ckks";
+    }
+
+    /*****Choose Parameters*****/
+    explicit SEALBackend(const BenchConfig &config)
+        : config_(config), ckks_(config.scheme == "ckks"), public_(config.public_operands),
+          thread_pools_(config.memory_pool == "thread"),
+          cache_(config.key_cache, std::string(Name()) + " " + SEAL_VERSION + " " + ParameterKey(config))
+    {
+        if (!Supports(config.scheme))
+        {
+            throw std::invalid_argument("SEAL does not support the " + config.scheme + " scheme");
+        }
+
+        // Every allocation SEAL makes without an explicit pool comes from
+        // MemoryManager::GetPool(): one mutex-guarded global pool, or with
+        // thread pools one lock-free pool per thread. The latter requires
+        // each object to be freed on the thread that allocated it, which the
+        // chunked engine (a chunk stays on one thread) guarantees.
+        if (thread_pools_)
+            seal::MemoryManager::SwitchProfile(std::make_unique<seal::MMProfThreadLocal>());
+        else
+            seal::MemoryManager::SwitchProfile(std::make_unique<seal::MMProfGlobal>());
+
+        seal::sec_level_type security = config.security == 256   ? seal::sec_level_type::tc256
+                                        : config.security == 192 ? seal::sec_level_type::tc192
+                                                                 : seal::sec_level_type::tc128;
+
+        // CoeffModulus::Create searches for NTT-friendly primes; a cached
+        // parameter set skips the search.
+        seal::EncryptionParameters parms(ckks_ ? seal::scheme_type::CKKS : seal::scheme_type::BFV);
+        if (!cache_.load("parms", [&](std::istream &in) { parms.load(in); }))
+        {
+            parms.set_poly_modulus_degree(config.ring_dim);
+            if (!config.coeff_bits.empty())
+            {
+                // Planned chain (--params auto), special prime last.
+                parms.set_coeff_modulus(seal::CoeffModulus::Create(config.ring_dim, config.coeff_bits));
+                if (!ckks_)
+                {
+                    parms.set_plain_modulus(config.plain_modulus);
+                }
+            }
+            else if (ckks_)
+            {
+                std::vector<int> bit_sizes{ 60 };
+                bit_sizes.insert(bit_sizes.end(), config.depth, static_cast<int>(config.scale_bits));
+                bit_sizes.push_back(60);
+                parms.set_coeff_modulus(seal::CoeffModulus::Create(config.ring_dim, bit_sizes));
+            }
+            else
+            {
+                parms.set_coeff_modulus(seal::CoeffModulus::BFVDefault(config.ring_dim, security));
+                parms.set_plain_modulus(config.plain_modulus);
+            }
+            cache_.store("parms", [&](std::ostream &out) { parms.save(out, seal::compr_mode_type::none); });
+        }
+        scale_ = ckks_ ? std::pow(2.0, config.scale_bits) : 0;
+
+        context_ = seal::SEALContext::Create(parms, true, security);
+        if (!context_->parameters_set())
+        {
+            throw std::invalid_argument(std::string("SEAL rejected the parameters: ") + context_->parameter_error_message());
+        }
+
+        if (ckks_)
+        {
+            if (!context_->first_context_data()->next_context_data())
+            {
+                throw std::invalid_argument("CKKS needs at least one modulus to rescale the product");
+            }
+            ckks_encoder_ = std::make_unique<seal::CKKSEncoder>(context_);
+            initial_velocity_level_ = RescaledProductLevel(context_, context_->first_parms_id(), scale_, scale_);
+        }
+        else
+        {
+            if (!context_->first_context_data()->qualifiers().using_batching)
+            {
+                throw std::invalid_argument("plain modulus does not support batching for this ring dimension");
+            }
+            batch_encoder_ = std::make_unique<seal::BatchEncoder>(context_);
+        }
+    }
+
+    /*****Generate keys and functions*****/
+    // Keys are stored uncompressed so a cached load is a plain copy out of
+    // the mapped file. A public factor makes the product plaintext x
+    // ciphertext, which needs no relinearization keys; a later encrypted run
+    // on the same entry derives them from the cached secret key rather than
+    // replacing the key pair others (the service, its clients) hold.
+    void keygen()
+    {
+        auto none = seal::compr_mode_type::none;
+        std::uint64_t generation = cache_.generation("secret_key");
+        bool key_pair_cached =
+            generation != 0 &&
+            cache_.load("secret_key", [&](std::istream &in) { secret_key_.load(context_, in); }, generation) &&
+            cache_.load("public_key", [&](std::istream &in) { public_key_.load(context_, in); }, generation);
+        if (!key_pair_cached)
+        {
+            generation = KeyCache::NewGeneration();
+            cache_.set_generation(generation);
+            seal::KeyGenerator keygen(context_);
+            public_key_ = keygen.public_key();
+            secret_key_ = keygen.secret_key();
+            cache_.store("secret_key", [&](std::ostream &out) { secret_key_.save(out, none); });
+            cache_.store("public_key", [&](std::ostream &out) { public_key_.save(out, none); });
+        }
+        cache_.set_generation(generation);
+
+        bool relin_cached = true;
+        if (needs_relin_keys() &&
+            !cache_.load("relin_keys", [&](std::istream &in) { relin_keys_.load(context_, in); }, generation))
+        {
+            relin_cached = false;
+            relin_keys_ = seal::KeyGenerator(context_, secret_key_).relin_keys_local();
+            cache_.store("relin_keys", [&](std::ostream &out) { relin_keys_.save(out, none); });
+        }
+        keys_cached_ = key_pair_cached && relin_cached;
+
+        // The secret key also enables encrypt_symmetric for seeded uploads.
+        encryptor_ = std::make_unique<seal::Encryptor>(context_, public_key_, secret_key_);
+        evaluator_ = std::make_unique<seal::Evaluator>(context_);
+        lazy_ = std::make_unique<LazyEvaluator>(context_, *evaluator_, relin_keys_, scale_);
+        decryptor_ = std::make_unique<seal::Decryptor>(context_, secret_key_);
+    }
+
+    // "off", "hit" (keys loaded from the cache) or "miss" (generated and stored).
+    const char *key_cache_status() const
+    {
+        return !cache_.enabled() ? "off" : keys_cached_ ? "hit" : "miss";
+    }
+
+    std::string scheme() const
+    {
+        return config_.scheme;
+    }
+
+    std::size_t ring_dimension() const
+    {
+        return config_.ring_dim;
+    }
+
+    std::size_t slot_count() const
+    {
+        return ckks_ ? ckks_encoder_->slot_count() : batch_encoder_->slot_count();
+    }
+
+    /*****Encode*****/
+    Encoded encode(const VelocityData &data) const
+    {
+        if (data.size() > slot_count())
+        {
+            throw std::invalid_argument("more records than slots in one SEAL ciphertext");
+        }
+        track_pool();
+        Encoded encoded = Recycler<Encoded>::acquire();
+        if (!ckks_)
+            encode_vector(data.initial_velocity, encoded.initial_velocity);
+        encode_vector(data.acc, encoded.acc);
+        encode_vector(data.times, encoded.times);
+        if (ckks_)
+        {
+            // Only consumed once the product is rescaled, so encoded (and
+            // encrypted) straight at that level and exact scale.
+            std::vector<double> slots(data.initial_velocity.begin(), data.initial_velocity.end());
+            ckks_encoder_->encode(slots, initial_velocity_level_.parms_id, initial_velocity_level_.scale,
+                                  encoded.initial_velocity);
+        }
+        return encoded;
+    }
+
+    /*****Encrypt*****/
+    // Public factors are moved to NTT form here, once per chunk, so
+    // multiply_plain does not transform them on every product.
+    Encrypted encrypt(const Encoded &encoded) const
+    {
+        Encrypted encrypted = Recycler<Encrypted>::acquire();
+        if (public_.initial_velocity)
+            encrypted.public_initial_velocity = encoded.initial_velocity;
+        else
+            encryptor_->encrypt(encoded.initial_velocity, encrypted.initial_velocity);
+        if (public_.acc)
+            encrypted.public_acc = ntt_form(encoded.acc);
+        else
+            encryptor_->encrypt(encoded.acc, encrypted.acc);
+        if (public_.times)
+            encrypted.public_times = ntt_form(encoded.times);
+        else
+            encryptor_->encrypt(encoded.times, encrypted.times);
+        return encrypted;
+    }
+
+    /*****Evaluate*****/
+    // With V_i encrypted the product is fused into a copy of it
+    // (LazyEvaluator::multiply_add_inplace): no separate product ciphertext,
+    // and a public factor's NTT passes happen in the evaluator's scratch.
+    Result evaluate(const Encrypted &encrypted) const
+    {
+        const seal::Ciphertext &secret_factor = public_.acc ? encrypted.times : encrypted.acc;
+        const seal::Plaintext &public_factor = public_.acc ? encrypted.public_acc : encrypted.public_times;
+        bool public_product = public_.acc || public_.times;
+
+        seal::Ciphertext enc_final_vel = Recycler<seal::Ciphertext>::acquire();
+        if (!public_.initial_velocity)
+        {
+            enc_final_vel = encrypted.initial_velocity;
+            if (public_product)
+                lazy_->multiply_plain_add_inplace(enc_final_vel, secret_factor, public_factor);
+            else
+                lazy_->multiply_add_inplace(enc_final_vel, encrypted.acc, encrypted.times);
+        }
+        else
+        {
+            // BFV ciphertexts live in coefficient form; CKKS ones are already NTT.
+            if (public_product)
+            {
+                enc_final_vel = secret_factor;
+                if (!ckks_)
+                    evaluator_->transform_to_ntt_inplace(enc_final_vel);
+                evaluator_->multiply_plain_inplace(enc_final_vel, public_factor);
+                if (!ckks_)
+                    evaluator_->transform_from_ntt_inplace(enc_final_vel);
+            }
+            else
+            {
+                enc_final_vel = lazy_->multiply(encrypted.acc, encrypted.times);
+            }
+            lazy_->add_plain_inplace(enc_final_vel, encrypted.public_initial_velocity);
+        }
+
+        // The lazy evaluator rescales the product, which lands on V_i's level
+        // and scale; the one relinearization happens when the result leaves.
+        lazy_->settle_inplace(enc_final_vel);
+        return enc_final_vel;
+    }
+
+    /*****Decrypt and Decode*****/
+    std::vector<double> decrypt(const Result &result, std::size_t n) const
+    {
+        seal::Plaintext plain_final_vel = Recycler<seal::Plaintext>::acquire();
+        decryptor_->decrypt(result, plain_final_vel);
+
+        std::vector<double> final_vel(n);
+        if (ckks_)
+        {
+            std::vector<double> decoded;
+            ckks_encoder_->decode(plain_final_vel, decoded);
+            std::copy(decoded.begin(), decoded.begin() + n, final_vel.begin());
+        }
+        else
+        {
+            std::vector<std::uint64_t> decoded;
+            batch_encoder_->decode(plain_final_vel, decoded);
+            for (std::size_t i = 0; i < n; i++)
+            {
+                final_vel[i] = static_cast<double>(decoded[i]);
+            }
+        }
+        recycle(std::move(plain_final_vel));
+        return final_vel;
+    }
+
+    /*****Recycle*****/
+    // Spent chunk objects go on this thread's free lists (HERecycler.h); the
+    // next chunk's encode, encrypt, evaluate and decrypt write into their
+    // buffers instead of allocating, since SEAL keeps a buffer that is big
+    // enough. With --recycle off they are freed as before.
+    void recycle(Encoded &&encoded) const
+    {
+        if (config_.recycle)
+            Recycler<Encoded>::release(std::move(encoded));
+    }
+
+    void recycle(Encrypted &&encrypted) const
+    {
+        if (config_.recycle)
+            Recycler<Encrypted>::release(std::move(encrypted));
+    }
+
+    void recycle(Result &&result) const
+    {
+        if (config_.recycle)
+            Recycler<seal::Ciphertext>::release(std::move(result));
+    }
+
+    void recycle(seal::Plaintext &&plain) const
+    {
+        if (config_.recycle)
+            Recycler<seal::Plaintext>::release(std::move(plain));
+    }
+
+    // Bytes SEAL's pools have taken from the system: the global pool, or
+    // every thread's pool that ran a chunk of this backend.
+    std::uint64_t memory_pool_bytes() const
+    {
+        if (!thread_pools_)
+        {
+            return seal::MemoryManager::GetPool(seal::mm_prof_opt::FORCE_GLOBAL).alloc_byte_count();
+        }
+        std::lock_guard<std::mutex> lock(pools_mutex_);
+        std::uint64_t bytes = 0;
+        for (const seal::MemoryPoolHandle &pool : pools_)
+        {
+            bytes += pool.alloc_byte_count();
+        }
+        return bytes;
+    }
+
+    /*****Wire Format*****/
+    // One chunk as the evaluation service (VelocityService.h) exchanges it:
+    // the three input ciphertexts up, the result down. Uncompressed, since
+    // the service is reached over a local socket. load checks every
+    // ciphertext against the context, so a malformed request is rejected.
+    void save_encrypted(const Encrypted &encrypted, std::ostream &out) const
+    {
+        encrypted.initial_velocity.save(out, seal::compr_mode_type::none);
+        encrypted.acc.save(out, seal::compr_mode_type::none);
+        encrypted.times.save(out, seal::compr_mode_type::none);
+    }
+
+    Encrypted load_encrypted(std::istream &in) const
+    {
+        Encrypted encrypted;
+        encrypted.initial_velocity.load(context_, in);
+        encrypted.acc.load(context_, in);
+        encrypted.times.load(context_, in);
+        return encrypted;
+    }
+
+    void save_result(const Result &result, std::ostream &out) const
+    {
+        result.save(out, seal::compr_mode_type::none);
+    }
+
+    Result load_result(std::istream &in) const
+    {
+        Result result;
+        result.load(context_, in);
+        return result;
+    }
+
+    /*****Noise Budget*****/
+    // Bits of invariant noise budget left in a result; -1 for CKKS, whose
+    // noise shows up as max error instead.
+    int noise_budget_bits(const Result &result) const
+    {
+        return ckks_ ? -1 : decryptor_->invariant_noise_budget(result);
+    }
+
+    /*****Object Sizes*****/
+    // Uncompressed serialized sizes, i.e. what a client/server exchange costs.
+    std::vector<ObjectSize> object_sizes(const Encrypted &encrypted, const Result &result) const
+    {
+        auto none = seal::compr_mode_type::none;
+        const seal::Ciphertext &input = public_.acc ? encrypted.times : encrypted.acc;
+        std::vector<ObjectSize> sizes{ { "public_key", static_cast<std::uint64_t>(public_key_.save_size(none)) } };
+        if (needs_relin_keys())
+        {
+            sizes.push_back({ "relin_keys", static_cast<std::uint64_t>(relin_keys_.save_size(none)) });
+        }
+        sizes.push_back({ "input_ciphertext", static_cast<std::uint64_t>(input.save_size(none)) });
+        sizes.push_back({ "result_ciphertext", static_cast<std::uint64_t>(result.save_size(none)) });
+        return sizes;
+    }
+
+    /*****Transport Sizes*****/
+    // Bytes on the wire for one chunk. Uploads are seeded symmetric
+    // ciphertexts, whose second polynomial is replaced by the PRNG seed; the
+    // result is mod-switched to the last level before it is sent back.
+    // Public operands are not uploaded.
+    std::vector<ObjectSize> transport_sizes(const Encoded &encoded, const Result &result,
+                                            const std::string &compression) const
+    {
+        seal::compr_mode_type mode = compr_mode(compression);
+        std::uint64_t upload = 0;
+        for (const seal::Plaintext *plain : secret_operands(encoded))
+        {
+            seal::Serializable<seal::Ciphertext> seeded = encryptor_->encrypt_symmetric(*plain);
+            upload += SerializedBytes([&](std::ostream &out) { seeded.save(out, mode); });
+        }
+
+        seal::Ciphertext lowest = result;
+        evaluator_->mod_switch_to_inplace(lowest, context_->last_parms_id());
+        std::uint64_t download = SerializedBytes([&](std::ostream &out) { lowest.save(out, mode); });
+        return { { "upload_ciphertexts", upload }, { "download_ciphertext", download } };
+    }
+
+private:
+    // Remembers the calling thread's pool once per thread and backend.
+    void track_pool() const
+    {
+        thread_local std::uint64_t tracked = 0;
+        if (!thread_pools_ || tracked == id_)
+        {
+            return;
+        }
+        tracked = id_;
+        std::lock_guard<std::mutex> lock(pools_mutex_);
+        pools_.push_back(seal::MemoryManager::GetPool());
+    }
+
+    static std::uint64_t NextId()
+    {
+        static std::atomic<std::uint64_t> next{ 1 };
+        return next.fetch_add(1);
+    }
+
+    bool needs_relin_keys() const
+    {
+        return !public_.acc && !public_.times;
+    }
+
+    std::vector<const seal::Plaintext *> secret_operands(const Encoded &encoded) const
+    {
+        std::vector<const seal::Plaintext *> secret;
+        if (!public_.initial_velocity)
+            secret.push_back(&encoded.initial_velocity);
+        if (!public_.acc)
+            secret.push_back(&encoded.acc);
+        if (!public_.times)
+            secret.push_back(&encoded.times);
+        return secret;
+    }
+
+    seal::Plaintext ntt_form(const seal::Plaintext &plain) const
+    {
+        seal::Plaintext transformed = plain;
+        if (!ckks_)
+        {
+            evaluator_->transform_to_ntt_inplace(transformed, context_->first_parms_id());
+        }
+        return transformed;
+    }
+
+    static seal::compr_mode_type compr_mode(const std::string &compression)
+    {
+        seal::compr_mode_type mode = compression == "zlib"   ? seal::compr_mode_type::deflate
+                                     : compression == "zstd" ? seal::compr_mode_type::zstd
+                                                             : seal::compr_mode_type::none;
+        if (!seal::Serialization::IsSupportedComprMode(mode))
+        {
+            throw std::invalid_argument("SEAL was built without " + compression + " support");
+        }
+        return mode;
+    }
+
+    void encode_vector(const std::vector<std::int64_t> &values, seal::Plaintext &destination) const
+    {
+        if (ckks_)
+        {
+            std::vector<double> slots(values.begin(), values.end());
+            ckks_encoder_->encode(slots, scale_, destination);
+        }
+        else
+        {
+            std::vector<std::uint64_t> slots(values.size());
+            for (std::size_t i = 0; i < values.size(); i++)
+            {
+                std::int64_t reduced = values[i] % static_cast<std::int64_t>(config_.plain_modulus);
+                slots[i] = static_cast<std::uint64_t>(reduced < 0 ? reduced + config_.plain_modulus : reduced);
+            }
+            batch_encoder_->encode(slots, destination);
+        }
+    }
+
+    BenchConfig config_;
+    bool ckks_;
+    PublicOperands public_;
+    bool thread_pools_;
+    std::uint64_t id_ = NextId();
+    mutable std::mutex pools_mutex_;
+    mutable std::vector<seal::MemoryPoolHandle> pools_;
+    double scale_ = 0;
+    OperandLevel initial_velocity_level_{}; // CKKS: where V_i meets a*t
+    KeyCache cache_;
+    bool keys_cached_ = false;
+
+    std::shared_ptr<seal::SEALContext> context_;
+    std::unique_ptr<seal::BatchEncoder> batch_encoder_;
+    std::unique_ptr<seal::CKKSEncoder> ckks_encoder_;
+
+    seal::PublicKey public_key_;
+    seal::SecretKey secret_key_;
+    seal::RelinKeys relin_keys_;
+
+    std::unique_ptr<seal::Encryptor> encryptor_;
+    std::unique_ptr<seal::Evaluator> evaluator_;
+    std::unique_ptr<LazyEvaluator> lazy_;
+    std::unique_ptr<seal::Decryptor> decryptor_;
+};
+
+} // namespace hebench
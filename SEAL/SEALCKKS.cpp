@@ -13,15 +13,19 @@
 #include <vector>
 #include "seal/seal.h"
 #include "examples.h"
+#include "HETimer.h"
+#include "SEALLazyEvaluator.h"
 
 using namespace std;
 using namespace seal;
 
 void example_ckks_basics()
 {
+    //1 untimed warm-up run, then 10 timed repetitions of encryption, evaluation and decryption
+    hebench::HETimer timer(1, 10);
+
     /*****Set Parameters and Context*****/
-    clock_t cc_clock;
-    cc_clock = clock();
+    timer.start("Parameter Generation");
 
     EncryptionParameters parms(scheme_type::CKKS);
 
@@ -36,11 +40,10 @@ void example_ckks_basics()
     //check parameters
     print_parameters(context);
     cout << "Parameter validation (success): " << context->parameter_error_message() << endl;
-    cc_clock= clock() - cc_clock;
+    timer.stop("Parameter Generation");
 
     /*****Key Generation*****/
-    clock_t key_clock;
-    key_clock = clock();
+    timer.start("Key Generation");
 
     KeyGenerator keygen(context);
     auto public_key = keygen.public_key();
@@ -54,12 +57,9 @@ void example_ckks_basics()
     CKKSEncoder encoder(context);
     size_t slot_count = encoder.slot_count();
     cout << "Number of slots: " << slot_count << endl;
-    key_clock = clock() - key_clock;
+    timer.stop("Key Generation");
 
     /*****Encode and Encrypt*****/
-    clock_t enc_clock;
-    enc_clock = clock();
-
     int N = slot_count; 
     vector<double> initial_velocity; 
     vector<double> times; 
@@ -80,44 +80,64 @@ void example_ckks_basics()
 
 
     Plaintext plain_initial_vel, plain_times, plain_acc;
-    encoder.encode(initial_velocity, scale, plain_initial_vel);
-    encoder.encode(times, scale, plain_times);
-    encoder.encode(acc, scale, plain_acc);
-
     Ciphertext enc_initial_vel, enc_times, enc_acc;
-    encryptor.encrypt(plain_initial_vel, enc_initial_vel);
-    encryptor.encrypt(plain_times, enc_times);
-    encryptor.encrypt(plain_acc, enc_acc);
-
-    enc_clock = clock() - enc_clock;
 
-    /*****Evaluate*****/
-    clock_t eval_clock;
-    eval_clock = clock();
+    //v_i is only consumed after a*t is rescaled, so it is encoded and encrypted straight at that level and at
+    //the product's exact scale: no mod switch, one prime less to upload and no scale overwrite before the add
+    hebench::OperandLevel initial_vel_level = hebench::RescaledProductLevel(context, context->first_parms_id(), scale, scale);
 
-    Ciphertext enc_final_vel;
+    timer.measure("Encryption", [&]() {
+        encoder.encode(initial_velocity, initial_vel_level.parms_id, initial_vel_level.scale, plain_initial_vel);
+        encoder.encode(times, scale, plain_times);
+        encoder.encode(acc, scale, plain_acc);
 
-    evaluator.multiply(enc_acc, enc_times, enc_final_vel);
-    evaluator.relinearize_inplace(enc_final_vel, relin_keys);
-    evaluator.rescale_to_next_inplace(enc_final_vel);
-    
-    enc_final_vel.scale() = pow(2.0,40);
-    enc_initial_vel.scale() = pow(2.0,40);
+        encryptor.encrypt(plain_initial_vel, enc_initial_vel);
+        encryptor.encrypt(plain_times, enc_times);
+        encryptor.encrypt(plain_acc, enc_acc);
+    });
 
-    parms_id_type last_parms_id = enc_final_vel.parms_id();
-    evaluator.mod_switch_to_inplace(enc_initial_vel, last_parms_id);
-    evaluator.add_inplace(enc_final_vel, enc_initial_vel);
+    /*****Evaluate*****/
+    Ciphertext enc_final_vel;
 
-    eval_clock = clock() - eval_clock;
+    timer.measure("Evaluation (v_i + at)", [&]() {
+        evaluator.multiply(enc_acc, enc_times, enc_final_vel);
+        evaluator.relinearize_inplace(enc_final_vel, relin_keys);
+        evaluator.rescale_to_next_inplace(enc_final_vel);
+        evaluator.add_inplace(enc_final_vel, enc_initial_vel);
+    });
+
+    /*****Sum of products*****/
+    //sum_k a*t over K batches, e.g. the distance covered over K time steps: relinearizing and rescaling
+    //every product costs K key switches and K rescales, the lazy evaluator does one of each
+    const size_t K = 8;
+    vector<Ciphertext> enc_accs(K, enc_acc), enc_timess(K, enc_times);
+    Ciphertext enc_sum_eager, enc_sum_lazy;
+    hebench::LazyEvaluator lazy_evaluator(context, evaluator, relin_keys, scale);
+
+    timer.measure("Sum of 8 products (eager)", [&]() {
+        for (size_t k = 0; k < K; k++)
+        {
+            Ciphertext product;
+            evaluator.multiply(enc_accs[k], enc_timess[k], product);
+            evaluator.relinearize_inplace(product, relin_keys);
+            evaluator.rescale_to_next_inplace(product);
+            if (k == 0)
+                enc_sum_eager = product;
+            else
+                evaluator.add_inplace(enc_sum_eager, product);
+        }
+    });
+
+    timer.measure("Sum of 8 products (lazy)", [&]() {
+        enc_sum_lazy = lazy_evaluator.inner_product(enc_accs, enc_timess);
+    });
 
     /*****Decrypt*****/
-    clock_t dec_clock;
-    dec_clock = clock();
-
     Plaintext plain_final_vel;
-    decryptor.decrypt(enc_final_vel, plain_final_vel);
 
-    dec_clock = clock() - dec_clock;
+    timer.measure("Decryption", [&]() {
+        decryptor.decrypt(enc_final_vel, plain_final_vel);
+    });
 
     /*****Decode*****/
     vector<double> final_vel;
@@ -137,11 +157,49 @@ void example_ckks_basics()
     cout << " Final Velocity: " << endl;
     print_vector(final_vel, 3, 4);
 
-    cout << "Times:" <<endl;
-    cout << "Parameter Generation  : " << ((float)cc_clock)/CLOCKS_PER_SEC << endl;
-    cout << "Key Generation        : " << ((float)key_clock)/CLOCKS_PER_SEC << endl;
-    cout << "Encryption            : " << ((float)enc_clock)/CLOCKS_PER_SEC << endl;
-    cout << "Evaluation (v_i + at) : " << ((float)eval_clock)/CLOCKS_PER_SEC << endl;
-    cout << "Decryption            : " << ((float)dec_clock)/CLOCKS_PER_SEC << endl;
+    Plaintext plain_sum_eager, plain_sum_lazy;
+    vector<double> sum_eager, sum_lazy;
+    decryptor.decrypt(enc_sum_eager, plain_sum_eager);
+    decryptor.decrypt(enc_sum_lazy, plain_sum_lazy);
+    encoder.decode(plain_sum_eager, sum_eager);
+    encoder.decode(plain_sum_lazy, sum_lazy);
+    double max_difference = 0;
+    for (size_t i = 0; i < sum_eager.size(); i++)
+    {
+        max_difference = max(max_difference, fabs(sum_eager[i] - sum_lazy[i]));
+    }
+    cout << "Sum of " << K << " products, eager vs lazy max difference: " << max_difference << endl;
+    cout << "Lazy evaluator: " << lazy_evaluator.relinearizations() << " relinearizations, "
+         << lazy_evaluator.rescales() << " rescales over all repetitions" << endl;
+
+    /*****Object Sizes*****/
+    //Uncompressed serialized sizes
+    cout << "Serialized sizes:" << endl;
+    hebench::PrintObjectSize(cout, { "Public key", static_cast<uint64_t>(public_key.save_size(compr_mode_type::none)) });
+    hebench::PrintObjectSize(cout, { "Relin keys", static_cast<uint64_t>(relin_keys.save_size(compr_mode_type::none)) });
+    hebench::PrintObjectSize(cout, { "Ciphertext (input)", static_cast<uint64_t>(enc_acc.save_size(compr_mode_type::none)) });
+    hebench::PrintObjectSize(cout, { "Ciphertext (result)", static_cast<uint64_t>(enc_final_vel.save_size(compr_mode_type::none)) });
+
+    /*****Transport*****/
+    //What a client would upload and get back: seeded symmetric ciphertexts (the second polynomial is
+    //replaced by its PRNG seed) and the result mod-switched to the last level, both with the default compression
+    Encryptor sym_encryptor(context, secret_key);
+    compr_mode_type compr_mode = Serialization::compr_mode_default;
+    uint64_t upload_bytes = 0;
+    for (const Plaintext *plain : { &plain_initial_vel, &plain_times, &plain_acc })
+    {
+        Serializable<Ciphertext> seeded = sym_encryptor.encrypt_symmetric(*plain);
+        upload_bytes += hebench::SerializedBytes([&](ostream &out) { seeded.save(out, compr_mode); });
+    }
+    Ciphertext enc_final_vel_lowest = enc_final_vel;
+    evaluator.mod_switch_to_inplace(enc_final_vel_lowest, context->last_parms_id());
+    uint64_t download_bytes = hebench::SerializedBytes([&](ostream &out) { enc_final_vel_lowest.save(out, compr_mode); });
+
+    cout << "Transport sizes:" << endl;
+    hebench::PrintObjectSize(cout, { "Upload (3 inputs)", upload_bytes });
+    hebench::PrintObjectSize(cout, { "Download (result)", download_bytes });
+    cout << "Bytes per record: " << double(upload_bytes) / N << " up, " << double(download_bytes) / N << " down" << endl;
+
+    timer.print(cout);
 
 }
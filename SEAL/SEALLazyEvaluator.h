@@ -0,0 +1,327 @@
+/****************************************************/
+/* Lazy relinearization and deferred rescale        */
+/* Products stay size 3 (and at scale^2 for CKKS)   */
+/* until an operation needs them smaller, so a sum  */
+/* of products pays one key switch and one rescale; */
+/* fused multiply-add into an accumulator           */
+/****************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "seal/seal.h"
+
+namespace hebench
+{
+
+// Where a CKKS operand is consumed: an operand encoded at this parms_id and
+// scale meets the value there with no mod switch and no scale fix-up.
+struct OperandLevel
+{
+    seal::parms_id_type parms_id;
+    double scale;
+};
+
+// Level of rescale(a * b) for a and b at parms_id with scales scale_a and
+// scale_b: one prime down, at exactly the scale SEAL gives the product
+// (computed in the same order, so the doubles compare equal). An operand
+// added to the product is encoded here rather than at the top level, which
+// saves the mod switch and a prime's worth of upload.
+inline OperandLevel RescaledProductLevel(const std::shared_ptr<seal::SEALContext> &context,
+                                         const seal::parms_id_type &parms_id, double scale_a, double scale_b)
+{
+    auto context_data = context->get_context_data(parms_id);
+    if (!context_data || !context_data->next_context_data())
+    {
+        throw std::invalid_argument("no level left below the product to rescale to");
+    }
+    double scale = scale_a * scale_b;
+    scale /= static_cast<double>(context_data->parms().coeff_modulus().back().value());
+    return { context_data->next_context_data()->parms_id(), scale };
+}
+
+// Wraps a SEAL Evaluator and reads the state it needs off the ciphertexts:
+// size() > 2 means "not relinearized", a CKKS scale well above the encoding
+// scale means "product not rescaled yet". Safe to share between threads
+// like the Evaluator itself.
+class LazyEvaluator
+{
+public:
+    // scale is the CKKS encoding scale, 0 for BFV. relin_keys may be empty
+    // if no two ciphertexts are ever multiplied.
+    LazyEvaluator(std::shared_ptr<seal::SEALContext> context, seal::Evaluator &evaluator,
+                  const seal::RelinKeys &relin_keys, double scale)
+        : context_(std::move(context)), evaluator_(evaluator), relin_keys_(relin_keys), scale_(scale)
+    {}
+
+    // a * b, left unrelinearized and unrescaled. Operands are settled first
+    // only when they must be: size-3 factors would need keys for s^3, and a
+    // pending rescale would square the scale again.
+    seal::Ciphertext multiply(const seal::Ciphertext &a, const seal::Ciphertext &b) const
+    {
+        if (a.size() > 2 || pending_rescale(a) || b.size() > 2 || pending_rescale(b))
+        {
+            seal::Ciphertext x = a, y = b;
+            settle_inplace(x);
+            settle_inplace(y);
+            return multiply(x, y);
+        }
+        if (a.parms_id() != b.parms_id())
+        {
+            seal::Ciphertext x = a, y = b;
+            match_levels(x, y);
+            return multiply(x, y);
+        }
+        seal::Ciphertext product;
+        evaluator_.multiply(a, b, product);
+        return product;
+    }
+
+    /*****Fused multiply-add*****/
+    // accumulator += a * b. The product is formed in a per-thread scratch
+    // ciphertext, whose buffer is reused from call to call instead of a
+    // fresh result per product, and added unrelinearized; settle_inplace
+    // once after the last term.
+    void multiply_add_inplace(seal::Ciphertext &accumulator, const seal::Ciphertext &a,
+                              const seal::Ciphertext &b) const
+    {
+        if (a.size() > 2 || pending_rescale(a) || b.size() > 2 || pending_rescale(b) || a.parms_id() != b.parms_id())
+        {
+            add_owned_inplace(accumulator, Scratch() = multiply(a, b));
+            return;
+        }
+        seal::Ciphertext &product = Scratch();
+        product = a;
+        evaluator_.multiply_inplace(product, b);
+        add_owned_inplace(accumulator, product);
+    }
+
+    // accumulator += a * plain, plain in NTT form (Evaluator::
+    // transform_to_ntt_inplace for BFV, as CKKS encodes). A BFV factor is
+    // brought to NTT form in the scratch ciphertext and back once the
+    // product is taken.
+    void multiply_plain_add_inplace(seal::Ciphertext &accumulator, const seal::Ciphertext &a,
+                                    const seal::Plaintext &plain) const
+    {
+        seal::Ciphertext &product = Scratch();
+        product = a;
+        settle_inplace(product);
+        if (!ckks())
+            evaluator_.transform_to_ntt_inplace(product);
+        evaluator_.multiply_plain_inplace(product, plain);
+        if (!ckks())
+            evaluator_.transform_from_ntt_inplace(product);
+        add_owned_inplace(accumulator, product);
+    }
+
+    // accumulator += sum_i a[i] * b[i]; one relinearization and one rescale
+    // for the whole sum once settled.
+    void multiply_add_inplace(seal::Ciphertext &accumulator, const std::vector<seal::Ciphertext> &a,
+                              const std::vector<seal::Ciphertext> &b) const
+    {
+        check_lengths(a.size(), b.size());
+        for (std::size_t i = 0; i < a.size(); i++)
+        {
+            multiply_add_inplace(accumulator, a[i], b[i]);
+        }
+    }
+
+    // accumulator += sum_i a[i] * plain[i]. BFV terms are summed in NTT
+    // form and transformed back once, so n terms cost n forward NTTs and
+    // one inverse instead of n of each; CKKS terms are summed at scale^2
+    // and rescaled once.
+    void multiply_plain_add_inplace(seal::Ciphertext &accumulator, const std::vector<seal::Ciphertext> &a,
+                                    const std::vector<seal::Plaintext> &plain) const
+    {
+        check_lengths(a.size(), plain.size());
+        seal::Ciphertext &sum = Scratch();
+        seal::Ciphertext &term = SecondScratch();
+        for (std::size_t i = 0; i < a.size(); i++)
+        {
+            seal::Ciphertext &product = i == 0 ? sum : term;
+            product = a[i];
+            settle_inplace(product);
+            if (!ckks())
+                evaluator_.transform_to_ntt_inplace(product);
+            evaluator_.multiply_plain_inplace(product, plain[i]);
+            if (i > 0)
+            {
+                match_levels(sum, term);
+                evaluator_.add_inplace(sum, term);
+            }
+        }
+        if (!ckks())
+            evaluator_.transform_from_ntt_inplace(sum);
+        add_owned_inplace(accumulator, sum);
+    }
+
+    // destination += addend. Sizes may differ (SEAL adds size 2 and size 3
+    // directly); a pending rescale is applied and levels are brought
+    // together, but CKKS scales must already agree. An addend already at
+    // the destination's level is added as it is; only one that needs
+    // aligning is copied, into the per-thread scratch ciphertext.
+    void add_inplace(seal::Ciphertext &destination, const seal::Ciphertext &addend) const
+    {
+        if (ckks() && (addend.parms_id() != destination.parms_id() ||
+                       pending_rescale(addend) != pending_rescale(destination)))
+        {
+            add_owned_inplace(destination, Scratch() = addend);
+            return;
+        }
+        if (ckks() && destination.scale() != addend.scale())
+        {
+            throw std::invalid_argument("CKKS scales differ; encode the operand at RescaledProductLevel");
+        }
+        evaluator_.add_inplace(destination, addend);
+    }
+
+    // destination += plain. A CKKS plaintext must be encoded where the
+    // ciphertext is consumed, e.g. at RescaledProductLevel for a product
+    // (or, for BFV, in coefficient form).
+    void add_plain_inplace(seal::Ciphertext &destination, const seal::Plaintext &plain) const
+    {
+        if (ckks())
+        {
+            if (pending_rescale(destination))
+            {
+                rescale_inplace(destination);
+            }
+            if (destination.parms_id() != plain.parms_id() || destination.scale() != plain.scale())
+            {
+                throw std::invalid_argument("plaintext is not encoded at the ciphertext's level and scale");
+            }
+        }
+        evaluator_.add_plain_inplace(destination, plain);
+    }
+
+    // sum_i a[i] * b[i] with one relinearization and one rescale in total,
+    // instead of one of each per product.
+    seal::Ciphertext inner_product(const std::vector<seal::Ciphertext> &a, const std::vector<seal::Ciphertext> &b) const
+    {
+        check_lengths(a.size(), b.size());
+        seal::Ciphertext sum = multiply(a[0], b[0]);
+        for (std::size_t i = 1; i < a.size(); i++)
+        {
+            multiply_add_inplace(sum, a[i], b[i]);
+        }
+        settle_inplace(sum);
+        return sum;
+    }
+
+    // Relinearizes to size 2 and applies a pending rescale. Needed before
+    // rotating, multiplying again or sending a result out; decryption
+    // itself works on size-3 ciphertexts.
+    void settle_inplace(seal::Ciphertext &encrypted) const
+    {
+        if (encrypted.size() > 2)
+        {
+            evaluator_.relinearize_inplace(encrypted, relin_keys_);
+            relinearizations_++;
+        }
+        if (pending_rescale(encrypted))
+        {
+            rescale_inplace(encrypted);
+        }
+    }
+
+    std::size_t relinearizations() const
+    {
+        return relinearizations_;
+    }
+
+    std::size_t rescales() const
+    {
+        return rescales_;
+    }
+
+private:
+    bool ckks() const
+    {
+        return scale_ > 0;
+    }
+
+    static void check_lengths(std::size_t a, std::size_t b)
+    {
+        if (a == 0 || a != b)
+        {
+            throw std::invalid_argument("products need two non-empty operand vectors of the same length");
+        }
+    }
+
+    // Per-thread buffers for intermediate products; SEAL reuses a
+    // ciphertext's allocation when a smaller or equal one is assigned.
+    static seal::Ciphertext &Scratch()
+    {
+        thread_local seal::Ciphertext scratch;
+        return scratch;
+    }
+
+    static seal::Ciphertext &SecondScratch()
+    {
+        thread_local seal::Ciphertext scratch;
+        return scratch;
+    }
+
+    // destination += addend, free to rescale or mod-switch addend in place.
+    void add_owned_inplace(seal::Ciphertext &destination, seal::Ciphertext &addend) const
+    {
+        if (ckks())
+        {
+            if (pending_rescale(destination) != pending_rescale(addend))
+            {
+                rescale_inplace(pending_rescale(destination) ? destination : addend);
+            }
+            match_levels(destination, addend);
+            // A rescaled product sits at scale^2 / q, not at the encoding
+            // scale; overwriting either scale would silently skew the sum.
+            if (destination.scale() != addend.scale())
+            {
+                throw std::invalid_argument("CKKS scales differ; encode the operand at RescaledProductLevel");
+            }
+        }
+        evaluator_.add_inplace(destination, addend);
+    }
+
+    // A product of two fresh operands sits near scale^2, a rescaled one near
+    // scale; halfway between (in bits) tells them apart.
+    bool pending_rescale(const seal::Ciphertext &encrypted) const
+    {
+        return ckks() && std::log2(encrypted.scale()) > 1.5 * std::log2(scale_);
+    }
+
+    void rescale_inplace(seal::Ciphertext &encrypted) const
+    {
+        evaluator_.rescale_to_next_inplace(encrypted);
+        rescales_++;
+    }
+
+    // Switches the operand higher up the modulus chain down to the other.
+    void match_levels(seal::Ciphertext &a, seal::Ciphertext &b) const
+    {
+        if (a.parms_id() == b.parms_id())
+        {
+            return;
+        }
+        std::size_t level_a = context_->get_context_data(a.parms_id())->chain_index();
+        std::size_t level_b = context_->get_context_data(b.parms_id())->chain_index();
+        if (level_a > level_b)
+            evaluator_.mod_switch_to_inplace(a, b.parms_id());
+        else
+            evaluator_.mod_switch_to_inplace(b, a.parms_id());
+    }
+
+    std::shared_ptr<seal::SEALContext> context_;
+    seal::Evaluator &evaluator_;
+    const seal::RelinKeys &relin_keys_;
+    double scale_;
+    mutable std::atomic<std::size_t> relinearizations_{ 0 };
+    mutable std::atomic<std::size_t> rescales_{ 0 };
+};
+
+} // namespace hebench
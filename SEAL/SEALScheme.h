@@ -0,0 +1,292 @@
+/****************************************************/
+/* SEAL implementation of the generic HE interface  */
+/* BFV and CKKS behind the operations HEScheme.h    */
+/* lists, resolved at compile time                  */
+/****************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "seal/seal.h"
+#include "BenchConfig.h"
+#include "RotationPlan.h"
+#include "SEALLazyEvaluator.h"
+
+namespace hebench
+{
+
+class SEALScheme
+{
+public:
+    using Plaintext = seal::Plaintext;
+    using Ciphertext = seal::Ciphertext;
+
+    static const char *Name()
+    {
+        return "seal";
+    }
+
+    static bool Supports(const std::string &scheme)
+    {
+        return scheme == "bfv" || scheme == "ckks";
+    }
+
+    /*****Context*****/
+    // Same parameters as SEALBackend for the same config.
+    explicit SEALScheme(const BenchConfig &config) : config_(config), ckks_(config.scheme == "ckks")
+    {
+        if (!Supports(config.scheme))
+        {
+            throw std::invalid_argument("SEAL does not support the " + config.scheme + " scheme");
+        }
+        seal::sec_level_type security = config.security == 256   ? seal::sec_level_type::tc256
+                                        : config.security == 192 ? seal::sec_level_type::tc192
+                                                                 : seal::sec_level_type::tc128;
+
+        seal::EncryptionParameters parms(ckks_ ? seal::scheme_type::CKKS : seal::scheme_type::BFV);
+        parms.set_poly_modulus_degree(config.ring_dim);
+        if (!config.coeff_bits.empty())
+        {
+            parms.set_coeff_modulus(seal::CoeffModulus::Create(config.ring_dim, config.coeff_bits));
+        }
+        else if (ckks_)
+        {
+            std::vector<int> bit_sizes{ 60 };
+            bit_sizes.insert(bit_sizes.end(), config.depth, static_cast<int>(config.scale_bits));
+            bit_sizes.push_back(60);
+            parms.set_coeff_modulus(seal::CoeffModulus::Create(config.ring_dim, bit_sizes));
+        }
+        else
+        {
+            parms.set_coeff_modulus(seal::CoeffModulus::BFVDefault(config.ring_dim, security));
+        }
+        if (!ckks_)
+        {
+            parms.set_plain_modulus(config.plain_modulus);
+        }
+        scale_ = ckks_ ? std::pow(2.0, config.scale_bits) : 0;
+
+        context_ = seal::SEALContext::Create(parms, true, security);
+        if (!context_->parameters_set())
+        {
+            throw std::invalid_argument(std::string("SEAL rejected the parameters: ") + context_->parameter_error_message());
+        }
+        if (ckks_)
+        {
+            ckks_encoder_ = std::make_unique<seal::CKKSEncoder>(context_);
+        }
+        else
+        {
+            if (!context_->first_context_data()->qualifiers().using_batching)
+            {
+                throw std::invalid_argument("plain modulus does not support batching for this ring dimension");
+            }
+            batch_encoder_ = std::make_unique<seal::BatchEncoder>(context_);
+        }
+        evaluator_ = std::make_unique<seal::Evaluator>(context_);
+    }
+
+    // Relinearization keys always, Galois keys for the planned rotations.
+    void keygen(const RotationPlan &rotations = RotationPlan())
+    {
+        seal::KeyGenerator keygen(context_);
+        public_key_ = keygen.public_key();
+        secret_key_ = keygen.secret_key();
+        relin_keys_ = keygen.relin_keys_local();
+        if (rotations.key_count() > 0)
+        {
+            galois_keys_ = keygen.galois_keys_local(rotations.indices());
+        }
+        encryptor_ = std::make_unique<seal::Encryptor>(context_, public_key_);
+        decryptor_ = std::make_unique<seal::Decryptor>(context_, secret_key_);
+        lazy_ = std::make_unique<LazyEvaluator>(context_, *evaluator_, relin_keys_, scale_);
+    }
+
+    std::size_t slot_count() const
+    {
+        return ckks_ ? ckks_encoder_->slot_count() : batch_encoder_->slot_count();
+    }
+
+    // BFV slots form two rows that rotate_rows rotates separately.
+    std::size_t row_size() const
+    {
+        return ckks_ ? slot_count() : slot_count() / 2;
+    }
+
+    /*****Encode, encrypt, decrypt*****/
+    // level: multiplications the value waits for before it is consumed.
+    // CKKS encodes it k primes down at s_k = s_{k-1}^2 / q_k, the scale of
+    // any product k multiplications deep whose operands were aligned
+    // (RescaledProductLevel, applied k times), so it meets such a product
+    // without a mod switch or scale fix-up. BFV values are rounded and
+    // reduced mod t.
+    Plaintext encode(const std::vector<double> &values, std::size_t level = 0) const
+    {
+        Plaintext plain;
+        if (ckks_)
+        {
+            OperandLevel at{ context_->first_parms_id(), scale_ };
+            for (std::size_t k = 0; k < level; k++)
+            {
+                at = RescaledProductLevel(context_, at.parms_id, at.scale, at.scale);
+            }
+            ckks_encoder_->encode(values, at.parms_id, at.scale, plain);
+            return plain;
+        }
+        std::int64_t t = static_cast<std::int64_t>(config_.plain_modulus);
+        std::vector<std::uint64_t> slots(values.size());
+        for (std::size_t i = 0; i < values.size(); i++)
+        {
+            std::int64_t reduced = std::llround(values[i]) % t;
+            slots[i] = static_cast<std::uint64_t>(reduced < 0 ? reduced + t : reduced);
+        }
+        batch_encoder_->encode(slots, plain);
+        return plain;
+    }
+
+    Ciphertext encrypt(const Plaintext &plain) const
+    {
+        Ciphertext encrypted;
+        encryptor_->encrypt(plain, encrypted);
+        return encrypted;
+    }
+
+    // BFV values come back centered in (-t/2, t/2], as PALISADE's do.
+    std::vector<double> decrypt(const Ciphertext &encrypted, std::size_t n) const
+    {
+        Plaintext plain;
+        decryptor_->decrypt(encrypted, plain);
+        std::vector<double> values(n);
+        if (ckks_)
+        {
+            std::vector<double> decoded;
+            ckks_encoder_->decode(plain, decoded);
+            std::copy(decoded.begin(), decoded.begin() + n, values.begin());
+            return values;
+        }
+        std::vector<std::uint64_t> decoded;
+        batch_encoder_->decode(plain, decoded);
+        for (std::size_t i = 0; i < n; i++)
+        {
+            values[i] = decoded[i] > config_.plain_modulus / 2
+                            ? -static_cast<double>(config_.plain_modulus - decoded[i])
+                            : static_cast<double>(decoded[i]);
+        }
+        return values;
+    }
+
+    /*****Evaluate*****/
+    // Levels are matched by the lazy evaluator; CKKS scales must agree.
+    Ciphertext add(const Ciphertext &a, const Ciphertext &b) const
+    {
+        Ciphertext sum = a;
+        lazy_->add_inplace(sum, b);
+        return sum;
+    }
+
+    Ciphertext add_plain(const Ciphertext &a, const Plaintext &plain) const
+    {
+        Ciphertext sum = a;
+        lazy_->add_plain_inplace(sum, plain);
+        return sum;
+    }
+
+    // Unrelinearized (size 3) and, for CKKS, unrescaled.
+    Ciphertext multiply(const Ciphertext &a, const Ciphertext &b) const
+    {
+        return lazy_->multiply(a, b);
+    }
+
+    Ciphertext multiply_plain(const Ciphertext &a, const Plaintext &plain) const
+    {
+        Ciphertext product;
+        evaluator_->multiply_plain(a, plain, product);
+        return product;
+    }
+
+    Ciphertext relinearize(const Ciphertext &a) const
+    {
+        Ciphertext relinearized = a;
+        if (relinearized.size() > 2)
+        {
+            evaluator_->relinearize_inplace(relinearized, relin_keys_);
+        }
+        return relinearized;
+    }
+
+    // CKKS: drops the last prime and divides the scale by it; BFV: a copy.
+    Ciphertext rescale(const Ciphertext &a) const
+    {
+        Ciphertext rescaled = a;
+        if (ckks_)
+        {
+            evaluator_->rescale_to_next_inplace(rescaled);
+        }
+        return rescaled;
+    }
+
+    // y brought to x's level and scale, y no deeper than x. CKKS multiplies
+    // by 1 encoded at scale s_x * q / s_y, so the rescale by y's last prime
+    // q lands on s_x, then switches down to x's level. Costs y one level.
+    Ciphertext align(const Ciphertext &y, const Ciphertext &x) const
+    {
+        if (!ckks_ || (y.parms_id() == x.parms_id() && y.scale() == x.scale()))
+        {
+            return y;
+        }
+        auto y_data = context_->get_context_data(y.parms_id());
+        auto x_data = context_->get_context_data(x.parms_id());
+        if (y_data->chain_index() <= x_data->chain_index())
+        {
+            throw std::invalid_argument("only an operand above the target level can be aligned to it");
+        }
+        double q = static_cast<double>(y_data->parms().coeff_modulus().back().value());
+        Plaintext one;
+        ckks_encoder_->encode(1.0, y.parms_id(), x.scale() * q / y.scale(), one);
+        Ciphertext aligned;
+        evaluator_->multiply_plain(y, one, aligned);
+        evaluator_->rescale_to_next_inplace(aligned);
+        evaluator_->mod_switch_to_inplace(aligned, x.parms_id());
+        // Equal to x's scale up to the rounding of the division above.
+        aligned.scale() = x.scale();
+        return aligned;
+    }
+
+    // Left by step slots; BFV rotates both rows of N/2 slots.
+    Ciphertext rotate(const Ciphertext &a, int step) const
+    {
+        Ciphertext rotated = relinearize(a);
+        if (ckks_)
+            evaluator_->rotate_vector_inplace(rotated, step, galois_keys_);
+        else
+            evaluator_->rotate_rows_inplace(rotated, step, galois_keys_);
+        return rotated;
+    }
+
+private:
+    BenchConfig config_;
+    bool ckks_;
+    double scale_ = 0;
+
+    std::shared_ptr<seal::SEALContext> context_;
+    std::unique_ptr<seal::BatchEncoder> batch_encoder_;
+    std::unique_ptr<seal::CKKSEncoder> ckks_encoder_;
+
+    seal::PublicKey public_key_;
+    seal::SecretKey secret_key_;
+    seal::RelinKeys relin_keys_;
+    seal::GaloisKeys galois_keys_;
+
+    std::unique_ptr<seal::Encryptor> encryptor_;
+    std::unique_ptr<seal::Evaluator> evaluator_;
+    std::unique_ptr<LazyEvaluator> lazy_;
+    std::unique_ptr<seal::Decryptor> decryptor_;
+};
+
+} // namespace hebench